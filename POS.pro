@@ -1,4 +1,4 @@
-QT       += core gui sql charts
+QT       += core gui sql charts concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -16,7 +16,36 @@ SOURCES += \
     logindialog.cpp \
     saledetaildialog.cpp \
     userdialog.cpp \
-    dashboardpage.cpp
+    dashboardpage.cpp \
+    checkoutpipeline.cpp \
+    salesjournal.cpp \
+    groupcommitter.cpp \
+    stockledger.cpp \
+    cartjournal.cpp \
+    chartdownsampler.cpp \
+    backupservice.cpp \
+    analyticsreplica.cpp \
+    maintenancescheduler.cpp \
+    storeprotocol.cpp \
+    storeserver.cpp \
+    storeclient.cpp \
+    storeloopback.cpp \
+    storesync.cpp \
+    catalogcache.cpp \
+    shadoweffect.cpp \
+    uibenchmark.cpp \
+    posstyle.cpp \
+    saledetailcache.cpp \
+    imagestore.cpp \
+    zreport.cpp \
+    zreportdialog.cpp \
+    stockhistory.cpp \
+    stocktakedialog.cpp \
+    bulkpricing.cpp \
+    bulkpricedialog.cpp \
+    promotionengine.cpp \
+    readconnection.cpp \
+    basketminer.cpp
 
 HEADERS += \
     mainwindow.h \
@@ -27,7 +56,37 @@ HEADERS += \
     logindialog.h \
     saledetaildialog.h \
     userdialog.h \
-    dashboardpage.h
+    dashboardpage.h \
+    pendingsale.h \
+    checkoutpipeline.h \
+    salesjournal.h \
+    groupcommitter.h \
+    stockledger.h \
+    cartjournal.h \
+    chartdownsampler.h \
+    backupservice.h \
+    analyticsreplica.h \
+    maintenancescheduler.h \
+    storeprotocol.h \
+    storeserver.h \
+    storeclient.h \
+    storeloopback.h \
+    storesync.h \
+    catalogcache.h \
+    shadoweffect.h \
+    uibenchmark.h \
+    posstyle.h \
+    saledetailcache.h \
+    imagestore.h \
+    zreport.h \
+    zreportdialog.h \
+    stockhistory.h \
+    stocktakedialog.h \
+    bulkpricing.h \
+    bulkpricedialog.h \
+    promotionengine.h \
+    readconnection.h \
+    basketminer.h
 
 FORMS += \
     mainwindow.ui \
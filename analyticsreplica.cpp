@@ -0,0 +1,128 @@
+#include "analyticsreplica.h"
+#include "databasemanager.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTimer>
+
+ReplicaWorker::ReplicaWorker(const QString &databasePath, const QString &replicaPath, int intervalMs, QObject *parent) :
+    QObject(parent),
+    m_databasePath(databasePath),
+    m_replicaPath(replicaPath),
+    m_intervalMs(intervalMs),
+    m_dbManager(nullptr),
+    m_timer(nullptr),
+    m_dataVersion(-1)
+{
+}
+
+ReplicaWorker::~ReplicaWorker()
+{
+    delete m_dbManager;
+}
+
+void ReplicaWorker::start()
+{
+    // Created here so the connection belongs to the replica thread
+    m_dbManager = new DatabaseManager("replica-sync", m_databasePath);
+
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    connect(m_timer, &QTimer::timeout, this, &ReplicaWorker::refresh);
+    refresh();
+}
+
+void ReplicaWorker::refresh()
+{
+    if (!m_dbManager) {
+        return; // Shut down
+    }
+
+    // data_version only moves when another connection commits to the store, so
+    // an idle store costs one pragma per period instead of a copy.
+    const QDateTime asOf = QDateTime::currentDateTime();
+    const qint64 dataVersion = m_dbManager->dataVersion();
+    if (dataVersion != -1 && dataVersion == m_dataVersion) {
+        emit refreshed(asOf, false);
+    } else {
+        QElapsedTimer timer;
+        timer.start();
+        if (m_dbManager->refreshReplica(m_replicaPath)) {
+            m_dataVersion = dataVersion;
+            emit refreshed(asOf, true);
+            qDebug() << "Analytics replica refreshed in" << timer.elapsed() << "ms";
+        }
+    }
+    m_timer->start(m_intervalMs);
+}
+
+void ReplicaWorker::requestRefresh()
+{
+    // Bring the next refresh forward, but never run them back to back
+    if (m_timer && m_timer->remainingTime() > MinRefreshIntervalMs) {
+        m_timer->start(MinRefreshIntervalMs);
+    }
+}
+
+void ReplicaWorker::shutdown()
+{
+    delete m_timer;
+    m_timer = nullptr;
+    delete m_dbManager;
+    m_dbManager = nullptr;
+}
+
+AnalyticsReplica::AnalyticsReplica(const QString &databasePath, const QString &replicaPath, QObject *parent) :
+    QObject(parent)
+{
+    int intervalMs = DefaultRefreshIntervalMs;
+    bool ok = false;
+    const int intervalOverride = qEnvironmentVariableIntValue("POS_REPLICA_REFRESH_MS", &ok);
+    if (ok && intervalOverride >= ReplicaWorker::MinRefreshIntervalMs) intervalMs = intervalOverride;
+
+    m_worker = new ReplicaWorker(databasePath, replicaPath, intervalMs);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &ReplicaWorker::refreshed, this, &AnalyticsReplica::onRefreshed);
+    m_thread.setObjectName("AnalyticsReplica");
+    m_thread.start(QThread::LowPriority);
+
+    // The first refresh runs in the background like every later one; a full copy of a
+    // large store must not hold up the window. Until it lands, readers see the replica
+    // as the last run left it (or empty) and asOf() is invalid.
+    m_reader = new DatabaseManager("replica", replicaPath);
+    QMetaObject::invokeMethod(m_worker, &ReplicaWorker::start, Qt::QueuedConnection);
+}
+
+AnalyticsReplica::~AnalyticsReplica()
+{
+    QMetaObject::invokeMethod(m_worker, &ReplicaWorker::shutdown, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_reader;
+}
+
+DatabaseManager *AnalyticsReplica::database() const
+{
+    return m_reader;
+}
+
+QDateTime AnalyticsReplica::asOf() const
+{
+    return m_asOf;
+}
+
+qint64 AnalyticsReplica::lagMs() const
+{
+    return m_asOf.isValid() ? m_asOf.msecsTo(QDateTime::currentDateTime()) : -1;
+}
+
+void AnalyticsReplica::requestRefresh()
+{
+    QMetaObject::invokeMethod(m_worker, &ReplicaWorker::requestRefresh, Qt::QueuedConnection);
+}
+
+void AnalyticsReplica::onRefreshed(const QDateTime &asOf, bool changed)
+{
+    m_asOf = asOf;
+    emit refreshed(asOf, changed);
+}
@@ -0,0 +1,75 @@
+#ifndef ANALYTICSREPLICA_H
+#define ANALYTICSREPLICA_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QThread>
+
+class DatabaseManager;
+class QTimer;
+
+// Runs on the replica thread and refreshes the replica file from the store.
+class ReplicaWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MinRefreshIntervalMs = 1000;
+
+    ReplicaWorker(const QString &databasePath, const QString &replicaPath, int intervalMs, QObject *parent = nullptr);
+    ~ReplicaWorker();
+
+public slots:
+    void start();
+    void refresh();
+    void requestRefresh();
+    void shutdown();
+
+signals:
+    void refreshed(const QDateTime &asOf, bool changed);
+
+private:
+    QString m_databasePath;
+    QString m_replicaPath;
+    int m_intervalMs;
+    DatabaseManager *m_dbManager;
+    QTimer *m_timer;
+    qint64 m_dataVersion; // Store's data_version at the last refresh, -1 before the first
+};
+
+// A local read-only copy of store.db for reports and the dashboard, so their heavy
+// queries never hold locks on the file checkout writes to. The first refresh copies
+// the reporting tables; later refreshes append new sales by id and recopy the small
+// tables, each in one transaction. database() is a connection to the replica for the
+// UI thread. The first refresh also runs on the replica thread, so the replica can be
+// empty until refreshed() fires. Each lane keeps its own replica file. The refresh
+// period can be tuned with POS_REPLICA_REFRESH_MS.
+class AnalyticsReplica : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultRefreshIntervalMs = 5000;
+
+    AnalyticsReplica(const QString &databasePath, const QString &replicaPath, QObject *parent = nullptr);
+    ~AnalyticsReplica();
+
+    DatabaseManager *database() const;
+    QDateTime asOf() const; // When the replica last matched the store
+    qint64 lagMs() const;
+    void requestRefresh(); // Refresh soon, e.g. after sales were applied
+
+signals:
+    void refreshed(const QDateTime &asOf, bool changed); // changed: new data was copied
+
+private slots:
+    void onRefreshed(const QDateTime &asOf, bool changed);
+
+private:
+    QThread m_thread;
+    ReplicaWorker *m_worker;
+    DatabaseManager *m_reader;
+    QDateTime m_asOf;
+};
+
+#endif // ANALYTICSREPLICA_H
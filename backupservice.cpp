@@ -0,0 +1,231 @@
+#include "backupservice.h"
+#include "databasemanager.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTimer>
+
+BackupWorker::BackupWorker(const QString &databasePath, const QString &backupDir, int generations, int intervalMs,
+                           QObject *parent) :
+    QObject(parent),
+    m_databasePath(databasePath),
+    m_backupDir(backupDir),
+    m_generations(generations),
+    m_intervalMs(intervalMs),
+    m_dbManager(nullptr),
+    m_timer(nullptr),
+    m_lock(nullptr)
+{
+}
+
+BackupWorker::~BackupWorker()
+{
+    delete m_dbManager;
+    delete m_lock;
+}
+
+void BackupWorker::start()
+{
+    // Created here so the connection belongs to the backup thread
+    m_dbManager = new DatabaseManager("backup", m_databasePath);
+
+    QDir dir(m_backupDir);
+    if (!dir.mkpath(".")) {
+        qDebug() << "Error: failed to create backup directory" << m_backupDir;
+    }
+    m_lock = new QLockFile(dir.filePath("backup.lock"));
+    m_lock->setStaleLockTime(0); // Held for as long as the lane runs; only a dead owner frees it
+    elect();
+
+    m_timer = new QTimer(this);
+    m_timer->setInterval(m_intervalMs);
+    connect(m_timer, &QTimer::timeout, this, &BackupWorker::backupNow);
+    m_timer->start();
+}
+
+bool BackupWorker::elect()
+{
+    if (m_lock->isLocked()) {
+        return true;
+    }
+    if (!m_lock->tryLock(0)) {
+        return false; // Another lane writes the backups
+    }
+
+    // No other lane can be writing a snapshot now, so any part file is a leftover
+    // from a backup that was interrupted
+    qDebug() << "This lane now writes the backups in" << m_backupDir;
+    QDir dir(m_backupDir);
+    for (const QString &name : dir.entryList({ "*.part" }, QDir::Files)) {
+        dir.remove(name);
+    }
+    QDir archiveDir(dir.filePath("archive"));
+    for (const QString &name : archiveDir.entryList({ "*.part" }, QDir::Files)) {
+        archiveDir.remove(name);
+    }
+    return true;
+}
+
+void BackupWorker::backupNow()
+{
+    if (!m_dbManager) {
+        return; // Shut down
+    }
+    if (!elect()) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QDir dir(m_backupDir);
+    const QString name = QString("store-%1.db").arg(QDateTime::currentDateTimeUtc().toString("yyyyMMdd-HHmmss"));
+    const QString snapshotPath = dir.filePath(name);
+    const QString partPath = snapshotPath + ".part";
+
+    // The snapshot is a single read transaction on our own connection. In WAL mode
+    // that never blocks the checkout writers; they keep appending to the WAL while
+    // the copy sees the database as of the moment it started.
+    if (!m_dbManager->snapshotTo(partPath)) {
+        QFile::remove(partPath);
+        emit backupFailed(tr("Could not write snapshot %1").arg(name));
+        return;
+    }
+
+    QString problem;
+    if (!verifySnapshot(partPath, &problem)) {
+        QFile::remove(partPath);
+        emit backupFailed(tr("Snapshot %1 failed verification: %2").arg(name, problem));
+        return;
+    }
+    QFile::remove(snapshotPath);
+    if (!QFile::rename(partPath, snapshotPath)) {
+        QFile::remove(partPath);
+        emit backupFailed(tr("Could not finalise snapshot %1").arg(name));
+        return;
+    }
+
+    copyArchivePartitions();
+    rotate();
+
+    qDebug() << "Backup" << snapshotPath << "written and verified in" << timer.elapsed() << "ms";
+    emit backupFinished(snapshotPath, timer.elapsed());
+}
+
+bool BackupWorker::verifySnapshot(const QString &snapshotPath, QString *problem) const
+{
+    const QString connectionName = "backup-verify";
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(snapshotPath);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY");
+        if (!db.open()) {
+            *problem = db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            if (!query.exec("PRAGMA integrity_check;")) {
+                *problem = query.lastError().text();
+            } else if (query.next()) {
+                *problem = query.value(0).toString();
+                ok = (*problem == "ok");
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return ok;
+}
+
+void BackupWorker::copyArchivePartitions()
+{
+    // Archived months are written once, so copying the files is enough; a month
+    // is copied again only if it was re-archived since the last backup.
+    const QDir source(QFileInfo(m_databasePath).absoluteDir().filePath("archive"));
+    if (!source.exists()) {
+        return;
+    }
+    QDir target(QDir(m_backupDir).filePath("archive"));
+    if (!target.mkpath(".")) {
+        qDebug() << "Error: failed to create archive backup directory" << target.path();
+        return;
+    }
+
+    for (const QFileInfo &file : source.entryInfoList({ "sales-*.db" }, QDir::Files)) {
+        const QFileInfo copy(target.filePath(file.fileName()));
+        if (copy.exists() && copy.lastModified() >= file.lastModified()) {
+            continue;
+        }
+        const QString partPath = copy.filePath() + ".part";
+        QFile::remove(partPath);
+        if (!QFile::copy(file.filePath(), partPath)) {
+            qDebug() << "Error: failed to back up sales archive" << file.fileName();
+            continue;
+        }
+        QFile::remove(copy.filePath());
+        QFile::rename(partPath, copy.filePath());
+    }
+}
+
+void BackupWorker::rotate()
+{
+    // Timestamped names sort chronologically
+    QDir dir(m_backupDir);
+    const QStringList snapshots = dir.entryList({ "store-*.db" }, QDir::Files, QDir::Name | QDir::Reversed);
+    for (int i = m_generations; i < snapshots.size(); ++i) {
+        if (!dir.remove(snapshots.at(i))) {
+            qDebug() << "Error: failed to remove old backup" << snapshots.at(i);
+        }
+    }
+}
+
+void BackupWorker::shutdown()
+{
+    delete m_timer;
+    m_timer = nullptr;
+    delete m_dbManager;
+    m_dbManager = nullptr;
+    delete m_lock; // Unlocks, so another lane takes over on its next tick
+    m_lock = nullptr;
+}
+
+BackupService::BackupService(const QString &databasePath, const QString &backupDir, QObject *parent) :
+    QObject(parent)
+{
+    int intervalMinutes = DefaultIntervalMinutes;
+    int generations = DefaultGenerations;
+    bool ok = false;
+    const int intervalOverride = qEnvironmentVariableIntValue("POS_BACKUP_INTERVAL_MIN", &ok);
+    if (ok && intervalOverride > 0) intervalMinutes = intervalOverride;
+    const int generationsOverride = qEnvironmentVariableIntValue("POS_BACKUP_GENERATIONS", &ok);
+    if (ok && generationsOverride > 0) generations = generationsOverride;
+
+    m_worker = new BackupWorker(databasePath, backupDir, generations, intervalMinutes * 60 * 1000);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &BackupWorker::backupFinished, this, &BackupService::backupFinished);
+    connect(m_worker, &BackupWorker::backupFailed, this, &BackupService::backupFailed);
+    m_thread.setObjectName("BackupService");
+    m_thread.start(QThread::LowPriority);
+    QMetaObject::invokeMethod(m_worker, &BackupWorker::start, Qt::QueuedConnection);
+}
+
+BackupService::~BackupService()
+{
+    // Waits for a snapshot in progress to finish
+    QMetaObject::invokeMethod(m_worker, &BackupWorker::shutdown, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void BackupService::backupNow()
+{
+    QMetaObject::invokeMethod(m_worker, &BackupWorker::backupNow, Qt::QueuedConnection);
+}
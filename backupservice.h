@@ -0,0 +1,74 @@
+#ifndef BACKUPSERVICE_H
+#define BACKUPSERVICE_H
+
+#include <QObject>
+#include <QThread>
+
+class DatabaseManager;
+class QLockFile;
+class QTimer;
+
+// Runs on the backup thread with its own database connection.
+class BackupWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    BackupWorker(const QString &databasePath, const QString &backupDir, int generations, int intervalMs,
+                 QObject *parent = nullptr);
+    ~BackupWorker();
+
+public slots:
+    void start();
+    void backupNow();
+    void shutdown();
+
+signals:
+    void backupFinished(const QString &snapshotPath, qint64 elapsedMs);
+    void backupFailed(const QString &reason);
+
+private:
+    bool elect();
+    bool verifySnapshot(const QString &snapshotPath, QString *problem) const;
+    void copyArchivePartitions();
+    void rotate();
+
+    QString m_databasePath;
+    QString m_backupDir;
+    int m_generations;
+    int m_intervalMs;
+    DatabaseManager *m_dbManager;
+    QTimer *m_timer;
+    QLockFile *m_lock; // Held by the one lane on this host that writes backups
+};
+
+// Takes consistent snapshots of the store database on a schedule without stopping the
+// till. Each snapshot is written to backups/store-<UTC timestamp>.db, opened read-only
+// and integrity-checked before it counts; only the newest generations are kept.
+// Archived sales months are mirrored into backups/archive as they appear.
+// When several lanes share the directory, only the one holding backups/backup.lock
+// takes snapshots; the others try to take over on each tick.
+// The schedule can be tuned with POS_BACKUP_INTERVAL_MIN and POS_BACKUP_GENERATIONS.
+class BackupService : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultIntervalMinutes = 60;
+    static constexpr int DefaultGenerations = 7;
+
+    BackupService(const QString &databasePath, const QString &backupDir, QObject *parent = nullptr);
+    ~BackupService();
+
+    void backupNow();
+
+signals:
+    void backupFinished(const QString &snapshotPath, qint64 elapsedMs);
+    void backupFailed(const QString &reason);
+
+private:
+    QThread m_thread;
+    BackupWorker *m_worker;
+};
+
+#endif // BACKUPSERVICE_H
@@ -0,0 +1,286 @@
+#include "basketminer.h"
+#include "databasemanager.h"
+#include "readconnection.h"
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <QThread>
+#include <QVarLengthArray>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+struct IdRange {
+    qint64 first;
+    qint64 last;
+};
+
+// Pair counts from one sale-id range, complete up to countedTo
+struct Partial {
+    QHash<quint64, int> pairs;
+    qint64 countedTo = 0;
+    qint64 sales = 0;
+    qint64 items = 0;
+    bool ok = true;
+};
+
+int maxPairs()
+{
+    bool ok = false;
+    const int configured = qEnvironmentVariableIntValue("POS_MINING_MAX_PAIRS", &ok);
+    return (ok && configured > 0) ? configured : BasketMiner::DefaultMaxPairs;
+}
+
+void countBasket(QVarLengthArray<int, 32> &basket, QHash<quint64, int> &pairs)
+{
+    std::sort(basket.begin(), basket.end());
+    basket.erase(std::unique(basket.begin(), basket.end()), basket.end());
+    if (basket.size() > BasketMiner::MaxBasketProducts) {
+        return; // Thousands of pairs that say little about what goes together
+    }
+    for (int i = 0; i < basket.size(); ++i) {
+        for (int j = i + 1; j < basket.size(); ++j) {
+            ++pairs[(quint64(quint32(basket[i])) << 32) | quint32(basket[j])];
+        }
+    }
+}
+
+// The next sales after position in one database file: the ids of the first and last
+// of them (-1 when there are none) and how many there are
+bool nextSales(const QSqlDatabase &db, qint64 position, qint64 limit, qint64 *first, qint64 *last, qint64 *count)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT MIN(id), MAX(id), COUNT(*) FROM (SELECT id FROM Sales WHERE id > :position ORDER BY id LIMIT :limit)");
+    query.bindValue(":position", position);
+    query.bindValue(":limit", limit);
+    if (!query.exec() || !query.next()) {
+        qDebug() << "Error: failed to find sales for basket mining:" << query.lastError();
+        return false;
+    }
+    *first = query.isNull(0) ? -1 : query.value(0).toLongLong();
+    *last = query.isNull(1) ? -1 : query.value(1).toLongLong();
+    *count = query.value(2).toLongLong();
+    return true;
+}
+
+Partial countRange(const QString &databasePath, const QStringList &archives, const IdRange &range, int pairLimit)
+{
+    Partial partial;
+    partial.countedTo = range.first - 1;
+    ReadConnection connection(databasePath, "basket-miner");
+    QSqlQuery query(connection.database());
+    query.setForwardOnly(true);
+
+    // Archived sales in the range are read from their month files in the same pass.
+    // UNION: a month left half-moved by a crash has the same rows in both files.
+    auto items = [&range](const QString &schema) {
+        return QString("SELECT sale_id, product_id FROM %1.SaleItems WHERE sale_id BETWEEN %2 AND %3")
+            .arg(schema).arg(range.first).arg(range.last);
+    };
+    QStringList sources = { items("main") };
+    for (int i = 0; i < archives.size(); ++i) {
+        const QString alias = QString("archive%1").arg(i);
+        query.prepare(QString("ATTACH DATABASE :file AS %1").arg(alias));
+        query.bindValue(":file", archives.at(i));
+        if (!query.exec()) {
+            qDebug() << "Error: failed to attach sales archive for basket mining:" << query.lastError();
+            partial.ok = false;
+            return partial;
+        }
+        sources.append(items(alias));
+    }
+    if (!query.exec(sources.join(" UNION ") + " ORDER BY sale_id")) {
+        qDebug() << "Error: failed to read sale items for basket mining:" << query.lastError();
+        partial.ok = false;
+        return partial;
+    }
+
+    QVarLengthArray<int, 32> basket;
+    qint64 currentSale = -1;
+    while (query.next()) {
+        const qint64 saleId = query.value(0).toLongLong();
+        if (saleId != currentSale) {
+            if (currentSale >= 0) {
+                countBasket(basket, partial.pairs);
+                ++partial.sales;
+                partial.countedTo = currentSale;
+                if (partial.pairs.size() >= pairLimit) {
+                    return partial; // Full; the rest of the range waits for a later round
+                }
+            }
+            basket.clear();
+            currentSale = saleId;
+        }
+        basket.append(query.value(1).toInt());
+        ++partial.items;
+    }
+    if (currentSale >= 0) {
+        countBasket(basket, partial.pairs);
+        ++partial.sales;
+    }
+    partial.countedTo = range.last;
+    return partial;
+}
+
+} // namespace
+
+MiningStats BasketMiner::mine(DatabaseManager *dbManager, qint64 maxSales)
+{
+    MiningStats stats;
+    const QString databasePath = dbManager->getDatabase().databaseName();
+    const int pairCap = maxPairs();
+    qint64 position = dbManager->basketMiningPosition();
+    if (position < 0) {
+        stats.ok = false;
+        return stats;
+    }
+    stats.lastSaleId = position;
+
+    qint64 roundSales = InitialRoundSales;
+    while (maxSales <= 0 || stats.sales < maxSales) {
+        const qint64 wanted = maxSales > 0 ? qMin(roundSales, maxSales - stats.sales) : roundSales;
+
+        // The next sales after the position; ids of deleted sales leave gaps. Months
+        // archived before they were counted still have sales after it, read from
+        // their files. The round ends at the earliest of each file's next sales.
+        QList<IdRange> ranges;
+        QStringList archives;
+        {
+            qint64 mainFirst = -1;
+            qint64 last = -1;
+            qint64 count = 0;
+            if (!nextSales(dbManager->getDatabase(), position, wanted, &mainFirst, &last, &count)) {
+                stats.ok = false;
+                return stats;
+            }
+            QList<QPair<qint64, QString>> candidates; // First sale id after position, archive file
+            QSqlQuery query(dbManager->getDatabase());
+            query.prepare("SELECT file FROM SalesPartitions WHERE max_sale_id > :position");
+            query.bindValue(":position", position);
+            if (!query.exec()) {
+                qDebug() << "Error: failed to find sales archives for basket mining:" << query.lastError();
+                stats.ok = false;
+                return stats;
+            }
+            while (query.next()) {
+                const QString path = QFileInfo(databasePath).absoluteDir().filePath(query.value(0).toString());
+                ReadConnection connection(path, "basket-miner");
+                qint64 archiveFirst = -1;
+                qint64 archiveLast = -1;
+                qint64 archiveCount = 0;
+                if (!nextSales(connection.database(), position, wanted, &archiveFirst, &archiveLast, &archiveCount)) {
+                    stats.ok = false;
+                    return stats;
+                }
+                if (archiveLast >= 0) {
+                    candidates.append({ archiveFirst, path });
+                    last = last < 0 ? archiveLast : qMin(last, archiveLast);
+                    count = qMax(count, archiveCount);
+                }
+            }
+            if (last < 0) {
+                stats.caughtUp = true;
+                return stats;
+            }
+            // Only so many files can be attached at once. When more overlap the round (sync
+            // spreads new ids over old months), end it before the first file that doesn't
+            // fit; sale ids are unique across the files, so the round is never empty.
+            std::sort(candidates.begin(), candidates.end());
+            if (candidates.size() > MaxArchivesPerRound && candidates[MaxArchivesPerRound].first <= last) {
+                last = candidates[MaxArchivesPerRound].first - 1;
+            }
+            for (const auto &candidate : std::as_const(candidates)) {
+                if (candidate.first <= last) {
+                    archives.append(candidate.second);
+                }
+            }
+            const qint64 first = position + 1;
+            const int partitions = int(qBound<qint64>(1, count / MinSalesPerPartition, qMax(1, QThread::idealThreadCount())));
+            const qint64 span = (last - first) / partitions + 1;
+            for (qint64 from = first; from <= last; from += span) {
+                ranges.append({ from, qMin(last, from + span - 1) });
+            }
+        }
+
+        const int pairLimit = qMax(1, pairCap / int(ranges.size()));
+        QList<Partial> partials = QtConcurrent::blockingMapped<QList<Partial>>(
+            ranges, [databasePath, archives, pairLimit](const IdRange &range) {
+                return countRange(databasePath, archives, range, pairLimit);
+            });
+
+        // Keep the ranges counted without a gap; a range that stopped early ends the round
+        QHash<quint64, int> pairs = std::move(partials[0].pairs);
+        qint64 countedTo = position;
+        qint64 countedSales = 0;
+        qint64 countedItems = 0;
+        bool cut = false;
+        for (int i = 0; i < partials.size(); ++i) {
+            Partial &partial = partials[i];
+            if (!partial.ok) {
+                stats.ok = false;
+                return stats;
+            }
+            if (i > 0) {
+                for (auto it = partial.pairs.constBegin(); it != partial.pairs.constEnd(); ++it) {
+                    pairs[it.key()] += it.value();
+                }
+                partial.pairs = QHash<quint64, int>(); // Give the memory back as we go
+            }
+            countedSales += partial.sales;
+            countedItems += partial.items;
+            countedTo = partial.countedTo;
+            if (partial.countedTo < ranges.at(i).last) {
+                cut = true;
+                break;
+            }
+        }
+
+        bool superseded = false;
+        if (!dbManager->storeProductPairs(pairs, position, countedTo, Neighbours, &superseded)) {
+            stats.ok = false;
+            return stats;
+        }
+        if (superseded) {
+            // Another miner stored these sales first; carry on from where it got to
+            position = dbManager->basketMiningPosition();
+            if (position < 0) {
+                stats.ok = false;
+                return stats;
+            }
+            stats.lastSaleId = position;
+            continue;
+        }
+        stats.sales += countedSales;
+        stats.items += countedItems;
+        stats.pairs += pairs.size();
+        stats.lastSaleId = position = countedTo;
+        if (cut) {
+            roundSales = qMax<qint64>(MinSalesPerPartition, roundSales / 2);
+        }
+    }
+    return stats;
+}
+
+int runBasketMining(const QString &databasePath)
+{
+    QTextStream out(stdout);
+    DatabaseManager dbManager("basket-mining", databasePath);
+    dbManager.init();
+
+    QElapsedTimer timer;
+    timer.start();
+    const MiningStats stats = BasketMiner::mine(&dbManager);
+    if (!stats.ok) {
+        out << "Basket mining failed after " << stats.sales << " sale(s); run it again to resume\n";
+        return 1;
+    }
+    out << "Counted " << stats.sales << " sale(s) with " << stats.items << " item(s) in "
+        << timer.elapsed() << " ms; " << stats.pairs << " pair(s) written, up to sale " << stats.lastSaleId << "\n";
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef BASKETMINER_H
+#define BASKETMINER_H
+
+#include <QString>
+
+class DatabaseManager;
+
+// Results of one BasketMiner::mine() call
+struct MiningStats {
+    bool ok = true;
+    bool caughtUp = false;  // Every sale so far has been counted
+    qint64 sales = 0;       // Sales counted by this call
+    qint64 items = 0;       // Their line items
+    qint64 pairs = 0;       // Distinct pairs written (per round, so a pair can count twice)
+    qint64 lastSaleId = 0;  // Position after this call
+};
+
+// Counts which products are bought together, from SaleItems and the months already
+// moved to archive files. Works forward from the last sale counted in rounds: each
+// round's sale-id range is split across pool threads, and each thread counts pairs
+// in its own sparse hash on its own read-only connection. A thread whose hash
+// reaches its share of the memory cap stops at a sale boundary. The round keeps the
+// ranges counted without a gap and the next round is made smaller. Each round adds
+// its counts and rebuilds the top neighbours of the products it touched in one
+// transaction, so an interrupted run loses nothing; a round that another miner
+// stored first is dropped. Blocking; run it off the UI thread.
+class BasketMiner
+{
+public:
+    static constexpr int Neighbours = 5; // Kept per product
+    static constexpr int MaxBasketProducts = 64; // Larger baskets are restocks, not shopping
+    static constexpr int DefaultMaxPairs = 2000000; // Memory cap (about 64 MB); POS_MINING_MAX_PAIRS
+    static constexpr qint64 InitialRoundSales = 200000;
+    static constexpr int MinSalesPerPartition = 5000;
+    static constexpr int MaxArchivesPerRound = 8; // Attached on each connection; SQLite allows 10
+
+    // Counts up to maxSales new sales (0: all of them) into dbManager's database
+    static MiningStats mine(DatabaseManager *dbManager, qint64 maxSales = 0);
+};
+
+// Brings the frequently-bought-together tables up to date and prints what was done.
+// Returns a process exit code. Started with --mine-baskets.
+int runBasketMining(const QString &databasePath);
+
+#endif // BASKETMINER_H
@@ -0,0 +1,160 @@
+#include "bulkpricedialog.h"
+#include "databasemanager.h"
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QStandardItemModel>
+#include <QTableView>
+#include <QVBoxLayout>
+
+BulkPriceDialog::BulkPriceDialog(DatabaseManager *dbManager, const QList<Product> &products, QWidget *parent) :
+    QDialog(parent),
+    m_dbManager(dbManager),
+    m_products(products),
+    m_changed(0)
+{
+    setWindowTitle(tr("Bulk Price Update"));
+    resize(720, 620);
+
+    m_nameEdit = new QLineEdit(this);
+    m_nameEdit->setPlaceholderText(tr("All products (* and ? are wildcards)"));
+    m_minPriceSpin = new QDoubleSpinBox(this);
+    m_minPriceSpin->setRange(0.0, 1000000.0);
+    m_minPriceSpin->setPrefix("$");
+    m_maxPriceSpin = new QDoubleSpinBox(this);
+    m_maxPriceSpin->setRange(0.0, 1000000.0);
+    m_maxPriceSpin->setPrefix("$");
+    m_maxPriceSpin->setSpecialValueText(tr("No limit"));
+    m_stockCombo = new QComboBox(this);
+    m_stockCombo->addItems({tr("Any stock"), tr("In stock"), tr("Out of stock")});
+    m_changeCombo = new QComboBox(this);
+    m_changeCombo->addItems({tr("Percent"), tr("Amount")});
+    m_amountSpin = new QDoubleSpinBox(this);
+    m_amountSpin->setRange(PriceRule::MinPercent, PriceRule::MaxPercent);
+    m_amountSpin->setSuffix("%");
+    m_roundingCombo = new QComboBox(this);
+    m_roundingCombo->addItems({tr("Nearest cent"), tr("Nearest 5 cents"), tr("Nearest dollar"), tr("Up to .99")});
+
+    auto *priceLayout = new QHBoxLayout;
+    priceLayout->addWidget(m_minPriceSpin);
+    priceLayout->addWidget(new QLabel(tr("to"), this));
+    priceLayout->addWidget(m_maxPriceSpin);
+    auto *changeLayout = new QHBoxLayout;
+    changeLayout->addWidget(m_changeCombo);
+    changeLayout->addWidget(m_amountSpin, 1);
+    auto *form = new QFormLayout;
+    form->addRow(tr("Name contains:"), m_nameEdit);
+    form->addRow(tr("Price between:"), priceLayout);
+    form->addRow(tr("Stock:"), m_stockCombo);
+    form->addRow(tr("Change by:"), changeLayout);
+    form->addRow(tr("Rounding:"), m_roundingCombo);
+
+    m_model = new QStandardItemModel(0, 4, this);
+    m_model->setHorizontalHeaderLabels({tr("Product"), tr("Current"), tr("New"), tr("Change")});
+    auto *view = new QTableView(this);
+    view->setModel(m_model);
+    view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    view->verticalHeader()->hide();
+    view->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    view->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    m_summaryLabel = new QLabel(this);
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Cancel, this);
+    m_applyButton = buttons->addButton(tr("Apply"), QDialogButtonBox::AcceptRole);
+
+    auto *layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addWidget(view);
+    layout->addWidget(m_summaryLabel);
+    layout->addWidget(buttons);
+
+    connect(m_nameEdit, &QLineEdit::textChanged, this, &BulkPriceDialog::updatePreview);
+    connect(m_minPriceSpin, &QDoubleSpinBox::valueChanged, this, &BulkPriceDialog::updatePreview);
+    connect(m_maxPriceSpin, &QDoubleSpinBox::valueChanged, this, &BulkPriceDialog::updatePreview);
+    connect(m_stockCombo, &QComboBox::currentIndexChanged, this, &BulkPriceDialog::updatePreview);
+    connect(m_changeCombo, &QComboBox::currentIndexChanged, this, [this](int index) {
+        if (index == PriceRule::Percent) {
+            m_amountSpin->setRange(PriceRule::MinPercent, PriceRule::MaxPercent);
+        } else {
+            m_amountSpin->setRange(-PriceRule::MaxAmount, PriceRule::MaxAmount);
+        }
+        m_amountSpin->setSuffix(index == PriceRule::Percent ? "%" : QString());
+        m_amountSpin->setPrefix(index == PriceRule::Amount ? "$" : QString());
+        updatePreview();
+    });
+    connect(m_amountSpin, &QDoubleSpinBox::valueChanged, this, &BulkPriceDialog::updatePreview);
+    connect(m_roundingCombo, &QComboBox::currentIndexChanged, this, &BulkPriceDialog::updatePreview);
+    connect(buttons, &QDialogButtonBox::accepted, this, &BulkPriceDialog::apply);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    updatePreview();
+}
+
+PriceRule BulkPriceDialog::rule() const
+{
+    PriceRule rule;
+    rule.namePattern = m_nameEdit->text().trimmed();
+    rule.minPrice = m_minPriceSpin->value();
+    rule.maxPrice = m_maxPriceSpin->value();
+    rule.stock = static_cast<PriceRule::StockFilter>(m_stockCombo->currentIndex());
+    rule.change = static_cast<PriceRule::Change>(m_changeCombo->currentIndex());
+    rule.amount = m_amountSpin->value();
+    rule.rounding = static_cast<PriceRule::Rounding>(m_roundingCombo->currentIndex());
+    return rule;
+}
+
+void BulkPriceDialog::updatePreview()
+{
+    m_preview = rule().preview(m_products);
+
+    // Refilled in one pass; the rows are built before the view lays them out
+    m_model->setRowCount(0);
+    m_model->setRowCount(m_preview.size());
+    double before = 0.0;
+    double after = 0.0;
+    for (int row = 0; row < m_preview.size(); ++row) {
+        const PriceChange &change = m_preview.at(row);
+        const double difference = change.newPrice - change.oldPrice;
+        m_model->setItem(row, 0, new QStandardItem(change.name));
+        m_model->setItem(row, 1, new QStandardItem(QString::number(change.oldPrice, 'f', 2)));
+        m_model->setItem(row, 2, new QStandardItem(QString::number(change.newPrice, 'f', 2)));
+        m_model->setItem(row, 3, new QStandardItem((difference > 0 ? "+" : "") + QString::number(difference, 'f', 2)));
+        for (int column = 1; column < 4; ++column) {
+            m_model->item(row, column)->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        before += change.oldPrice;
+        after += change.newPrice;
+    }
+
+    m_applyButton->setEnabled(!m_preview.isEmpty());
+    if (m_preview.isEmpty()) {
+        m_summaryLabel->setText(tr("No prices change"));
+    } else {
+        const double percent = before > 0.0 ? (after - before) / before * 100.0 : 0.0;
+        m_summaryLabel->setText(tr("%1 of %2 product(s) change, %3%4% on average")
+                                    .arg(m_preview.size()).arg(m_products.size())
+                                    .arg(percent > 0 ? QString("+") : QString()).arg(percent, 0, 'f', 1));
+    }
+}
+
+void BulkPriceDialog::apply()
+{
+    if (m_preview.isEmpty()) return;
+
+    const auto answer = QMessageBox::question(this, tr("Bulk Price Update"),
+                                              tr("Change the price of %n product(s)?", nullptr, int(m_preview.size())),
+                                              QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+    if (answer != QMessageBox::Yes) return;
+
+    if (!m_dbManager->setProductPrices(m_preview, &m_changed)) {
+        QMessageBox::warning(this, tr("Error"), tr("The prices could not be updated; nothing was changed."));
+        return;
+    }
+    accept();
+}
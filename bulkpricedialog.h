@@ -0,0 +1,49 @@
+#ifndef BULKPRICEDIALOG_H
+#define BULKPRICEDIALOG_H
+
+#include <QDialog>
+#include "bulkpricing.h"
+
+class DatabaseManager;
+class QComboBox;
+class QDoubleSpinBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QStandardItemModel;
+
+// Bulk repricing: a PriceRule built from filters (name, price band, stock) and a
+// change (percentage or amount, then rounding). The preview is recomputed in memory
+// from the catalog as the rule is edited; Apply writes the previewed prices in one
+// transaction.
+class BulkPriceDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    BulkPriceDialog(DatabaseManager *dbManager, const QList<Product> &products, QWidget *parent = nullptr);
+
+    int changedProducts() const { return m_changed; } // After the prices were applied
+
+private:
+    PriceRule rule() const;
+    void updatePreview();
+    void apply();
+
+    DatabaseManager *m_dbManager;
+    QList<Product> m_products; // Catalog as of opening
+    QList<PriceChange> m_preview;
+    QLineEdit *m_nameEdit;
+    QDoubleSpinBox *m_minPriceSpin;
+    QDoubleSpinBox *m_maxPriceSpin;
+    QComboBox *m_stockCombo;
+    QComboBox *m_changeCombo;
+    QDoubleSpinBox *m_amountSpin;
+    QComboBox *m_roundingCombo;
+    QStandardItemModel *m_model;
+    QLabel *m_summaryLabel;
+    QPushButton *m_applyButton;
+    int m_changed;
+};
+
+#endif // BULKPRICEDIALOG_H
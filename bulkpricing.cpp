@@ -0,0 +1,46 @@
+#include "bulkpricing.h"
+#include <QRegularExpression>
+#include <algorithm>
+#include <cmath>
+
+double PriceRule::apply(double price) const
+{
+    const double percent = std::clamp(amount, MinPercent, MaxPercent);
+    double result = (change == Percent) ? price * (1.0 + percent / 100.0) : price + amount;
+    switch (rounding) {
+    case RoundCents:
+        result = std::round(result * 100.0) / 100.0;
+        break;
+    case RoundNickel:
+        result = std::round(result * 20.0) / 20.0;
+        break;
+    case RoundDollar:
+        result = std::round(result);
+        break;
+    case EndIn99:
+        result = std::ceil(result) - 0.01; // Up to the next x.99
+        break;
+    }
+    return std::max(result, 0.01);
+}
+
+QList<PriceChange> PriceRule::preview(const QList<Product> &products) const
+{
+    const QRegularExpression name = namePattern.isEmpty()
+        ? QRegularExpression()
+        : QRegularExpression(QRegularExpression::wildcardToRegularExpression(namePattern, QRegularExpression::UnanchoredWildcardConversion),
+                             QRegularExpression::CaseInsensitiveOption);
+
+    QList<PriceChange> changes;
+    for (const Product &product : products) {
+        if (product.price < minPrice || (maxPrice > 0.0 && product.price > maxPrice)) continue;
+        if ((stock == InStock && product.quantity <= 0) || (stock == OutOfStock && product.quantity > 0)) continue;
+        if (!namePattern.isEmpty() && !name.match(product.name).hasMatch()) continue;
+
+        const double newPrice = apply(product.price);
+        if (std::abs(newPrice - product.price) >= 0.005) {
+            changes.append({ product.id, product.name, product.price, newPrice });
+        }
+    }
+    return changes;
+}
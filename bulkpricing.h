@@ -0,0 +1,41 @@
+#ifndef BULKPRICING_H
+#define BULKPRICING_H
+
+#include <QList>
+#include <QString>
+#include "product.h"
+
+// One product's price before and after a repricing
+struct PriceChange {
+    int productId;
+    QString name;
+    double oldPrice;
+    double newPrice;
+};
+
+// A bulk repricing: which products it applies to and how their prices change.
+// Worked out in memory against the catalog for the preview; only the resulting
+// prices go to the database (DatabaseManager::setProductPrices).
+struct PriceRule {
+    enum Change { Percent, Amount };
+    enum Rounding { RoundCents, RoundNickel, RoundDollar, EndIn99 };
+    enum StockFilter { AnyStock, InStock, OutOfStock };
+
+    // A cut of 100% or more would take every matched price to the one-cent floor
+    static constexpr double MinPercent = -99.0;
+    static constexpr double MaxPercent = 1000.0;
+    static constexpr double MaxAmount = 100000.0;
+
+    QString namePattern;   // Found anywhere in the name, any case; * and ? are wildcards
+    double minPrice = 0.0;
+    double maxPrice = 0.0; // 0: no upper limit
+    StockFilter stock = AnyStock;
+    Change change = Percent;
+    double amount = 0.0;   // Percent or currency, negative to lower prices
+    Rounding rounding = RoundCents;
+
+    double apply(double price) const; // Never below one cent
+    QList<PriceChange> preview(const QList<Product> &products) const; // Products whose price would change
+};
+
+#endif // BULKPRICING_H
@@ -8,6 +8,7 @@ struct CartItem {
     QString name;
     double price;
     int quantity;
+    double discount = 0.0; // Off the whole line, set when the sale is completed
 };
 
 #endif // CARTITEM_H
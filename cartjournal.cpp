@@ -0,0 +1,248 @@
+#include "cartjournal.h"
+#include <QDebug>
+#include <QtEndian>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifndef Q_OS_WIN
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+const quint32 FileMagic = 0x314A4350; // "PCJ1"
+const int HeaderSize = 64;
+}
+
+// Slots are written with plain stores into the mapping; the checksum is written last
+// so a slot torn by a crash mid-write fails validation and is ignored on recovery.
+struct CartJournal::Slot {
+    quint64 seq;
+    quint32 op;
+    qint32 productId;
+    qint32 quantity;
+    quint32 checksum;
+};
+
+namespace {
+quint32 checksumOf(quint64 seq, quint32 op, qint32 productId, qint32 quantity)
+{
+    // FNV-1a over the payload fields; enough to reject torn or zeroed slots
+    quint32 hash = 2166136261u;
+    auto mix = [&hash](const void *data, size_t size) {
+        const uchar *bytes = static_cast<const uchar *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    mix(&seq, sizeof(seq));
+    mix(&op, sizeof(op));
+    mix(&productId, sizeof(productId));
+    mix(&quantity, sizeof(quantity));
+    return hash == 0 ? 1 : hash; // Zero is reserved for never-written slots
+}
+}
+
+CartJournal::CartJournal() :
+    m_map(nullptr),
+    m_size(0),
+    m_nextSeq(1),
+    m_lastClearSeq(0)
+{
+}
+
+CartJournal::~CartJournal()
+{
+    close();
+}
+
+QMap<int, int> CartJournal::open(const QString &path)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Error: failed to open cart journal" << path << ":" << m_file.errorString();
+        return {};
+    }
+
+    // A ring that has grown keeps its size; recovery finds slots by sequence, not position
+    const bool fresh = m_file.size() < FileSize;
+    if (fresh && !m_file.resize(FileSize)) {
+        qDebug() << "Error: failed to size cart journal:" << m_file.errorString();
+        m_file.close();
+        return {};
+    }
+    m_size = m_file.size();
+
+    m_map = m_file.map(0, m_size);
+    if (!m_map) {
+        qDebug() << "Error: failed to map cart journal:" << m_file.errorString();
+        m_file.close();
+        return {};
+    }
+
+    if (fresh || qFromLittleEndian<quint32>(m_map) != FileMagic) {
+        std::memset(m_map, 0, m_size);
+        qToLittleEndian<quint32>(FileMagic, m_map);
+        return {};
+    }
+
+    // Collect every intact slot, then replay the ones after the most recent clear
+    std::vector<Slot> slots;
+    for (int i = 0; i < slotCount(); ++i) {
+        Slot slot;
+        std::memcpy(&slot, m_map + HeaderSize + i * sizeof(Slot), sizeof(Slot));
+        if (slot.checksum != 0 && slot.checksum == checksumOf(slot.seq, slot.op, slot.productId, slot.quantity)) {
+            slots.push_back(slot);
+        }
+    }
+    std::sort(slots.begin(), slots.end(), [](const Slot &a, const Slot &b) { return a.seq < b.seq; });
+
+    for (const Slot &slot : slots) {
+        if (slot.op == OpClear) {
+            m_lines.clear();
+            m_lastClearSeq = slot.seq;
+        } else if (slot.op == OpSetQuantity) {
+            if (slot.quantity > 0) {
+                m_lines[slot.productId] = slot.quantity;
+            } else {
+                m_lines.remove(slot.productId);
+            }
+        }
+        m_nextSeq = slot.seq + 1;
+    }
+
+    if (!m_lines.isEmpty()) {
+        qDebug() << "Cart journal: restoring basket with" << m_lines.size() << "line(s)";
+    }
+    return m_lines;
+}
+
+void CartJournal::close()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+    m_size = 0;
+    m_lines.clear();
+    m_nextSeq = 1;
+    m_lastClearSeq = 0;
+}
+
+void CartJournal::setQuantity(int productId, int quantity)
+{
+    if (quantity > 0) {
+        m_lines[productId] = quantity;
+    } else {
+        m_lines.remove(productId);
+    }
+    write(OpSetQuantity, productId, quantity);
+}
+
+void CartJournal::clear()
+{
+    m_lines.clear();
+    write(OpClear, 0, 0);
+}
+
+void CartJournal::write(Op op, int productId, int quantity)
+{
+    if (!m_map) {
+        return;
+    }
+
+    // Never let the ring overwrite the current basket's clear marker: once the basket's
+    // records would wrap, rewrite it compactly after a fresh clear. A basket that fills
+    // half the ring would compact on nearly every write, so the ring grows first.
+    if (op == OpSetQuantity && m_nextSeq - m_lastClearSeq >= quint64(slotCount() - 1)) {
+        if (m_lines.size() >= slotCount() / 2 && !grow()) {
+            if (!m_map) {
+                return;
+            }
+            if (m_lines.size() + 1 >= slotCount()) {
+                qDebug() << "Error: cart journal is full, basket line for product" << productId << "not recorded";
+                return;
+            }
+        }
+        compact();
+    }
+
+    const quint64 seq = m_nextSeq++;
+    Slot *slot = writeSlot(seq, op, productId, quantity);
+    if (op == OpClear) {
+        m_lastClearSeq = seq;
+    }
+
+#ifndef Q_OS_WIN
+    // Schedule write-back without waiting for it; a process crash is already covered
+    // by the page cache, this narrows the window for power loss.
+    static const quintptr pageSize = quintptr(::sysconf(_SC_PAGESIZE));
+    const quintptr slotStart = reinterpret_cast<quintptr>(slot);
+    const quintptr page = slotStart & ~(pageSize - 1);
+    if (::msync(reinterpret_cast<void *>(page), slotStart + sizeof(Slot) - page, MS_ASYNC) != 0) {
+        qDebug() << "Error: cart journal msync failed:" << qt_error_string(errno);
+    }
+#else
+    Q_UNUSED(slot)
+#endif
+}
+
+void CartJournal::compact()
+{
+    m_lastClearSeq = m_nextSeq++;
+    writeSlot(m_lastClearSeq, OpClear, 0, 0);
+    for (auto it = m_lines.constBegin(); it != m_lines.constEnd(); ++it) {
+        writeSlot(m_nextSeq++, OpSetQuantity, it.key(), it.value());
+    }
+}
+
+bool CartJournal::grow()
+{
+    // The new half reads as never-written slots, and slots already in the file stay
+    // valid wherever they are, so a crash part way through loses nothing
+    const qint64 size = m_size * 2;
+    m_file.unmap(m_map);
+    m_map = nullptr;
+    const bool resized = m_file.resize(size);
+    if (resized) {
+        m_size = size;
+    } else {
+        qDebug() << "Error: failed to grow cart journal:" << m_file.errorString();
+    }
+
+    m_map = m_file.map(0, m_size);
+    if (!m_map) {
+        qDebug() << "Error: failed to map cart journal:" << m_file.errorString();
+        m_file.close();
+        return false;
+    }
+    return resized;
+}
+
+CartJournal::Slot *CartJournal::writeSlot(quint64 seq, Op op, int productId, int quantity)
+{
+    Slot *slot = slotAt(seq);
+    slot->checksum = 0; // Invalidate first so a torn write is never mistaken for a good slot
+    slot->seq = seq;
+    slot->op = op;
+    slot->productId = productId;
+    slot->quantity = quantity;
+    slot->checksum = checksumOf(seq, op, productId, quantity);
+    return slot;
+}
+
+int CartJournal::slotCount() const
+{
+    return int((m_size - HeaderSize) / sizeof(Slot));
+}
+
+CartJournal::Slot *CartJournal::slotAt(quint64 seq) const
+{
+    return reinterpret_cast<Slot *>(m_map + HeaderSize + (seq % quint64(slotCount())) * sizeof(Slot));
+}
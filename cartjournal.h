@@ -0,0 +1,51 @@
+#ifndef CARTJOURNAL_H
+#define CARTJOURNAL_H
+
+#include <QFile>
+#include <QMap>
+#include <QString>
+
+// Crash-recoverable record of the basket being built at one lane. Every cart mutation
+// is written as a fixed-size, checksummed slot into a small memory-mapped ring file,
+// so a scan costs a memcpy rather than a database round trip. After a crash the
+// in-progress basket is rebuilt from the slots written since the last clear().
+// The ring doubles in size when a basket would no longer fit in half of it.
+class CartJournal
+{
+public:
+    static constexpr qint64 FileSize = 64 * 1024; // Initial size of the ring file
+
+    CartJournal();
+    ~CartJournal();
+
+    // Maps the ring file and returns the basket that was in progress (product id -> quantity).
+    QMap<int, int> open(const QString &path);
+    void close();
+
+    void setQuantity(int productId, int quantity); // 0 removes the line
+    void clear(); // Basket completed or cancelled
+
+private:
+    enum Op : quint32 {
+        OpSetQuantity = 1,
+        OpClear = 2
+    };
+
+    struct Slot; // On-disk layout, see cartjournal.cpp
+
+    void write(Op op, int productId, int quantity);
+    Slot *writeSlot(quint64 seq, Op op, int productId, int quantity);
+    void compact();
+    bool grow();
+    int slotCount() const;
+    Slot *slotAt(quint64 seq) const;
+
+    QFile m_file;
+    uchar *m_map;
+    qint64 m_size; // Mapped size of the ring file
+    quint64 m_nextSeq;
+    quint64 m_lastClearSeq;
+    QMap<int, int> m_lines; // Mirror of the basket, used to compact before the ring wraps
+};
+
+#endif // CARTJOURNAL_H
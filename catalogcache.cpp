@@ -0,0 +1,333 @@
+#include "catalogcache.h"
+#include "databasemanager.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <cstring>
+#include <utility>
+
+namespace {
+constexpr quint32 Magic = 0x43534f50; // "POSC"
+constexpr int UuidBytes = 32;
+constexpr int NameBytes = 128;
+constexpr int ImagePathBytes = 256;
+constexpr int MaxReadAttempts = 1000;
+
+QByteArray uuidKey(const QString &uuid)
+{
+    return uuid.toLatin1().leftJustified(UuidBytes, '\0', true);
+}
+
+bool putText(char *field, int capacity, const QString &text, quint16 *length)
+{
+    const QByteArray utf8 = text.toUtf8();
+    if (utf8.size() > capacity) {
+        return false;
+    }
+    std::memcpy(field, utf8.constData(), utf8.size());
+    *length = quint16(utf8.size());
+    return true;
+}
+}
+
+// Lives at the start of the segment; the entries follow it
+struct CatalogCache::Header {
+    quint32 magic; // Zero until the first lane has filled the segment
+    quint32 entrySize; // Lanes built with another layout leave the segment alone
+    std::atomic<quint64> sequence; // Odd while a writer is updating the segment
+    quint32 epoch; // Bumped whenever the segment is rebuilt from scratch
+    qint32 capacity;
+    qint32 count;
+    quint32 overflow; // The catalog did not fit
+    qint64 logSeq; // ChangeLog position the segment reflects
+};
+
+struct CatalogCache::Entry {
+    quint64 sequence; // Segment sequence that last wrote this entry
+    qint32 id;
+    qint32 quantity;
+    double price;
+    quint8 removed;
+    quint8 oversized; // Name or image path too long for the entry; read from the database
+    quint16 nameLength;
+    quint16 imagePathLength;
+    char uuid[UuidBytes];
+    char name[NameBytes];
+    char imagePath[ImagePathBytes];
+};
+
+static_assert(std::atomic<quint64>::is_always_lock_free, "the shared sequence counter must be lock-free");
+
+CatalogCache::CatalogCache(const QString &databasePath, QObject *parent) :
+    QObject(parent),
+    m_dbManager(new DatabaseManager("catalog-cache", databasePath)),
+    m_shared(false),
+    m_timer(new QTimer(this)),
+    m_dataVersion(-1),
+    m_seenSequence(0),
+    m_seenEpoch(0)
+{
+    // One segment per database file, whichever directory the lane was started from
+    const QByteArray path = QFileInfo(databasePath).absoluteFilePath().toUtf8();
+    m_segment.setKey("pos-catalog-" + QCryptographicHash::hash(path, QCryptographicHash::Sha1).toHex().left(16));
+    m_shared = attachSegment();
+
+    if (m_shared) {
+        m_dataVersion = m_dbManager->dataVersion();
+        catchUp(); // Fills a new segment, or one left behind by lanes that have exited
+        std::vector<Entry> entries;
+        readSegment(&entries, &m_seenSequence, &m_seenEpoch); // Callers start from products()
+    }
+
+    int intervalMs = DefaultPollIntervalMs;
+    bool ok = false;
+    const int intervalOverride = qEnvironmentVariableIntValue("POS_CATALOG_POLL_MS", &ok);
+    if (ok && intervalOverride > 0) intervalMs = intervalOverride;
+    m_timer->setInterval(intervalMs);
+    connect(m_timer, &QTimer::timeout, this, &CatalogCache::refresh);
+    if (m_shared) {
+        m_timer->start();
+    }
+}
+
+CatalogCache::~CatalogCache()
+{
+    delete m_dbManager;
+}
+
+bool CatalogCache::isShared() const
+{
+    return m_shared;
+}
+
+CatalogCache::Header *CatalogCache::header() const
+{
+    return static_cast<Header *>(const_cast<void *>(m_segment.constData()));
+}
+
+bool CatalogCache::attachSegment()
+{
+    if (!m_segment.attach()) {
+        // Memory from create() is zero-filled, i.e. an empty segment with magic 0
+        const qsizetype size = sizeof(Header) + qsizetype(DefaultCapacity) * sizeof(Entry);
+        if (!m_segment.create(size) && !(m_segment.error() == QSharedMemory::AlreadyExists && m_segment.attach())) {
+            qDebug() << "Catalog cache: shared memory unavailable, reading the database instead:" << m_segment.errorString();
+            return false;
+        }
+    }
+    const Header *h = header();
+    if (m_segment.size() < qsizetype(sizeof(Header)) || (h->magic == Magic && h->entrySize != sizeof(Entry))) {
+        qDebug() << "Catalog cache: segment has an unexpected layout, reading the database instead";
+        m_segment.detach();
+        return false;
+    }
+    return true;
+}
+
+void CatalogCache::refresh()
+{
+    if (!m_shared) return;
+
+    // data_version only moves when another connection (any lane, or this lane's own
+    // checkout and admin connections) has committed, so idle polls cost one pragma
+    const qint64 version = m_dbManager->dataVersion();
+    if (version != m_dataVersion) {
+        m_dataVersion = version;
+        catchUp();
+    }
+    publishChanges();
+}
+
+void CatalogCache::catchUp()
+{
+    if (!m_segment.lock()) {
+        qDebug() << "Catalog cache: failed to lock segment:" << m_segment.errorString();
+        return;
+    }
+
+    // Another lane may have caught the segment up already; then the delta is empty
+    Header *h = header();
+    Entry *entries = reinterpret_cast<Entry *>(h + 1);
+    bool rebuild = h->magic != Magic;
+    ProductChanges changes;
+    bool ok = rebuild || m_dbManager->getProductChanges(h->logSeq, &changes);
+    if (ok && !rebuild && changes.lastSeq < h->logSeq) {
+        rebuild = true; // The log went backwards: store.db was replaced, e.g. restored
+        changes = ProductChanges();
+    }
+
+    // Looked up by uuid once per changed product, so a bulk repricing stays linear
+    QHash<QByteArray, int> slots;
+    if (ok && !rebuild) {
+        slots.reserve(h->count);
+        for (int i = 0; i < h->count; ++i) {
+            slots.insert(QByteArray(entries[i].uuid, UuidBytes), i);
+        }
+        // Removed products keep their entries until lanes have seen the removal, so
+        // their slots are only reclaimed by rebuilding the segment from the live catalog
+        int added = 0;
+        for (const auto &change : std::as_const(changes.updated)) {
+            added += slots.contains(uuidKey(change.first)) ? 0 : 1;
+        }
+        if (h->count + added > h->capacity) {
+            rebuild = true;
+            changes = ProductChanges();
+            slots.clear();
+        }
+    }
+    if (ok && rebuild) {
+        ok = m_dbManager->getProductChanges(-1, &changes);
+    }
+
+    if (ok && (rebuild || changes.lastSeq != h->logSeq)) {
+        const quint64 sequence = h->sequence.load(std::memory_order_relaxed);
+        h->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        const quint64 next = sequence + 2;
+
+        if (rebuild) {
+            h->magic = Magic;
+            h->entrySize = sizeof(Entry);
+            h->capacity = int((m_segment.size() - sizeof(Header)) / sizeof(Entry));
+            h->count = 0;
+            h->overflow = 0;
+            ++h->epoch;
+        }
+
+        for (const auto &change : std::as_const(changes.updated)) {
+            const QByteArray key = uuidKey(change.first);
+            const int slot = slots.value(key, -1);
+            Entry *e = slot >= 0 ? &entries[slot] : nullptr;
+            if (!e) {
+                if (h->count == h->capacity) {
+                    h->overflow = 1; // Even the live catalog alone does not fit
+                    break;
+                }
+                slots.insert(key, h->count);
+                e = &entries[h->count++];
+            }
+            const Product &product = change.second;
+            std::memset(e, 0, sizeof(Entry));
+            std::memcpy(e->uuid, key.constData(), UuidBytes);
+            e->sequence = next;
+            e->id = product.id;
+            e->quantity = product.quantity;
+            e->price = product.price;
+            if (!putText(e->name, NameBytes, product.name, &e->nameLength) ||
+                !putText(e->imagePath, ImagePathBytes, product.imagePath, &e->imagePathLength)) {
+                e->oversized = 1;
+            }
+        }
+        for (const QString &uuid : std::as_const(changes.removed)) {
+            const int slot = slots.value(uuidKey(uuid), -1);
+            if (slot >= 0) {
+                entries[slot].removed = 1;
+                entries[slot].sequence = next;
+            }
+        }
+        h->logSeq = changes.lastSeq;
+        h->sequence.store(next, std::memory_order_release);
+    }
+
+    m_segment.unlock();
+}
+
+bool CatalogCache::readSegment(std::vector<Entry> *entries, quint64 *sequence, quint32 *epoch) const
+{
+    const Header *h = header();
+    const int maxEntries = int((m_segment.size() - sizeof(Header)) / sizeof(Entry));
+    for (int attempt = 0; attempt < MaxReadAttempts; ++attempt) {
+        const quint64 before = h->sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            QThread::yieldCurrentThread(); // A writer is inside; it holds the lock only briefly
+            continue;
+        }
+        const bool ready = h->magic == Magic;
+        const quint32 currentEpoch = h->epoch;
+        const int count = qBound(0, h->count, maxEntries);
+        entries->resize(count);
+        std::memcpy(static_cast<void *>(entries->data()), h + 1, count * sizeof(Entry));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (h->sequence.load(std::memory_order_relaxed) == before) {
+            *sequence = before;
+            *epoch = currentEpoch;
+            return ready;
+        }
+    }
+    return false;
+}
+
+void CatalogCache::publishChanges()
+{
+    if (header()->sequence.load(std::memory_order_acquire) == m_seenSequence) return;
+
+    std::vector<Entry> entries;
+    quint64 sequence = 0;
+    quint32 epoch = 0;
+    if (!readSegment(&entries, &sequence, &epoch)) {
+        return; // Not filled yet, or busy; the next poll tries again
+    }
+    if (header()->overflow) {
+        qDebug() << "Catalog cache: the catalog no longer fits the shared segment, reading the database instead";
+        m_shared = false;
+        m_timer->stop();
+        m_segment.detach();
+        emit catalogReset();
+        return;
+    }
+
+    const quint64 seen = m_seenSequence;
+    m_seenSequence = sequence;
+    if (epoch != m_seenEpoch) {
+        m_seenEpoch = epoch;
+        emit catalogReset();
+        return;
+    }
+
+    QList<Product> changed;
+    QList<int> removed;
+    for (const Entry &entry : entries) {
+        if (entry.sequence <= seen) {
+            continue;
+        }
+        if (entry.removed) {
+            removed.append(entry.id);
+        } else {
+            changed.append(toProduct(entry));
+        }
+    }
+    if (!changed.isEmpty() || !removed.isEmpty()) {
+        emit productsChanged(changed, removed);
+    }
+}
+
+Product CatalogCache::toProduct(const Entry &entry)
+{
+    if (entry.oversized) {
+        return m_dbManager->getProductById(entry.id);
+    }
+    return { entry.id, QString::fromUtf8(entry.name, entry.nameLength), entry.price, entry.quantity,
+             QString::fromUtf8(entry.imagePath, entry.imagePathLength) };
+}
+
+QList<Product> CatalogCache::products()
+{
+    QList<Product> products;
+    std::vector<Entry> entries;
+    quint64 sequence = 0;
+    quint32 epoch = 0;
+    if (!m_shared || !readSegment(&entries, &sequence, &epoch) || header()->overflow) {
+        return m_dbManager->getAllProducts();
+    }
+    products.reserve(int(entries.size()));
+    for (const Entry &entry : entries) {
+        if (!entry.removed) {
+            products.append(toProduct(entry));
+        }
+    }
+    return products;
+}
@@ -0,0 +1,65 @@
+#ifndef CATALOGCACHE_H
+#define CATALOGCACHE_H
+
+#include <QList>
+#include <QObject>
+#include <QSharedMemory>
+#include <vector>
+#include "product.h"
+
+class DatabaseManager;
+class QTimer;
+
+// The POS catalog in a shared-memory segment that every lane on the host attaches
+// to, keyed by the database path. Each lane polls PRAGMA data_version on its own
+// connection; when another connection has committed, the first lane to notice reads
+// only the products touched in ChangeLog since the segment's position and writes
+// them into the segment under its lock. Readers never lock: the segment carries a
+// sequence counter that is odd while a writer is inside (a seqlock), and each entry
+// records the sequence that last wrote it, so a lane picks out what changed without
+// going back to the database. Poll period: POS_CATALOG_POLL_MS.
+//
+// Without a usable segment (e.g. the catalog outgrew it) products() reads the
+// database directly and no change notifications are sent.
+class CatalogCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultPollIntervalMs = 50;
+    static constexpr int DefaultCapacity = 8192; // Products the segment can hold
+
+    explicit CatalogCache(const QString &databasePath, QObject *parent = nullptr);
+    ~CatalogCache();
+
+    bool isShared() const;
+    QList<Product> products(); // The whole catalog
+
+public slots:
+    void refresh(); // Poll now instead of waiting for the timer
+
+signals:
+    void productsChanged(const QList<Product> &changed, const QList<int> &removed);
+    void catalogReset(); // The segment was rebuilt; reload everything
+
+private:
+    struct Header;
+    struct Entry;
+
+    bool attachSegment();
+    void catchUp();
+    void publishChanges();
+    bool readSegment(std::vector<Entry> *entries, quint64 *sequence, quint32 *epoch) const;
+    Product toProduct(const Entry &entry);
+    Header *header() const;
+
+    DatabaseManager *m_dbManager;
+    QSharedMemory m_segment;
+    bool m_shared;
+    QTimer *m_timer;
+    qint64 m_dataVersion;
+    quint64 m_seenSequence; // Segment sequence this lane has passed on
+    quint32 m_seenEpoch;
+};
+
+#endif // CATALOGCACHE_H
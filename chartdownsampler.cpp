@@ -0,0 +1,245 @@
+#include "chartdownsampler.h"
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+bool lessX(const QPointF &a, const QPointF &b)
+{
+    return a.x() < b.x();
+}
+}
+
+ChartDownsampler::ChartDownsampler(QObject *parent) :
+    QObject(parent),
+    m_method(MinMax),
+    m_targetWidth(800),
+    m_minX(0.0),
+    m_maxX(0.0),
+    m_bucketWidth(0.0),
+    m_generation(0),
+    m_recomputing(false)
+{
+}
+
+void ChartDownsampler::setMethod(Method method)
+{
+    if (m_method != method) {
+        m_method = method;
+        recompute();
+    }
+}
+
+void ChartDownsampler::setTargetWidth(int pixels)
+{
+    pixels = qMax(2, pixels);
+    if (m_targetWidth != pixels) {
+        m_targetWidth = pixels;
+        recompute();
+    }
+}
+
+void ChartDownsampler::setSource(const QList<QPointF> &points)
+{
+    m_source = points;
+    recompute();
+}
+
+void ChartDownsampler::setRange(double minX, double maxX)
+{
+    if (m_minX != minX || m_maxX != maxX) {
+        m_minX = minX;
+        m_maxX = maxX;
+        recompute();
+    }
+}
+
+int ChartDownsampler::sourceSize() const
+{
+    return m_source.size();
+}
+
+void ChartDownsampler::append(const QList<QPointF> &points)
+{
+    if (points.isEmpty()) {
+        return;
+    }
+    if (!m_source.isEmpty() && std::any_of(points.cbegin(), points.cend(),
+                                           [this](const QPointF &point) { return point.x() < m_source.last().x(); })) {
+        // A late point (a sale that was retried, say) goes where it belongs
+        for (const QPointF &point : points) {
+            m_source.insert(std::upper_bound(m_source.begin(), m_source.end(), point, lessX), point);
+        }
+        recompute();
+        return;
+    }
+    m_source.append(points);
+
+    const bool followsAll = m_minX >= m_maxX;
+    if (m_method != MinMax || followsAll || m_buckets.isEmpty()) {
+        recompute(); // Bucket edges move (or LTTB needs its neighbours), so start over
+        return;
+    }
+
+    // Fixed range: only the buckets the new points fall into change. While a recompute
+    // is running its result would replace these buckets, so the points wait for it.
+    if (m_recomputing) {
+        m_queued.append(points);
+        return;
+    }
+    accumulateInRange(points);
+    emitBuckets();
+}
+
+void ChartDownsampler::accumulateInRange(const QList<QPointF> &points)
+{
+    for (const QPointF &point : points) {
+        if (point.x() < m_minX || point.x() > m_maxX) {
+            continue;
+        }
+        const int index = qBound(0, int((point.x() - m_minX) / m_bucketWidth), m_buckets.size() - 1);
+        accumulate(m_buckets[index], point);
+    }
+}
+
+void ChartDownsampler::recompute()
+{
+    const quint64 generation = ++m_generation;
+    m_recomputing = true;
+    m_queued.clear(); // Already in m_source, so the new snapshot includes them
+    const QList<QPointF> source = m_source;
+    const Method method = m_method;
+    const int width = m_targetWidth;
+    double minX = m_minX;
+    double maxX = m_maxX;
+    if (minX >= maxX && !source.isEmpty()) {
+        minX = source.first().x();
+        maxX = source.last().x();
+    }
+
+    auto work = [source, method, width, minX, maxX]() {
+        // Only the visible slice is reduced; binary search keeps pan/zoom cheap
+        const auto begin = std::lower_bound(source.cbegin(), source.cend(), QPointF(minX, 0), lessX);
+        const auto end = std::upper_bound(begin, source.cend(), QPointF(maxX, 0), lessX);
+        const int count = int(end - begin);
+        const QPointF *data = count > 0 ? &*begin : nullptr;
+
+        QVector<Bucket> buckets;
+        if (method == Lttb) {
+            return qMakePair(lttb(data, count, width * 2), buckets);
+        }
+
+        const double bucketWidth = maxX > minX ? (maxX - minX) / width : 1.0;
+        buckets.resize(width);
+        for (int i = 0; i < count; ++i) {
+            accumulate(buckets[qBound(0, int((data[i].x() - minX) / bucketWidth), width - 1)], data[i]);
+        }
+        return qMakePair(bucketPoints(buckets), buckets);
+    };
+
+    QtConcurrent::run(work).then(this, [this, generation, minX, maxX, width](const QPair<QList<QPointF>, QVector<Bucket>> &result) {
+        if (generation != m_generation) {
+            return; // A newer source, range or size arrived meanwhile
+        }
+        m_recomputing = false;
+        m_buckets = result.second;
+        m_bucketWidth = maxX > minX ? (maxX - minX) / width : 1.0;
+        if (m_queued.isEmpty() || m_buckets.isEmpty()) {
+            m_queued.clear();
+            emit ready(result.first);
+            return;
+        }
+        accumulateInRange(m_queued);
+        m_queued.clear();
+        emitBuckets();
+    });
+}
+
+void ChartDownsampler::emitBuckets()
+{
+    emit ready(bucketPoints(m_buckets));
+}
+
+QList<QPointF> ChartDownsampler::lttb(const QPointF *data, int count, int threshold)
+{
+    QList<QPointF> sampled;
+    if (threshold >= count || threshold < 3) {
+        sampled.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            sampled.append(data[i]);
+        }
+        return sampled;
+    }
+
+    sampled.reserve(threshold);
+    const double every = double(count - 2) / (threshold - 2);
+    int a = 0;
+    sampled.append(data[a]);
+
+    for (int i = 0; i < threshold - 2; ++i) {
+        // Average of the next bucket is the third triangle vertex
+        int avgStart = int(std::floor((i + 1) * every)) + 1;
+        int avgEnd = qMin(int(std::floor((i + 2) * every)) + 1, count);
+        double avgX = 0.0;
+        double avgY = 0.0;
+        for (int j = avgStart; j < avgEnd; ++j) {
+            avgX += data[j].x();
+            avgY += data[j].y();
+        }
+        const int avgLength = qMax(1, avgEnd - avgStart);
+        avgX /= avgLength;
+        avgY /= avgLength;
+
+        // Keep the point in this bucket that spans the largest triangle
+        const int rangeStart = int(std::floor(i * every)) + 1;
+        const int rangeEnd = int(std::floor((i + 1) * every)) + 1;
+        double maxArea = -1.0;
+        int next = rangeStart;
+        for (int j = rangeStart; j < rangeEnd; ++j) {
+            const double area = std::abs((data[a].x() - avgX) * (data[j].y() - data[a].y())
+                                         - (data[a].x() - data[j].x()) * (avgY - data[a].y()));
+            if (area > maxArea) {
+                maxArea = area;
+                next = j;
+            }
+        }
+        sampled.append(data[next]);
+        a = next;
+    }
+
+    sampled.append(data[count - 1]);
+    return sampled;
+}
+
+void ChartDownsampler::accumulate(Bucket &bucket, const QPointF &point)
+{
+    if (bucket.count == 0) {
+        bucket.first = bucket.min = bucket.max = point;
+    } else {
+        if (point.y() < bucket.min.y()) bucket.min = point;
+        if (point.y() > bucket.max.y()) bucket.max = point;
+    }
+    bucket.last = point;
+    bucket.count++;
+}
+
+QList<QPointF> ChartDownsampler::bucketPoints(const QVector<Bucket> &buckets)
+{
+    // Up to four points per bucket, in x order, so the line still enters and leaves
+    // each pixel column where the raw data did and every spike survives.
+    QList<QPointF> points;
+    points.reserve(buckets.size() * 2);
+    for (const auto &bucket : buckets) {
+        if (bucket.count == 0) {
+            continue;
+        }
+        QPointF candidates[] = { bucket.first, bucket.min, bucket.max, bucket.last };
+        std::sort(std::begin(candidates), std::end(candidates), lessX);
+        for (const QPointF &point : candidates) {
+            if (points.isEmpty() || points.last() != point) {
+                points.append(point);
+            }
+        }
+    }
+    return points;
+}
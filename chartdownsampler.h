@@ -0,0 +1,66 @@
+#ifndef CHARTDOWNSAMPLER_H
+#define CHARTDOWNSAMPLER_H
+
+#include <QList>
+#include <QObject>
+#include <QPointF>
+#include <QVector>
+
+// Reduces a long, x-sorted series to a handful of points per pixel column of the chart
+// so QLineSeries never has to lay out more than the screen can show. Full reductions
+// (new source, zoom, pan, resize) run on the global thread pool; points appended
+// inside the visible range update the min/max buckets in place.
+class ChartDownsampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Method {
+        MinMax, // Keeps every spike; incremental on append
+        Lttb    // Largest-Triangle-Three-Buckets; smoother shape, recomputed on append
+    };
+
+    explicit ChartDownsampler(QObject *parent = nullptr);
+
+    void setMethod(Method method);
+    void setTargetWidth(int pixels);
+    void setSource(const QList<QPointF> &points);
+    void append(const QList<QPointF> &points); // Points behind the end are inserted in order
+    void setRange(double minX, double maxX); // Visible x range; an empty range means "everything"
+
+    int sourceSize() const;
+
+    static QList<QPointF> lttb(const QPointF *data, int count, int threshold);
+
+signals:
+    void ready(const QList<QPointF> &points);
+
+private:
+    struct Bucket {
+        QPointF first;
+        QPointF min;
+        QPointF max;
+        QPointF last;
+        int count = 0;
+    };
+
+    static void accumulate(Bucket &bucket, const QPointF &point);
+    static QList<QPointF> bucketPoints(const QVector<Bucket> &buckets);
+
+    void recompute();
+    void accumulateInRange(const QList<QPointF> &points);
+    void emitBuckets();
+
+    Method m_method;
+    int m_targetWidth;
+    double m_minX;
+    double m_maxX;
+    QList<QPointF> m_source; // Implicitly shared, so workers get a cheap snapshot
+    QVector<Bucket> m_buckets; // MinMax state for the current range, for incremental appends
+    double m_bucketWidth;
+    quint64 m_generation; // Results from superseded recomputes are dropped
+    bool m_recomputing; // A recompute for the current generation is still running
+    QList<QPointF> m_queued; // Appended while recomputing; not in the worker's snapshot
+};
+
+#endif // CHARTDOWNSAMPLER_H
@@ -0,0 +1,518 @@
+#include "checkoutpipeline.h"
+#include "groupcommitter.h"
+#include "salesjournal.h"
+#include "storeclient.h"
+#include <QDebug>
+#include <QFile>
+#include <QFuture>
+#include <QTimer>
+#include <QUuid>
+
+CheckoutWorker::CheckoutWorker(const QString &databasePath, const QString &journalPath, const QString &serverAddress,
+                               QObject *parent) :
+    QObject(parent),
+    m_databasePath(databasePath),
+    m_journalPath(journalPath),
+    m_serverAddress(serverAddress),
+    m_committer(nullptr),
+    m_client(nullptr),
+    m_journal(nullptr),
+    m_failedJournal(nullptr),
+    m_compacting(0),
+    m_appliedInRound(0),
+    m_compactTimer(nullptr),
+    m_flushScheduled(false),
+    m_journalPinned(false),
+    m_shutDown(false)
+{
+}
+
+CheckoutWorker::~CheckoutWorker()
+{
+    delete m_journal;
+    delete m_failedJournal;
+    delete m_committer;
+}
+
+void CheckoutWorker::start()
+{
+    // Everything is created here so it lives on the worker thread
+    if (!m_serverAddress.isEmpty()) {
+        m_client = new StoreClient(this);
+        if (!m_client->connectToServer(m_serverAddress, ServerConnectTimeoutMs)) {
+            qDebug() << "Store server" << m_serverAddress << "unavailable:" << m_client->errorString();
+        }
+    }
+    int windowMs = GroupCommitter::DefaultWindowMs;
+    int maxBatch = GroupCommitter::DefaultMaxBatchSize;
+    bool ok = false;
+    const int windowOverride = qEnvironmentVariableIntValue("POS_GROUP_COMMIT_WINDOW_MS", &ok);
+    if (ok) windowMs = windowOverride;
+    const int batchOverride = qEnvironmentVariableIntValue("POS_GROUP_COMMIT_MAX_BATCH", &ok);
+    if (ok) maxBatch = batchOverride;
+    if (!m_client) {
+        m_committer = new GroupCommitter(m_databasePath, windowMs, maxBatch);
+    }
+
+    m_compactTimer = new QTimer(this);
+    m_compactTimer->setSingleShot(true);
+    m_compactTimer->setInterval(CompactIntervalMs);
+    connect(m_compactTimer, &QTimer::timeout, this, &CheckoutWorker::compact);
+
+    // A rewrite that was cut short between removing the old file and renaming the new one
+    const QString failedPath = failedJournalPath();
+    if (!QFile::exists(failedPath) && QFile::exists(failedPath + ".tmp")) {
+        QFile::rename(failedPath + ".tmp", failedPath);
+    }
+    m_failedJournal = new SalesJournal;
+    if (m_failedJournal->open(failedPath)) {
+        // Hand last session's failed sales back so they can be retried again
+        const QList<PendingSale> failed = m_failedJournal->replay();
+        for (const auto &sale : failed) {
+            if (!m_failed.contains(sale.uuid)) {
+                m_failed.insert(sale.uuid, sale);
+                emit this->failed(sale);
+            }
+        }
+        if (!failed.isEmpty()) {
+            qDebug() << failed.size() << "sale(s) still failed from the last session";
+        }
+    } else {
+        delete m_failedJournal;
+        m_failedJournal = nullptr;
+    }
+
+    m_journal = new SalesJournal;
+    if (!m_journal->open(m_journalPath)) {
+        qDebug() << "Sales journal unavailable, committing sales directly";
+        delete m_journal;
+        m_journal = nullptr;
+        return;
+    }
+
+    // Sales that were durable but not yet folded in when we last stopped
+    m_uncompacted = m_journal->replay();
+    if (!m_uncompacted.isEmpty()) {
+        qDebug() << "Replaying" << m_uncompacted.size() << "journaled sale(s)";
+        QStringList uuids;
+        for (const auto &sale : std::as_const(m_uncompacted)) {
+            uuids.append(sale.uuid);
+        }
+        emit replayed(uuids);
+        compact();
+    }
+}
+
+void CheckoutWorker::commit(PendingSale sale)
+{
+    if (!m_journal || !m_journal->append(sale)) {
+        commitDirect(sale);
+        return;
+    }
+
+    // Every sale queued behind this one is appended before the zero-timer fires,
+    // so a burst of sales shares a single fsync.
+    m_unsynced.append(sale);
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QTimer::singleShot(0, this, &CheckoutWorker::flushJournal);
+    }
+}
+
+void CheckoutWorker::flushJournal()
+{
+    m_flushScheduled = false;
+    if (!m_journal || m_unsynced.isEmpty()) {
+        return; // Already flushed by shutdown()
+    }
+    const QList<PendingSale> group = m_unsynced;
+    m_unsynced.clear();
+
+    if (!m_journal->sync()) {
+        // Durability is not guaranteed, so take the slow path for this group
+        for (const auto &sale : group) {
+            commitDirect(sale);
+        }
+        return;
+    }
+
+    for (const auto &sale : group) {
+        emit committed(sale.uuid);
+    }
+    m_uncompacted.append(group);
+
+    if (m_uncompacted.size() >= CompactBatchSize) {
+        compact();
+    } else if (!m_compactTimer->isActive()) {
+        m_compactTimer->start();
+    }
+}
+
+void CheckoutWorker::compact()
+{
+    m_compactTimer->stop();
+    if (m_shutDown || m_uncompacted.isEmpty() || m_compacting > 0) {
+        return; // The round in flight picks the rest up when it finishes
+    }
+
+    // Hand the whole backlog over at once; the committer folds it into a few large
+    // transactions and reports every sale individually.
+    const QList<PendingSale> round = m_uncompacted;
+    m_uncompacted.clear();
+    m_compacting = round.size();
+    m_appliedInRound = 0;
+    for (const auto &sale : round) {
+        submit(sale).then(this, [this, sale](bool success) {
+            onCompacted(sale, success);
+        });
+    }
+}
+
+void CheckoutWorker::onCompacted(PendingSale sale, bool success)
+{
+    if (m_shutDown) {
+        return; // Still in the journal, which is replayed next time
+    }
+    if (success) {
+        m_appliedInRound++;
+        forgetFailed(sale.uuid);
+        emit saleApplied(sale);
+    } else {
+        sale.attempts++;
+        if (sale.attempts < CheckoutPipeline::MaxAttempts) {
+            m_uncompacted.append(sale); // Stays in the journal; retried next round
+        } else {
+            qDebug() << "Journaled sale" << sale.uuid << "could not be applied after" << sale.attempts << "attempts";
+            if (!giveUp(sale)) {
+                m_journalPinned = true; // The journal is its only durable copy now
+            }
+        }
+    }
+
+    if (--m_compacting > 0) {
+        return;
+    }
+
+    emit salesApplied(m_appliedInRound);
+    if (m_uncompacted.isEmpty() && m_unsynced.isEmpty()) {
+        // Everything journaled is now in the database or in the failed journal
+        if (!m_journalPinned) {
+            m_journal->reset();
+        }
+    } else {
+        m_compactTimer->start();
+    }
+}
+
+bool CheckoutWorker::ensureConnected()
+{
+    if (!m_client->isConnected() && !m_client->connectToServer(m_serverAddress, ServerConnectTimeoutMs)) {
+        qDebug() << "Store server" << m_serverAddress << "unavailable:" << m_client->errorString();
+        return false;
+    }
+    return true;
+}
+
+QFuture<bool> CheckoutWorker::submit(const PendingSale &sale)
+{
+    if (!m_client) {
+        return m_committer->submit(sale);
+    }
+    // Reconnect on demand; while the server is down the sale fails and is retried like
+    // any other, and journaled sales simply wait in the journal
+    ensureConnected();
+    return m_client->submitSaleAsync(sale);
+}
+
+bool CheckoutWorker::reserveStock(int productId, int quantity)
+{
+    // No hold without the server: the item cannot go into the cart
+    if (!m_client || !ensureConnected()) {
+        return false;
+    }
+    const QFuture<bool> future = m_client->reserveStockAsync(productId, quantity);
+    return m_client->waitFor(future, ServerStockTimeoutMs) && future.result();
+}
+
+void CheckoutWorker::releaseStock(int productId, int quantity)
+{
+    // Holds on a connection that dropped were already released by the server
+    if (m_client && m_client->isConnected()) {
+        m_client->releaseStock(productId, quantity);
+    }
+}
+
+bool CheckoutWorker::serverProducts(QList<Product> *products)
+{
+    if (!m_client || !ensureConnected()) {
+        return false;
+    }
+    *products = m_client->getAllProducts();
+    return !products->isEmpty(); // Empty when the request failed
+}
+
+void CheckoutWorker::commitDirect(PendingSale sale)
+{
+    sale.attempts++;
+    m_direct.insert(sale.uuid, sale);
+    submit(sale).then(this, [this, sale](bool success) {
+        if (m_shutDown) {
+            return; // shutdown() already settled every direct commit
+        }
+        if (success) {
+            m_direct.remove(sale.uuid);
+            forgetFailed(sale.uuid);
+            emit committed(sale.uuid);
+            emit saleApplied(sale);
+            emit salesApplied(1);
+        } else if (sale.attempts < CheckoutPipeline::MaxAttempts) {
+            // Back off a little before retrying; the UUID keeps the retry idempotent
+            const int delayMs = 200 * sale.attempts;
+            qDebug() << "Sale" << sale.uuid << "failed, retrying in" << delayMs << "ms";
+            QTimer::singleShot(delayMs, this, [this, sale]() {
+                if (!m_shutDown) {
+                    commitDirect(sale);
+                }
+            });
+        } else {
+            qDebug() << "Sale" << sale.uuid << "failed after" << sale.attempts << "attempts";
+            m_direct.remove(sale.uuid);
+            giveUp(sale);
+        }
+    });
+}
+
+bool CheckoutWorker::giveUp(const PendingSale &sale)
+{
+    // Persist before reporting, so the sale survives the journal being reset. A retried
+    // sale that failed again is already in the file.
+    bool persisted = m_failed.contains(sale.uuid);
+    if (!persisted && m_failedJournal && m_failedJournal->append(sale) && m_failedJournal->sync()) {
+        m_failed.insert(sale.uuid, sale);
+        persisted = true;
+    }
+    if (!persisted) {
+        qDebug() << "Error: failed sale" << sale.uuid << "could not be written to the failed journal";
+    }
+    emit failed(sale);
+    return persisted;
+}
+
+void CheckoutWorker::forgetFailed(const QString &uuid)
+{
+    if (m_failed.remove(uuid) && m_failedJournal) {
+        rewriteFailedJournal();
+    }
+}
+
+bool CheckoutWorker::rewriteFailedJournal()
+{
+    // Written aside and renamed into place; start() finishes a rename that was cut short
+    const QString path = failedJournalPath();
+    const QString tmpPath = path + ".tmp";
+    {
+        SalesJournal rewritten;
+        if (!rewritten.open(tmpPath) || !rewritten.reset()) {
+            return false;
+        }
+        for (const auto &sale : std::as_const(m_failed)) {
+            rewritten.append(sale);
+        }
+        if (!rewritten.sync()) {
+            return false;
+        }
+    }
+
+    m_failedJournal->close();
+    if (!QFile::remove(path) || !QFile::rename(tmpPath, path)) {
+        qDebug() << "Error: failed to replace" << path;
+    }
+    if (!m_failedJournal->open(path)) {
+        delete m_failedJournal;
+        m_failedJournal = nullptr;
+        return false;
+    }
+    return true;
+}
+
+QString CheckoutWorker::failedJournalPath() const
+{
+    return m_journalPath + ".failed";
+}
+
+void CheckoutWorker::shutdown()
+{
+    m_shutDown = true;
+    if (m_compactTimer) {
+        m_compactTimer->stop();
+    }
+
+    // Hand over whatever is left; the committer drains its queue before it goes away.
+    // Journaled sales whose results arrive after this are not observed, which is fine:
+    // the journal is only reset once it has caught up, and replaying it is idempotent.
+    QList<QFuture<bool>> journaled;
+    if (m_journal) {
+        if (!m_unsynced.isEmpty()) {
+            flushJournal();
+        }
+        for (const auto &sale : std::as_const(m_uncompacted)) {
+            journaled.append(submit(sale));
+        }
+        m_uncompacted.clear();
+    }
+
+    // Direct commits have no journal behind them, including those still waiting on a
+    // retry timer. Submit each once more (a duplicate of one in flight is a no-op, as
+    // the UUID is already committed) and keep the ones that still fail.
+    QList<QPair<PendingSale, QFuture<bool>>> direct;
+    for (const auto &sale : std::as_const(m_direct)) {
+        direct.append({ sale, submit(sale) });
+    }
+    m_direct.clear();
+
+    if (m_client) {
+        // The server's replies must be read before the connection goes away
+        for (const auto &future : std::as_const(journaled)) {
+            m_client->waitFor(future);
+        }
+        for (const auto &entry : std::as_const(direct)) {
+            m_client->waitFor(entry.second);
+        }
+    }
+
+    delete m_journal;
+    m_journal = nullptr;
+    delete m_committer;
+    m_committer = nullptr;
+    delete m_client; // Fails anything that did not get a reply
+    m_client = nullptr;
+
+    for (const auto &entry : std::as_const(direct)) {
+        const QFuture<bool> &future = entry.second;
+        if (future.resultCount() == 0 || !future.result()) {
+            giveUp(entry.first);
+        }
+    }
+    delete m_failedJournal;
+    m_failedJournal = nullptr;
+}
+
+CheckoutPipeline::CheckoutPipeline(const QString &databasePath, const QString &journalPath,
+                                   const QString &serverAddress, QObject *parent) :
+    QObject(parent),
+    m_worker(new CheckoutWorker(databasePath, journalPath, serverAddress)),
+    m_hasServer(!serverAddress.isEmpty())
+{
+    qRegisterMetaType<PendingSale>();
+
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &CheckoutWorker::committed, this, &CheckoutPipeline::onCommitted);
+    connect(m_worker, &CheckoutWorker::failed, this, &CheckoutPipeline::onFailed);
+    connect(m_worker, &CheckoutWorker::saleApplied, this, &CheckoutPipeline::onSaleApplied);
+    connect(m_worker, &CheckoutWorker::replayed, this, &CheckoutPipeline::onReplayed);
+    connect(m_worker, &CheckoutWorker::salesApplied, this, &CheckoutPipeline::salesApplied);
+    m_thread.setObjectName("CheckoutPipeline");
+    m_thread.start();
+    QMetaObject::invokeMethod(m_worker, &CheckoutWorker::start, Qt::QueuedConnection);
+}
+
+CheckoutPipeline::~CheckoutPipeline()
+{
+    // Queued commits run before the shutdown request, so sales already handed off still land
+    QMetaObject::invokeMethod(m_worker, &CheckoutWorker::shutdown, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+QString CheckoutPipeline::submit(const QMap<int, CartItem> &cart, double totalAmount, int userId)
+{
+    PendingSale sale;
+    sale.uuid = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    sale.cart = cart;
+    sale.totalAmount = totalAmount;
+    sale.userId = userId;
+    sale.soldAt = QDateTime::currentDateTimeUtc();
+    resubmit(sale);
+    return sale.uuid;
+}
+
+void CheckoutPipeline::resubmit(PendingSale sale)
+{
+    sale.attempts = 0;
+    m_inFlight.insert(sale.uuid);
+    m_unapplied.insert(sale.uuid);
+    emit pendingCountChanged(pendingCount());
+    QMetaObject::invokeMethod(m_worker, "commit", Qt::QueuedConnection, Q_ARG(PendingSale, sale));
+}
+
+int CheckoutPipeline::pendingCount() const
+{
+    return m_inFlight.size();
+}
+
+bool CheckoutPipeline::hasServer() const
+{
+    return m_hasServer;
+}
+
+bool CheckoutPipeline::reserveStock(int productId, int quantity)
+{
+    // Queued behind any sale already handed off, so the server sees them in order
+    bool reserved = false;
+    QMetaObject::invokeMethod(m_worker, [this, productId, quantity]() {
+        return m_worker->reserveStock(productId, quantity);
+    }, Qt::BlockingQueuedConnection, &reserved);
+    return reserved;
+}
+
+void CheckoutPipeline::releaseStock(int productId, int quantity)
+{
+    QMetaObject::invokeMethod(m_worker, [this, productId, quantity]() {
+        m_worker->releaseStock(productId, quantity);
+    }, Qt::QueuedConnection);
+}
+
+bool CheckoutPipeline::serverProducts(QList<Product> *products)
+{
+    bool ok = false;
+    QMetaObject::invokeMethod(m_worker, [this, products]() {
+        return m_worker->serverProducts(products);
+    }, Qt::BlockingQueuedConnection, &ok);
+    return ok;
+}
+
+int CheckoutPipeline::unappliedCount() const
+{
+    return m_unapplied.size();
+}
+
+void CheckoutPipeline::onCommitted(const QString &uuid)
+{
+    m_inFlight.remove(uuid);
+    emit pendingCountChanged(pendingCount());
+    emit saleCommitted(uuid);
+}
+
+void CheckoutPipeline::onFailed(const PendingSale &sale)
+{
+    // A journaled sale that later fails to apply was already reported as committed
+    if (m_inFlight.remove(sale.uuid)) {
+        emit pendingCountChanged(pendingCount());
+    }
+    m_unapplied.remove(sale.uuid);
+    emit saleFailed(sale);
+}
+
+void CheckoutPipeline::onSaleApplied(const PendingSale &sale)
+{
+    m_unapplied.remove(sale.uuid);
+    emit saleApplied(sale);
+}
+
+void CheckoutPipeline::onReplayed(const QStringList &uuids)
+{
+    for (const QString &uuid : uuids) {
+        m_unapplied.insert(uuid);
+    }
+}
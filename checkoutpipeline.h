@@ -0,0 +1,143 @@
+#ifndef CHECKOUTPIPELINE_H
+#define CHECKOUTPIPELINE_H
+
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThread>
+#include "pendingsale.h"
+#include "product.h"
+
+class GroupCommitter;
+class SalesJournal;
+class StoreClient;
+class QTimer;
+
+// Runs on the pipeline's thread and owns the sales journal. Database writes go through
+// a GroupCommitter so journal compaction and direct commits share transactions, or to
+// a store server through a StoreClient when one is configured.
+class CheckoutWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int CompactBatchSize = 200;
+    static constexpr int CompactIntervalMs = 1000;
+    static constexpr int ServerConnectTimeoutMs = 1000;
+    static constexpr int ServerStockTimeoutMs = 1000; // A cart waits this long for a hold
+
+    CheckoutWorker(const QString &databasePath, const QString &journalPath, const QString &serverAddress,
+                   QObject *parent = nullptr);
+    ~CheckoutWorker();
+
+    // Stock held on the store server, on the connection the sales go out on so that each
+    // sale takes over its holds. Called on the worker's thread.
+    bool reserveStock(int productId, int quantity);
+    void releaseStock(int productId, int quantity);
+    bool serverProducts(QList<Product> *products);
+
+public slots:
+    void start();
+    void commit(PendingSale sale);
+    void shutdown();
+
+signals:
+    void committed(const QString &uuid); // Durable: in the journal (or the database)
+    void failed(const PendingSale &sale);
+    void saleApplied(const PendingSale &sale); // This sale is in Sales/SaleItems
+    void salesApplied(int count); // A batch of sales has been folded in
+    void replayed(const QStringList &uuids); // Journaled last session, not yet in the database
+
+private slots:
+    void flushJournal();
+    void compact();
+
+private:
+    bool ensureConnected();
+    QFuture<bool> submit(const PendingSale &sale);
+    void commitDirect(PendingSale sale);
+    void onCompacted(PendingSale sale, bool success);
+    bool giveUp(const PendingSale &sale);
+    void forgetFailed(const QString &uuid);
+    bool rewriteFailedJournal();
+    QString failedJournalPath() const;
+
+    QString m_databasePath;
+    QString m_journalPath;
+    QString m_serverAddress; // Empty: commit to the database file ourselves
+    GroupCommitter *m_committer; // Null when sales go to a store server
+    StoreClient *m_client; // Null unless sales go to a store server
+    SalesJournal *m_journal; // Null if the journal could not be opened
+    SalesJournal *m_failedJournal; // Sales handed back as failed, kept across restarts
+    QHash<QString, PendingSale> m_failed; // What m_failedJournal holds
+    QHash<QString, PendingSale> m_direct; // Direct commits in flight or waiting to retry
+    QList<PendingSale> m_unsynced; // Appended but not yet fsynced
+    QList<PendingSale> m_uncompacted; // Durable in the journal, not yet in the database
+    int m_compacting; // Sales handed to the committer whose result is still outstanding
+    int m_appliedInRound;
+    QTimer *m_compactTimer;
+    bool m_flushScheduled;
+    bool m_journalPinned; // A failed sale could not be persisted, so never reset the journal
+    bool m_shutDown; // Continuations still queued after shutdown() must not touch anything
+};
+
+// Staged checkout: the UI captures the cart and hands it off, then goes straight back
+// to the cashier. The commit stage appends the sale to an append-only journal and
+// fsyncs once per group of queued sales; a background compactor then folds journaled
+// sales into the database in large batches. Un-compacted records are replayed on start.
+// The group commit window can be tuned with POS_GROUP_COMMIT_WINDOW_MS and
+// POS_GROUP_COMMIT_MAX_BATCH.
+// With a server address, sales are submitted to that store server (see StoreServer)
+// instead of being written to the database by this process; the journal still makes
+// them durable at the till first.
+// A sale that cannot be saved is handed back through saleFailed() so the basket is
+// never lost. Failed sales are also kept in a second journal next to the first one and
+// handed back again on the next start until they reach the database.
+class CheckoutPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MaxAttempts = 3;
+
+    CheckoutPipeline(const QString &databasePath, const QString &journalPath,
+                     const QString &serverAddress = QString(), QObject *parent = nullptr);
+    ~CheckoutPipeline();
+
+    QString submit(const QMap<int, CartItem> &cart, double totalAmount, int userId);
+    void resubmit(PendingSale sale);
+    int pendingCount() const;
+
+    // With a store server, stock is held in its ledger, shared by every till. These
+    // block until the server answers; without one they are not used.
+    bool hasServer() const;
+    bool reserveStock(int productId, int quantity);
+    void releaseStock(int productId, int quantity);
+    bool serverProducts(QList<Product> *products); // On-hand stock as the server sees it
+    int unappliedCount() const; // Handed over or replayed, not yet in the database or failed
+
+signals:
+    void saleCommitted(const QString &uuid);
+    void saleFailed(const PendingSale &sale);
+    void saleApplied(const PendingSale &sale);
+    void salesApplied(int count);
+    void pendingCountChanged(int count);
+
+private slots:
+    void onCommitted(const QString &uuid);
+    void onFailed(const PendingSale &sale);
+    void onSaleApplied(const PendingSale &sale);
+    void onReplayed(const QStringList &uuids);
+
+private:
+    QThread m_thread;
+    CheckoutWorker *m_worker;
+    bool m_hasServer;
+    QSet<QString> m_inFlight; // Submitted but not yet durable
+    QSet<QString> m_unapplied; // Not yet in Sales/SaleItems, durable or not
+};
+
+#endif // CHECKOUTPIPELINE_H
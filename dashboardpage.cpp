@@ -1,31 +1,63 @@
 #include "dashboardpage.h"
 #include "ui_dashboardpage.h"
-#include <QGraphicsDropShadowEffect>
+#include "chartdownsampler.h"
+#include "readconnection.h"
+#include "shadoweffect.h"
 #include <QDebug>
 #include <QDate> // Add this include for QDate
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtCharts/QChartView>
+#include <QtCharts/QDateTimeAxis>
+#include <QtCharts/QLineSeries>
+#include <QtCharts/QValueAxis>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+// Chart ranges offered on the dashboard, from a single day up to several years
+struct SalesRange {
+    const char *label;
+    qint64 days;
+    bool everySale; // Plot individual sales (downsampled) instead of rollups
+};
+
+const SalesRange SalesRanges[] = {
+    { "Last 24 hours", 1, false },
+    { "Last 7 days", 7, false },
+    { "Last 30 days", 30, false },
+    { "Last 12 months", 365, false },
+    { "Last 5 years", 5 * 365, false },
+    { "Every sale, last 30 days", 30, true },
+    { "Every sale, last 12 months", 365, true },
+};
+}
 
 DashboardPage::DashboardPage(QWidget *parent) : 
     QWidget(parent), 
-    ui(new Ui::DashboardPage)
+    ui(new Ui::DashboardPage),
+    m_dbManager(nullptr),
+    m_showingEverySale(false),
+    m_lastSaleId(-1),
+    m_maxAmount(0.0),
+    m_salesGeneration(0),
+    m_loadingSales(false),
+    m_loadQueued(false)
 {
     ui->setupUi(this);
+    setupSalesChart();
 
-    auto applyShadow = [](QWidget *widget) {
-        auto *shadow = new QGraphicsDropShadowEffect;
-        shadow->setBlurRadius(20);
-        shadow->setXOffset(0);
-        shadow->setYOffset(0);
-        shadow->setColor(QColor(0, 0, 0, 60));
-        widget->setGraphicsEffect(shadow);
+    // Cached shadows: the blur is rendered once and shared by all cards
+    auto applyShadow = [](QWidget *widget, qreal cornerRadius) {
+        widget->setGraphicsEffect(ShadowEffect::create(20, 0, 0, QColor(0, 0, 0, 60), ShadowEffect::RoundedRect, cornerRadius));
     };
 
-    applyShadow(ui->cardTotalProducts);
-    applyShadow(ui->cardTotalItems);
-    applyShadow(ui->cardStockValue);
-    applyShadow(ui->cardTotalRevenue);
-    applyShadow(ui->cardSalesToday);
-    applyShadow(ui->cardSalesMonth);
-    applyShadow(ui->weeklySalesCard);
+    applyShadow(ui->cardTotalProducts, 5);
+    applyShadow(ui->cardTotalItems, 5);
+    applyShadow(ui->cardStockValue, 5);
+    applyShadow(ui->cardTotalRevenue, 5);
+    applyShadow(ui->cardSalesToday, 5);
+    applyShadow(ui->cardSalesMonth, 5);
+    applyShadow(ui->weeklySalesCard, 12);
 }
 
 DashboardPage::~DashboardPage()
@@ -48,18 +80,193 @@ void DashboardPage::refreshData(DatabaseManager *dbManager)
     ui->salesTodayValueLabel->setText(QString::number(dbManager->getSalesCountForToday()));
     ui->salesMonthValueLabel->setText(QString::number(dbManager->getSalesCountForThisMonth()));
 
-    // Sales for Last 7 Days
-    QMap<QString, double> salesData = dbManager->getSalesForLast7Days();
-    QString salesText;
-    
-    salesText += "Sales for the last 7 days:\n";
-    for (int i = 6; i >= 0; --i) {
-        QDate date = QDate::currentDate().addDays(-i);
-        QString dayName = date.toString("ddd");
-        // The getSalesForLast7Days function already returns a map with 0s for days with no sales.
-        double dailySale = salesData.value(dayName, 0.0);
-        salesText += QString("%1 (%2): %3 MAD\n").arg(dayName).arg(date.toString("MMM d")).arg(dailySale, 0, 'f', 2);
+    const bool sameReplica = m_dbManager == dbManager;
+    m_dbManager = dbManager;
+    if (sameReplica && m_showingEverySale && m_lastSaleId >= 0 && m_salesDay == QDate::currentDate()) {
+        loadSales(true); // Only what the replica gained since the last load
+        return;
     }
+    refreshSalesChart();
+}
 
-    ui->weeklySalesTextEdit->setText(salesText);
+void DashboardPage::addSale(const QString &uuid, const QDateTime &when, double amount)
+{
+    // Only the per-sale view follows individual sales; rollups refresh with the page
+    const QPointF point(when.toMSecsSinceEpoch(), amount);
+    if (m_showingEverySale && point.x() >= m_salesFrom.toMSecsSinceEpoch()) {
+        m_addedSales.insert(uuid, point);
+        m_downsampler->append({ point });
+        if (amount > m_maxAmount) {
+            m_maxAmount = amount;
+            showSalesMaximum();
+        }
+    }
+}
+
+void DashboardPage::loadSales(bool newOnly)
+{
+    if (newOnly && m_loadingSales) {
+        m_loadQueued = true;
+        return;
+    }
+    const quint64 generation = newOnly ? m_salesGeneration : ++m_salesGeneration;
+    m_loadingSales = true;
+    m_loadQueued = false;
+
+    // A year of sales plus the archived months it spans is read on a pool thread,
+    // on a connection of its own to the replica
+    const QString replicaPath = m_dbManager->getDatabase().databaseName();
+    const QDateTime from = m_salesFrom;
+    const qint64 afterId = newOnly ? m_lastSaleId : -1;
+    auto work = [replicaPath, from, afterId]() {
+        ReadConnection connection(replicaPath, "dashboard");
+        return DatabaseManager::getSaleAmounts(connection.database(), from, afterId);
+    };
+    QtConcurrent::run(work).then(this, [this, generation, newOnly](const SaleAmounts &result) {
+        if (generation != m_salesGeneration) {
+            return; // Another range was picked meanwhile
+        }
+        m_loadingSales = false;
+        if (result.ok) {
+            QList<QPointF> points;
+            points.reserve(result.sales.size());
+            for (const SaleAmount &sale : result.sales) {
+                // A sale addSale already plotted is only forgotten on a load of the new sales
+                if (!sale.uuid.isEmpty() && m_addedSales.remove(sale.uuid) && newOnly) {
+                    continue;
+                }
+                points.append(sale.point);
+                m_maxAmount = qMax(m_maxAmount, sale.point.y());
+            }
+            if (newOnly) {
+                m_downsampler->append(points); // Late sales are put in order
+            } else {
+                // Sales added while loading that the replica did not have yet
+                for (const QPointF &point : std::as_const(m_addedSales)) {
+                    points.insert(std::upper_bound(points.begin(), points.end(), point,
+                                                   [](const QPointF &a, const QPointF &b) { return a.x() < b.x(); }),
+                                  point);
+                }
+                m_downsampler->setSource(points);
+            }
+            m_lastSaleId = result.lastId;
+            showSalesMaximum();
+        }
+        if (m_loadQueued) {
+            loadSales(true);
+        }
+    });
+}
+
+void DashboardPage::showSalesMaximum()
+{
+    m_salesValueAxis->setRange(0.0, m_maxAmount > 0.0 ? m_maxAmount * 1.1 : 1.0);
+}
+
+void DashboardPage::setupSalesChart()
+{
+    for (int i = 0; i < int(std::size(SalesRanges)); ++i) {
+        ui->salesRangeComboBox->addItem(tr(SalesRanges[i].label), i);
+    }
+    ui->salesRangeComboBox->setCurrentIndex(1); // Last 7 days, as before
+
+    m_salesSeries = new QLineSeries;
+    m_salesSeries->setName(tr("Revenue (MAD)"));
+
+    QChart *chart = new QChart;
+    chart->addSeries(m_salesSeries);
+    chart->legend()->hide();
+    chart->setBackgroundVisible(false);
+    chart->setMargins(QMargins(0, 0, 0, 0));
+
+    m_salesTimeAxis = new QDateTimeAxis;
+    m_salesValueAxis = new QValueAxis;
+    m_salesValueAxis->setLabelFormat("%.0f");
+    chart->addAxis(m_salesTimeAxis, Qt::AlignBottom);
+    chart->addAxis(m_salesValueAxis, Qt::AlignLeft);
+    m_salesSeries->attachAxis(m_salesTimeAxis);
+    m_salesSeries->attachAxis(m_salesValueAxis);
+
+    m_salesChartView = new QChartView(chart, ui->salesChartContainer);
+    m_salesChartView->setRenderHint(QPainter::Antialiasing);
+    m_salesChartView->setRubberBand(QChartView::HorizontalRubberBand); // Drag to zoom, right-click to zoom out
+    ui->salesChartLayout->addWidget(m_salesChartView);
+
+    // Per-sale series are reduced to the plot width off the UI thread
+    m_downsampler = new ChartDownsampler(this);
+    connect(m_downsampler, &ChartDownsampler::ready, this, [this](const QList<QPointF> &points) {
+        if (m_showingEverySale) {
+            m_salesSeries->replace(points);
+        }
+    });
+    connect(chart, &QChart::plotAreaChanged, this, [this](const QRectF &plotArea) {
+        m_downsampler->setTargetWidth(int(plotArea.width()));
+    });
+    connect(m_salesTimeAxis, &QDateTimeAxis::rangeChanged, this, [this](const QDateTime &min, const QDateTime &max) {
+        if (m_showingEverySale) {
+            m_downsampler->setRange(min.toMSecsSinceEpoch(), max.toMSecsSinceEpoch());
+        }
+    });
+
+    connect(ui->salesRangeComboBox, &QComboBox::currentIndexChanged, this, &DashboardPage::refreshSalesChart);
+}
+
+void DashboardPage::refreshSalesChart()
+{
+    if (!m_dbManager) {
+        return;
+    }
+
+    const SalesRange &range = SalesRanges[ui->salesRangeComboBox->currentData().toInt()];
+    const QDateTime to = QDateTime::currentDateTimeUtc();
+    const QDateTime from = to.addDays(-range.days);
+
+    m_showingEverySale = range.everySale;
+    ++m_salesGeneration; // Drops a per-sale load still running for the previous range
+    m_loadingSales = false;
+    m_lastSaleId = -1;
+    m_addedSales.clear(); // The new load reads them, or a later one does
+    if (m_showingEverySale) {
+        // Raw sales can run to hundreds of thousands of points; the downsampler hands
+        // back what fits the plot width and keeps up with zoom, pan and new sales.
+        m_salesFrom = from;
+        m_salesDay = QDate::currentDate();
+        m_maxAmount = 0.0;
+        m_salesTimeAxis->setFormat(range.days > 31 ? "MMM d yyyy" : "MMM d HH:mm");
+        showSalesMaximum();
+        m_downsampler->setSource({});
+        // Run the axis to the end of today so sales made while the page is open land
+        // inside the range and only touch their own bucket
+        const QDateTime endOfToday(m_salesDay.addDays(1), QTime(0, 0));
+        m_salesTimeAxis->setRange(from.toLocalTime(), endOfToday); // Also sets the downsampler's range
+        loadSales(false);
+        return;
+    }
+
+    // The rollup level is chosen so the chart never pulls more than a few hundred rows
+    DatabaseManager::SeriesResolution resolution = DatabaseManager::Hourly;
+    const QList<SalesPoint> points = m_dbManager->getSalesSeries(from, to, 400, &resolution);
+
+    QList<QPointF> data;
+    data.reserve(points.size());
+    double maxRevenue = 0.0;
+    for (const auto &point : points) {
+        data.append(QPointF(point.bucket.toMSecsSinceEpoch(), point.revenue));
+        maxRevenue = qMax(maxRevenue, point.revenue);
+    }
+    m_salesSeries->replace(data); // One update instead of a signal per point
+
+    switch (resolution) {
+    case DatabaseManager::Hourly:
+        m_salesTimeAxis->setFormat("MMM d HH:mm");
+        break;
+    case DatabaseManager::Daily:
+        m_salesTimeAxis->setFormat("MMM d");
+        break;
+    case DatabaseManager::Monthly:
+        m_salesTimeAxis->setFormat("MMM yyyy");
+        break;
+    }
+    m_salesTimeAxis->setRange(from.toLocalTime(), to.toLocalTime());
+    m_salesValueAxis->setRange(0.0, maxRevenue > 0.0 ? maxRevenue * 1.1 : 1.0);
 }
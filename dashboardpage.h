@@ -1,6 +1,8 @@
 #ifndef DASHBOARDPAGE_H
 #define DASHBOARDPAGE_H
 
+#include <QDate>
+#include <QHash>
 #include <QWidget>
 #include "databasemanager.h" // For DatabaseManager class
 
@@ -8,6 +10,12 @@ namespace Ui {
 class DashboardPage;
 }
 
+class ChartDownsampler;
+class QChartView;
+class QDateTimeAxis;
+class QLineSeries;
+class QValueAxis;
+
 class DashboardPage : public QWidget
 {
     Q_OBJECT
@@ -18,9 +26,36 @@ public:
 
 public slots:
     void refreshData(DatabaseManager *dbManager);
+    void addSale(const QString &uuid, const QDateTime &when, double amount);
+
+private slots:
+    void refreshSalesChart();
 
 private:
+    void setupSalesChart();
+    void loadSales(bool newOnly);
+    void showSalesMaximum();
+
     Ui::DashboardPage *ui;
+    DatabaseManager *m_dbManager;
+    QChartView *m_salesChartView;
+    QLineSeries *m_salesSeries;
+    QDateTimeAxis *m_salesTimeAxis;
+    QValueAxis *m_salesValueAxis;
+    ChartDownsampler *m_downsampler; // Used for the per-sale ranges
+    bool m_showingEverySale;
+
+    // Per-sale ranges load on a pool thread; replica refreshes then only read the
+    // sales added since. Sales added by addSale are remembered until a load brings
+    // them in, so they are not plotted twice.
+    QDateTime m_salesFrom;
+    QDate m_salesDay; // The axis runs to the end of this day
+    qint64 m_lastSaleId; // -1 until the range has been loaded
+    double m_maxAmount;
+    QHash<QString, QPointF> m_addedSales; // By uuid
+    quint64 m_salesGeneration; // Loads for a range no longer shown are dropped
+    bool m_loadingSales;
+    bool m_loadQueued; // A refresh came in while loading
 };
 
 #endif // DASHBOARDPAGE_H
@@ -7,167 +7,2138 @@
 #include <optional>
 
 #include <QDate>
+#include <QTimeZone>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+DatabaseManager::DatabaseManager(const QString &connectionName, const QString &databasePath)
+{
+    // An empty name keeps Qt's default connection, which the UI's QSqlTableModels rely on.
+    // Background stages (e.g. the checkout pipeline) pass their own name because a
+    // QSqlDatabase connection may only be used from the thread that created it.
+    if (connectionName.isEmpty()) {
+        m_db = QSqlDatabase::addDatabase("QSQLITE");
+    } else {
+        m_db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    }
+    m_db.setDatabaseName(databasePath);
+
+    if (!m_db.open()) {
+        qDebug() << "Error: connection with database failed:" << m_db.lastError();
+    } else {
+        qDebug() << "Database: connection ok" << m_db.connectionName();
+
+        // WAL lets the UI keep reading while a background connection commits,
+        // and the busy timeout makes writers wait for each other instead of failing.
+        QSqlQuery pragma(m_db);
+        if (!pragma.exec("PRAGMA journal_mode = WAL;")) {
+            qDebug() << "Error: failed to enable WAL mode:" << pragma.lastError();
+        }
+        if (!pragma.exec("PRAGMA busy_timeout = 5000;")) {
+            qDebug() << "Error: failed to set busy timeout:" << pragma.lastError();
+        }
+    }
+}
+
+DatabaseManager::~DatabaseManager()
+{
+    const QString connectionName = m_db.connectionName();
+    if (m_db.isOpen()) {
+        m_db.close();
+    }
+    m_db = QSqlDatabase(); // Drop our handle so the connection can be removed
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+bool DatabaseManager::ensureColumn(const QString &table, const QString &column, const QString &definition)
+{
+    // The table may name an attached schema ("archive.SaleItems")
+    const int dot = table.indexOf('.');
+    const QString tableInfo = dot < 0 ? QString("PRAGMA table_info(%1);").arg(table)
+                                      : QString("PRAGMA %1.table_info(%2);").arg(table.left(dot), table.mid(dot + 1));
+    QSqlQuery query(m_db);
+    if (!query.exec(tableInfo)) {
+        qDebug() << "Error: failed to get table info for" << table << ":" << query.lastError();
+        return false;
+    }
+    while (query.next()) {
+        if (query.value("name").toString() == column) {
+            return true;
+        }
+    }
+    if (!query.exec(QString("ALTER TABLE %1 ADD COLUMN %2 %3;").arg(table, column, definition))) {
+        qDebug() << "Error: failed to add" << column << "column to" << table << "table:" << query.lastError();
+        return false;
+    }
+    qDebug() << "Added" << column << "column to" << table << "table.";
+    return true;
+}
+
+void DatabaseManager::init()
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return;
+    }
+
+    QSqlQuery query(m_db);
+
+    // Only takes effect on a new database (before any table exists); it lets the
+    // maintenance scheduler hand free pages back a few at a time.
+    if (!query.exec("PRAGMA auto_vacuum = INCREMENTAL;")) {
+        qDebug() << "Error: failed to set auto_vacuum mode:" << query.lastError();
+    }
+
+    // Create Products table
+    if (!query.exec("CREATE TABLE IF NOT EXISTS Products ("
+                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                    "name TEXT NOT NULL, "
+                    "description TEXT, "
+                    "price REAL NOT NULL, "
+                    "quantity INTEGER NOT NULL, "
+                    "image_path TEXT"
+                    ");")) {
+        qDebug() << "Error: failed to create Products table:" << query.lastError();
+    } else {
+        // Add image_path column if it doesn't exist
+        ensureColumn("Products", "image_path", "TEXT");
+    }
+
+    // Create Sales table
+    if (!query.exec("CREATE TABLE IF NOT EXISTS Sales ("
+                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                    "sale_date TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+                    "total_amount REAL NOT NULL, "
+                    "user_id INTEGER REFERENCES Users(id)"
+                    ");")) {
+        qDebug() << "Error: failed to create Sales table:" << query.lastError();
+    } else {
+        // Client-generated sale IDs make resubmitted sales idempotent
+        ensureColumn("Sales", "client_uuid", "TEXT");
+        if (!query.exec("CREATE UNIQUE INDEX IF NOT EXISTS idx_sales_client_uuid ON Sales(client_uuid);")) {
+            qDebug() << "Error: failed to create client_uuid index:" << query.lastError();
+        }
+    }
+
+    // Create SaleItems table
+    if (!query.exec("CREATE TABLE IF NOT EXISTS SaleItems ("
+                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                    "sale_id INTEGER, "
+                    "product_id INTEGER, "
+                    "quantity_sold INTEGER NOT NULL, "
+                    "price_at_sale REAL NOT NULL, " // Unit price before promotions
+                    "discount REAL NOT NULL DEFAULT 0, " // Promotions off the whole line
+                    "FOREIGN KEY (sale_id) REFERENCES Sales(id), "
+                    "FOREIGN KEY (product_id) REFERENCES Products(id)"
+                    ");")) {
+        qDebug() << "Error: failed to create SaleItems table:" << query.lastError();
+    } else {
+        ensureColumn("SaleItems", "discount", "REAL NOT NULL DEFAULT 0");
+    }
+
+    // Create Users table
+    if (!query.exec("CREATE TABLE IF NOT EXISTS Users ("
+                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                    "username TEXT NOT NULL UNIQUE, "
+                    "password_hash TEXT NOT NULL, "
+                    "role TEXT NOT NULL DEFAULT 'Admin'"
+                    ");")) {
+        qDebug() << "Error: failed to create Users table:" << query.lastError();
+    }
+
+    // Timings of idle-time maintenance tasks
+    if (!query.exec("CREATE TABLE IF NOT EXISTS MaintenanceLog ("
+                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+                    "finished_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+                    "task TEXT NOT NULL, "
+                    "duration_ms INTEGER NOT NULL, "
+                    "slices INTEGER NOT NULL, "
+                    "preempted INTEGER NOT NULL DEFAULT 0, "
+                    "result TEXT"
+                    ");")) {
+        qDebug() << "Error: failed to create MaintenanceLog table:" << query.lastError();
+    }
+
+    initSalesPartitions();
+    initSalesRollups();
+    initChangeTracking();
+    initZReports();
+    initStockMovements();
+    initPromotions();
+    initBasketMining();
+}
+
+void DatabaseManager::initStockMovements()
+{
+    // Every change to Products.quantity becomes a row in StockMovements, written by
+    // triggers so sales, edits, sync and future write paths are all covered. The
+    // writer says what kind of movement it is (and why) through the one-row
+    // StockMovementContext table for the length of its transaction; an update with
+    // no context is a manual adjustment, and a sync shows up as 'sync'.
+    QSqlQuery query(m_db);
+    const bool created = !m_db.tables().contains("StockMovements");
+    const QString kindOr = "CASE WHEN EXISTS (SELECT 1 FROM SyncMeta WHERE key = 'applying') THEN 'sync' "
+                           "ELSE COALESCE(C.kind, '%1') END";
+    const QString context = "FROM (SELECT 1) LEFT JOIN StockMovementContext C ON C.id = 1";
+    const QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS StockMovements ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, " // UTC, like sale_date
+        "product_id INTEGER NOT NULL, "
+        "delta INTEGER NOT NULL, "
+        "quantity_after INTEGER NOT NULL, "
+        "kind TEXT NOT NULL, " // sale, adjustment, receipt, stocktake, sync
+        "reason TEXT, "
+        "reference TEXT" // e.g. the sale id
+        ")",
+        "CREATE INDEX IF NOT EXISTS idx_stockmovements_product ON StockMovements(product_id, id)",
+        "CREATE TRIGGER IF NOT EXISTS trg_stockmovements_no_update BEFORE UPDATE ON StockMovements "
+        "BEGIN SELECT RAISE(ABORT, 'Stock movements are append-only'); END",
+        "CREATE TRIGGER IF NOT EXISTS trg_stockmovements_no_delete BEFORE DELETE ON StockMovements "
+        "BEGIN SELECT RAISE(ABORT, 'Stock movements are append-only'); END",
+        "CREATE TABLE IF NOT EXISTS StockMovementContext ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1), kind TEXT NOT NULL, reason TEXT, reference TEXT)",
+
+        // Whole-catalog quantities at a point in the ledger; a point-in-time query
+        // starts from the latest snapshot before it and adds the movements after
+        "CREATE TABLE IF NOT EXISTS StockSnapshots ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "taken_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+        "last_movement_id INTEGER NOT NULL" // Movements up to here are included
+        ")",
+        "CREATE INDEX IF NOT EXISTS idx_stocksnapshots_taken_at ON StockSnapshots(taken_at)",
+        "CREATE TABLE IF NOT EXISTS StockSnapshotItems ("
+        "snapshot_id INTEGER NOT NULL, "
+        "product_id INTEGER NOT NULL, "
+        "quantity INTEGER NOT NULL, "
+        "PRIMARY KEY (snapshot_id, product_id)"
+        ") WITHOUT ROWID",
+
+        QString("CREATE TRIGGER IF NOT EXISTS trg_products_stock_insert AFTER INSERT ON Products "
+                "WHEN NEW.quantity <> 0 BEGIN "
+                "INSERT INTO StockMovements (product_id, delta, quantity_after, kind, reason, reference) "
+                "SELECT NEW.id, NEW.quantity, NEW.quantity, %1, COALESCE(C.reason, 'New product'), C.reference %2; "
+                "END").arg(kindOr.arg("receipt"), context),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_products_stock_update AFTER UPDATE OF quantity ON Products "
+                "WHEN NEW.quantity IS NOT OLD.quantity BEGIN "
+                "INSERT INTO StockMovements (product_id, delta, quantity_after, kind, reason, reference) "
+                "SELECT NEW.id, NEW.quantity - OLD.quantity, NEW.quantity, %1, C.reason, C.reference %2; "
+                "END").arg(kindOr.arg("adjustment"), context),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_products_stock_delete AFTER DELETE ON Products "
+                "WHEN OLD.quantity <> 0 BEGIN "
+                "INSERT INTO StockMovements (product_id, delta, quantity_after, kind, reason, reference) "
+                "SELECT OLD.id, -OLD.quantity, 0, %1, COALESCE(C.reason, 'Product deleted'), C.reference %2; "
+                "END").arg(kindOr.arg("adjustment"), context),
+    };
+    for (const QString &statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error: failed to set up stock movements:" << query.lastError();
+            return;
+        }
+    }
+
+    // History starts here: the first snapshot is the opening balance
+    if (created) {
+        takeStockSnapshot();
+    }
+}
+
+void DatabaseManager::initZReports()
+{
+    // End-of-day reports. A report describes a closed period, so once stored it
+    // never changes; the triggers turn any later edit into an error.
+    QSqlQuery query(m_db);
+    const char *statements[] = {
+        "CREATE TABLE IF NOT EXISTS ZReports ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "period_start TEXT NOT NULL, " // UTC, like sale_date
+        "period_end TEXT NOT NULL, "
+        "generated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
+        "sale_count INTEGER NOT NULL, "
+        "revenue REAL NOT NULL, "
+        "summary TEXT NOT NULL, " // JSON with every breakdown
+        "UNIQUE (period_start, period_end)"
+        ")",
+        "CREATE TRIGGER IF NOT EXISTS trg_zreports_no_update BEFORE UPDATE ON ZReports "
+        "BEGIN SELECT RAISE(ABORT, 'Z-reports are immutable'); END",
+        "CREATE TRIGGER IF NOT EXISTS trg_zreports_no_delete BEFORE DELETE ON ZReports "
+        "BEGIN SELECT RAISE(ABORT, 'Z-reports are immutable'); END",
+        // A report reads one period's sales and their items
+        "CREATE INDEX IF NOT EXISTS idx_sales_sale_date ON Sales(sale_date)",
+        "CREATE INDEX IF NOT EXISTS idx_saleitems_sale_id ON SaleItems(sale_id)",
+    };
+    for (const char *statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error: failed to set up Z-reports:" << query.lastError();
+            return;
+        }
+    }
+}
+
+void DatabaseManager::initPromotions()
+{
+    // Promotion rules and the products each one covers. Times are local, since a
+    // happy hour follows the shop's clock; see PromotionEngine for how they combine.
+    QSqlQuery query(m_db);
+    const char *statements[] = {
+        "CREATE TABLE IF NOT EXISTS Promotions ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "name TEXT NOT NULL, "
+        "kind TEXT NOT NULL CHECK (kind IN ('percent', 'buy_x_get_y', 'bundle')), "
+        "priority INTEGER NOT NULL DEFAULT 0, "
+        "percent REAL CHECK (percent > 0 AND percent <= 100), "
+        "buy_quantity INTEGER, "
+        "free_quantity INTEGER, "
+        "bundle_price REAL, "
+        "starts_at TEXT, " // 'YYYY-MM-DD HH:MM:SS'; NULL for no limit
+        "ends_at TEXT, "
+        "daily_from TEXT, " // 'HH:MM'; NULL for all day
+        "daily_to TEXT, "
+        "weekdays INTEGER NOT NULL DEFAULT 127, " // Bit 0 is Monday
+        "enabled INTEGER NOT NULL DEFAULT 1"
+        ")",
+        "CREATE TABLE IF NOT EXISTS PromotionProducts ("
+        "promotion_id INTEGER NOT NULL REFERENCES Promotions(id) ON DELETE CASCADE, "
+        "product_id INTEGER NOT NULL, "
+        "quantity INTEGER NOT NULL DEFAULT 1, " // Units per bundle
+        "PRIMARY KEY (promotion_id, product_id)"
+        ") WITHOUT ROWID",
+    };
+    for (const char *statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error: failed to set up promotions:" << query.lastError();
+            return;
+        }
+    }
+}
+
+void DatabaseManager::initBasketMining()
+{
+    // How often each pair of products shares a basket (stored both ways round, so a
+    // product's pairs are one index range), the top few per product for the till,
+    // and the last sale counted.
+    QSqlQuery query(m_db);
+    const char *statements[] = {
+        "CREATE TABLE IF NOT EXISTS ProductPairs ("
+        "product_id INTEGER NOT NULL, "
+        "other_id INTEGER NOT NULL, "
+        "count INTEGER NOT NULL, "
+        "PRIMARY KEY (product_id, other_id)"
+        ") WITHOUT ROWID",
+        "CREATE TABLE IF NOT EXISTS ProductNeighbours ("
+        "product_id INTEGER NOT NULL, "
+        "rank INTEGER NOT NULL, "
+        "neighbour_id INTEGER NOT NULL, "
+        "count INTEGER NOT NULL, "
+        "PRIMARY KEY (product_id, rank)"
+        ") WITHOUT ROWID",
+        "CREATE TABLE IF NOT EXISTS BasketMiningState ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1), "
+        "last_sale_id INTEGER NOT NULL, "
+        "updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+        ")",
+    };
+    for (const char *statement : statements) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error: failed to set up basket mining:" << query.lastError();
+            return;
+        }
+    }
+}
+
+void DatabaseManager::initChangeTracking()
+{
+    // Row-level change log used by SyncEngine to merge shops' databases. Rows are
+    // matched across databases by Products.uuid, Users.username and Sales.client_uuid.
+    // Local changes are logged with a NULL origin; changes applied by a sync carry
+    // the site they came from, so they can be forwarded without coming back.
+    // While a sync applies changes it sets SyncMeta 'applying' (inside its own
+    // transaction, so no other connection sees it) and the triggers stay quiet.
+    QSqlQuery query(m_db);
+    const bool newLog = !m_db.tables().contains("ChangeLog");
+
+    ensureColumn("Products", "uuid", "TEXT");
+    ensureColumn("Products", "catalog_updated_at", "TEXT"); // Last edit of name/description/price/image
+    ensureColumn("Users", "updated_at", "TEXT");
+
+    const QString now = "STRFTIME('%Y-%m-%d %H:%M:%f', 'now')";
+    const QString notApplying = "NOT EXISTS (SELECT 1 FROM SyncMeta WHERE key = 'applying')";
+    QStringList statements = {
+        "CREATE TABLE IF NOT EXISTS SyncMeta (key TEXT PRIMARY KEY, value TEXT)",
+        "INSERT OR IGNORE INTO SyncMeta (key, value) VALUES ('site_id', LOWER(HEX(RANDOMBLOB(16))))",
+        "CREATE TABLE IF NOT EXISTS ChangeLog ("
+        "seq INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "origin TEXT, "            // Site that made the change; NULL for this database
+        "origin_seq INTEGER, "     // Its seq at the origin; NULL for this database
+        "table_name TEXT NOT NULL, "
+        "row_key TEXT NOT NULL, "
+        "op TEXT NOT NULL, "       // I, U or D
+        "qty_delta INTEGER NOT NULL DEFAULT 0, " // Products: change in quantity
+        "changed_at TEXT NOT NULL"
+        ")",
+        // Highest origin_seq applied from each site, and how far each peer's log was read
+        "CREATE TABLE IF NOT EXISTS SyncProgress (origin TEXT PRIMARY KEY, last_seq INTEGER NOT NULL)",
+        "CREATE TABLE IF NOT EXISTS SyncPeers (peer TEXT PRIMARY KEY, last_seq INTEGER NOT NULL)",
+        "UPDATE Products SET uuid = LOWER(HEX(RANDOMBLOB(16))) WHERE uuid IS NULL",
+        "UPDATE Products SET catalog_updated_at = '1970-01-01 00:00:00.000' WHERE catalog_updated_at IS NULL",
+        "UPDATE Users SET updated_at = '1970-01-01 00:00:00.000' WHERE updated_at IS NULL",
+        "UPDATE Sales SET client_uuid = LOWER(HEX(RANDOMBLOB(16))) WHERE client_uuid IS NULL",
+        "CREATE UNIQUE INDEX IF NOT EXISTS idx_products_uuid ON Products(uuid)",
+
+        QString("CREATE TRIGGER IF NOT EXISTS trg_products_log_insert AFTER INSERT ON Products BEGIN "
+                "UPDATE Products SET uuid = COALESCE(uuid, LOWER(HEX(RANDOMBLOB(16)))), "
+                "catalog_updated_at = COALESCE(catalog_updated_at, %1) WHERE id = NEW.id; "
+                "INSERT INTO ChangeLog (table_name, row_key, op, qty_delta, changed_at) "
+                "SELECT 'Products', uuid, 'I', NEW.quantity, %1 FROM Products WHERE id = NEW.id AND %2; "
+                "END").arg(now, notApplying),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_products_log_update "
+                "AFTER UPDATE OF name, description, price, quantity, image_path ON Products BEGIN "
+                "UPDATE Products SET catalog_updated_at = %1 WHERE id = NEW.id AND %2 AND "
+                "(NEW.name IS NOT OLD.name OR NEW.description IS NOT OLD.description "
+                "OR NEW.price IS NOT OLD.price OR NEW.image_path IS NOT OLD.image_path); "
+                "INSERT INTO ChangeLog (table_name, row_key, op, qty_delta, changed_at) "
+                "SELECT 'Products', NEW.uuid, 'U', NEW.quantity - OLD.quantity, %1 WHERE %2; "
+                "END").arg(now, notApplying),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_products_log_delete AFTER DELETE ON Products BEGIN "
+                "INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                "SELECT 'Products', OLD.uuid, 'D', %1 WHERE %2; "
+                "END").arg(now, notApplying),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_users_log_insert AFTER INSERT ON Users BEGIN "
+                "UPDATE Users SET updated_at = COALESCE(updated_at, %1) WHERE id = NEW.id; "
+                "INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                "SELECT 'Users', NEW.username, 'I', %1 WHERE %2; "
+                "END").arg(now, notApplying),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_users_log_update "
+                "AFTER UPDATE OF username, password_hash, role ON Users BEGIN "
+                "UPDATE Users SET updated_at = %1 WHERE id = NEW.id AND %2; "
+                "INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                "SELECT 'Users', OLD.username, 'D', %1 WHERE NEW.username IS NOT OLD.username AND %2; "
+                "INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                "SELECT 'Users', NEW.username, 'U', %1 WHERE %2; "
+                "END").arg(now, notApplying),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_users_log_delete AFTER DELETE ON Users BEGIN "
+                "INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                "SELECT 'Users', OLD.username, 'D', %1 WHERE %2; "
+                "END").arg(now, notApplying),
+        // Sales are only ever inserted; deletes come from the archiver and stay local
+        QString("CREATE TRIGGER IF NOT EXISTS trg_sales_log_insert AFTER INSERT ON Sales BEGIN "
+                "UPDATE Sales SET client_uuid = LOWER(HEX(RANDOMBLOB(16))) WHERE id = NEW.id AND client_uuid IS NULL; "
+                "INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                "SELECT 'Sales', client_uuid, 'I', %1 FROM Sales WHERE id = NEW.id AND %2; "
+                "END").arg(now, notApplying),
+        QString("CREATE TRIGGER IF NOT EXISTS trg_saleitems_log_insert AFTER INSERT ON SaleItems BEGIN "
+                "INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                "SELECT 'SaleItems', client_uuid, 'I', %1 FROM Sales WHERE id = NEW.sale_id AND %2; "
+                "END").arg(now, notApplying),
+    };
+
+    // A store that predates change tracking logs its current rows once, so the
+    // first sync carries everything
+    if (newLog) {
+        statements += {
+            QString("INSERT INTO ChangeLog (table_name, row_key, op, qty_delta, changed_at) "
+                    "SELECT 'Products', uuid, 'I', quantity, %1 FROM Products ORDER BY id").arg(now),
+            QString("INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                    "SELECT 'Users', username, 'I', %1 FROM Users ORDER BY id").arg(now),
+            QString("INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                    "SELECT 'Sales', client_uuid, 'I', %1 FROM Sales ORDER BY id").arg(now),
+            QString("INSERT INTO ChangeLog (table_name, row_key, op, changed_at) "
+                    "SELECT DISTINCT 'SaleItems', S.client_uuid, 'I', %1 FROM SaleItems SI "
+                    "JOIN Sales S ON SI.sale_id = S.id ORDER BY S.id").arg(now),
+        };
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start change tracking setup transaction:" << m_db.lastError();
+        return;
+    }
+    for (const QString &statement : std::as_const(statements)) {
+        if (!query.exec(statement)) {
+            qDebug() << "Error: failed to set up change tracking:" << query.lastError();
+            m_db.rollback();
+            return;
+        }
+    }
+    m_db.commit();
+}
+
+namespace {
+// Rollup resolutions, finest first. Buckets are UTC, like Sales.sale_date.
+struct RollupLevel {
+    DatabaseManager::SeriesResolution resolution;
+    const char *table;
+    const char *bucketFormat; // strftime() format turning a timestamp into its bucket
+};
+
+const RollupLevel RollupLevels[] = {
+    { DatabaseManager::Hourly, "SalesRollupHourly", "%Y-%m-%d %H:00:00" },
+    { DatabaseManager::Daily, "SalesRollupDaily", "%Y-%m-%d 00:00:00" },
+    { DatabaseManager::Monthly, "SalesRollupMonthly", "%Y-%m-01 00:00:00" },
+};
+}
+
+void DatabaseManager::initSalesRollups()
+{
+    // Revenue/units per hour, day and month, kept current by triggers so every
+    // write path (checkout, journal replay, imports) maintains them.
+    QSqlQuery query(m_db);
+    bool needsBackfill = false;
+    for (const auto &level : RollupLevels) {
+        const QString table = level.table;
+        if (!m_db.tables().contains(table)) {
+            needsBackfill = true;
+        }
+        if (!query.exec(QString("CREATE TABLE IF NOT EXISTS %1 ("
+                                "bucket TEXT PRIMARY KEY, "
+                                "revenue REAL NOT NULL DEFAULT 0, "
+                                "units INTEGER NOT NULL DEFAULT 0, "
+                                "sales INTEGER NOT NULL DEFAULT 0"
+                                ");").arg(table))) {
+            qDebug() << "Error: failed to create" << table << "table:" << query.lastError();
+            return;
+        }
+    }
+
+    QString saleTrigger = "CREATE TRIGGER IF NOT EXISTS trg_sales_rollup AFTER INSERT ON Sales BEGIN ";
+    QString itemTrigger = "CREATE TRIGGER IF NOT EXISTS trg_saleitems_rollup AFTER INSERT ON SaleItems BEGIN ";
+    for (const auto &level : RollupLevels) {
+        saleTrigger += QString("INSERT INTO %1 (bucket, revenue, sales) "
+                               "VALUES (STRFTIME('%2', NEW.sale_date), NEW.total_amount, 1) "
+                               "ON CONFLICT(bucket) DO UPDATE SET revenue = revenue + excluded.revenue, sales = sales + 1; ")
+                           .arg(level.table, level.bucketFormat);
+        itemTrigger += QString("INSERT INTO %1 (bucket, units) "
+                               "SELECT STRFTIME('%2', sale_date), NEW.quantity_sold FROM Sales WHERE id = NEW.sale_id "
+                               "ON CONFLICT(bucket) DO UPDATE SET units = units + excluded.units; ")
+                           .arg(level.table, level.bucketFormat);
+    }
+    saleTrigger += "END;";
+    itemTrigger += "END;";
+    if (!query.exec(saleTrigger) || !query.exec(itemTrigger)) {
+        qDebug() << "Error: failed to create sales rollup triggers:" << query.lastError();
+        return;
+    }
+
+    if (needsBackfill) {
+        rebuildSalesRollups();
+    }
+}
+
+bool DatabaseManager::rebuildSalesRollups()
+{
+    // Archived months are no longer in Sales, so only the buckets after the
+    // newest archived period are rebuilt; older buckets keep their history.
+    QString liveFrom;
+    QSqlQuery periodQuery("SELECT MAX(period) FROM SalesPartitions", m_db);
+    if (periodQuery.next() && !periodQuery.value(0).isNull()) {
+        liveFrom = QDate::fromString(periodQuery.value(0).toString() + "-01", "yyyy-MM-dd")
+                       .addMonths(1).toString("yyyy-MM-dd 00:00:00");
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start rollup rebuild transaction:" << m_db.lastError();
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    for (const auto &level : RollupLevels) {
+        const bool ok =
+            query.exec(QString("DELETE FROM %1 WHERE bucket >= '%2';").arg(level.table, liveFrom)) &&
+            // One grouped pass per level: units are summed per sale first, so a sale's
+            // revenue is counted once however many lines it has
+            query.exec(QString("INSERT INTO %1 (bucket, revenue, units, sales) "
+                               "SELECT STRFTIME('%2', S.sale_date), SUM(S.total_amount), SUM(COALESCE(I.units, 0)), COUNT(*) "
+                               "FROM Sales S LEFT JOIN ("
+                               "SELECT sale_id, SUM(quantity_sold) AS units FROM SaleItems GROUP BY sale_id"
+                               ") I ON I.sale_id = S.id "
+                               "WHERE S.sale_date >= '%3' GROUP BY 1;")
+                           .arg(level.table, level.bucketFormat, liveFrom));
+        if (!ok) {
+            qDebug() << "Error: failed to rebuild" << level.table << ":" << query.lastError();
+            m_db.rollback();
+            return false;
+        }
+    }
+
+    qDebug() << "Rebuilt sales rollups from raw sales";
+    return m_db.commit();
+}
+
+QList<SalesPoint> DatabaseManager::getSalesSeries(const QDateTime &from, const QDateTime &to, int maxPoints,
+                                                  SeriesResolution *resolution) const
+{
+    QList<SalesPoint> points;
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return points;
+    }
+
+    // Serve the range from the finest rollup that stays within maxPoints rows
+    const qint64 seconds = qMax<qint64>(1, from.secsTo(to));
+    const qint64 bucketSeconds[] = { 3600, 86400, 31 * 86400 };
+    int levelIndex = 0;
+    while (levelIndex < 2 && seconds / bucketSeconds[levelIndex] > maxPoints) {
+        levelIndex++;
+    }
+    const RollupLevel &level = RollupLevels[levelIndex];
+    if (resolution) {
+        *resolution = level.resolution;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare(QString("SELECT bucket, revenue, units FROM %1 "
+                          "WHERE bucket >= STRFTIME('%2', :from) AND bucket <= :to ORDER BY bucket")
+                      .arg(level.table, level.bucketFormat));
+    query.bindValue(":from", from.toUTC().toString("yyyy-MM-dd HH:mm:ss"));
+    query.bindValue(":to", to.toUTC().toString("yyyy-MM-dd HH:mm:ss"));
+    if (!query.exec()) {
+        qDebug() << "Error getting sales series:" << query.lastError();
+        return points;
+    }
+
+    while (query.next()) {
+        QDateTime bucket = QDateTime::fromString(query.value(0).toString(), "yyyy-MM-dd HH:mm:ss");
+        bucket.setTimeZone(QTimeZone::utc());
+        points.append({ bucket, query.value(1).toDouble(), query.value(2).toInt() });
+    }
+    return points;
+}
+
+void DatabaseManager::initSalesPartitions()
+{
+    // Closed months are moved out of Sales into archive/sales-YYYY-MM.db. This
+    // catalog records where each month went, together with the totals the
+    // dashboard needs, so most reports never have to attach an archive file.
+    QSqlQuery query(m_db);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS SalesPartitions ("
+                    "period TEXT PRIMARY KEY, " // YYYY-MM, UTC like sale_date
+                    "file TEXT NOT NULL, "      // Relative to the database directory
+                    "min_sale_id INTEGER, "
+                    "max_sale_id INTEGER, "
+                    "sales_count INTEGER NOT NULL DEFAULT 0, "
+                    "revenue REAL NOT NULL DEFAULT 0, "
+                    "archived_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP"
+                    ");")) {
+        qDebug() << "Error: failed to create SalesPartitions table:" << query.lastError();
+    }
+    if (!query.exec("CREATE TABLE IF NOT EXISTS SalesPartitionProducts ("
+                    "period TEXT NOT NULL, "
+                    "product_id INTEGER NOT NULL, "
+                    "units INTEGER NOT NULL DEFAULT 0, "
+                    "PRIMARY KEY (period, product_id)"
+                    ");")) {
+        qDebug() << "Error: failed to create SalesPartitionProducts table:" << query.lastError();
+    }
+
+    // Months archived before SaleItems had a discount column get it too, so every
+    // reader can select it from any archive file
+    QStringList files;
+    if (query.exec("SELECT file FROM SalesPartitions")) {
+        while (query.next()) {
+            files.append(query.value(0).toString());
+        }
+    }
+    for (const QString &file : std::as_const(files)) {
+        if (QFileInfo::exists(partitionPath(file)) && attachPartition(file, "archive")) {
+            ensureColumn("archive.SaleItems", "discount", "REAL NOT NULL DEFAULT 0");
+            detachDatabase("archive");
+        }
+    }
+}
+
+QString DatabaseManager::partitionPath(const QString &file) const
+{
+    return QFileInfo(m_db.databaseName()).absoluteDir().filePath(file);
+}
+
+bool DatabaseManager::attachDatabase(const QString &filePath, const QString &alias) const
+{
+    QSqlQuery query(m_db);
+    query.prepare(QString("ATTACH DATABASE :file AS %1").arg(alias));
+    query.bindValue(":file", filePath);
+    if (!query.exec()) {
+        qDebug() << "Error: failed to attach" << filePath << ":" << query.lastError();
+        return false;
+    }
+    return true;
+}
+
+void DatabaseManager::detachDatabase(const QString &alias) const
+{
+    QSqlQuery query(m_db);
+    if (!query.exec(QString("DETACH DATABASE %1").arg(alias))) {
+        qDebug() << "Error: failed to detach" << alias << ":" << query.lastError();
+    }
+}
+
+bool DatabaseManager::attachPartition(const QString &file, const QString &alias) const
+{
+    return attachDatabase(partitionPath(file), alias);
+}
+
+int DatabaseManager::archiveClosedMonths(int monthsToKeep)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return 0;
+    }
+
+    // Always keep the current month live; getSalesCountForThisMonth and the
+    // last-7-days view only read the Sales table.
+    const QDate thisMonth = QDateTime::currentDateTimeUtc().date();
+    const QDate cutoff = QDate(thisMonth.year(), thisMonth.month(), 1).addMonths(-qMax(0, monthsToKeep));
+
+    QStringList periods;
+    QSqlQuery query(m_db);
+    query.prepare("SELECT DISTINCT STRFTIME('%Y-%m', sale_date) FROM Sales WHERE sale_date < :cutoff ORDER BY 1");
+    query.bindValue(":cutoff", cutoff.toString("yyyy-MM-dd 00:00:00"));
+    if (!query.exec()) {
+        qDebug() << "Error: failed to list closed sales months:" << query.lastError();
+        return 0;
+    }
+    while (query.next()) {
+        periods.append(query.value(0).toString());
+    }
+
+    int archived = 0;
+    for (const QString &period : periods) {
+        if (!archivePeriod(period)) {
+            break; // Keep months in order; try again next time
+        }
+        ++archived;
+    }
+    return archived;
+}
+
+bool DatabaseManager::archivePeriod(const QString &period)
+{
+    const QDate monthStart = QDate::fromString(period + "-01", "yyyy-MM-dd");
+    if (!monthStart.isValid()) {
+        qDebug() << "Error: invalid sales period" << period;
+        return false;
+    }
+    const QString from = monthStart.toString("yyyy-MM-dd 00:00:00");
+    const QString to = monthStart.addMonths(1).toString("yyyy-MM-dd 00:00:00");
+    const QString file = QString("archive/sales-%1.db").arg(period);
+
+    if (!QDir().mkpath(QFileInfo(partitionPath(file)).absolutePath())) {
+        qDebug() << "Error: failed to create sales archive directory for" << file;
+        return false;
+    }
+    // ATTACH is not allowed inside a transaction, so it wraps the move
+    if (!attachPartition(file, "archive")) {
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    const bool schemaOk =
+        query.exec("CREATE TABLE IF NOT EXISTS archive.Sales ("
+                   "id INTEGER PRIMARY KEY, "
+                   "sale_date TIMESTAMP, "
+                   "total_amount REAL NOT NULL, "
+                   "user_id INTEGER, "
+                   "client_uuid TEXT UNIQUE"
+                   ");") &&
+        query.exec("CREATE TABLE IF NOT EXISTS archive.SaleItems ("
+                   "id INTEGER PRIMARY KEY, "
+                   "sale_id INTEGER, "
+                   "product_id INTEGER, "
+                   "quantity_sold INTEGER NOT NULL, "
+                   "price_at_sale REAL NOT NULL, "
+                   "discount REAL NOT NULL DEFAULT 0"
+                   ");") &&
+        query.exec("CREATE INDEX IF NOT EXISTS archive.idx_saleitems_sale_id ON SaleItems(sale_id);");
+    if (!schemaOk) {
+        qDebug() << "Error: failed to create sales archive schema in" << file << ":" << query.lastError();
+        detachDatabase("archive");
+        return false;
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start archive transaction:" << m_db.lastError();
+        detachDatabase("archive");
+        return false;
+    }
+
+    // Copy first, then delete. With WAL the commit is atomic per file only, so
+    // the copies use OR IGNORE: if a crash leaves a month half-moved, running
+    // the archiver again finishes the job without duplicating rows.
+    const QString monthSales = "SELECT id FROM main.Sales WHERE sale_date >= :from AND sale_date < :to";
+    auto run = [&](const QString &sql) {
+        query.prepare(sql);
+        query.bindValue(":from", from);
+        query.bindValue(":to", to);
+        if (!query.exec()) {
+            qDebug() << "Error: failed to archive sales for" << period << ":" << query.lastError();
+            return false;
+        }
+        return true;
+    };
+
+    const bool ok =
+        run("INSERT OR IGNORE INTO archive.Sales (id, sale_date, total_amount, user_id, client_uuid) "
+            "SELECT id, sale_date, total_amount, user_id, client_uuid FROM main.Sales "
+            "WHERE sale_date >= :from AND sale_date < :to") &&
+        run("INSERT OR IGNORE INTO archive.SaleItems (id, sale_id, product_id, quantity_sold, price_at_sale, discount) "
+            "SELECT id, sale_id, product_id, quantity_sold, price_at_sale, discount FROM main.SaleItems "
+            "WHERE sale_id IN (" + monthSales + ")") &&
+        run("DELETE FROM main.SaleItems WHERE sale_id IN (" + monthSales + ")") &&
+        run("DELETE FROM main.Sales WHERE sale_date >= :from AND sale_date < :to");
+
+    // Totals come from the archive file itself, so a re-run stays correct
+    bool catalogOk = false;
+    if (ok) {
+        query.prepare("INSERT OR REPLACE INTO main.SalesPartitions "
+                      "(period, file, min_sale_id, max_sale_id, sales_count, revenue) "
+                      "SELECT :period, :file, MIN(id), MAX(id), COUNT(*), COALESCE(SUM(total_amount), 0) "
+                      "FROM archive.Sales");
+        query.bindValue(":period", period);
+        query.bindValue(":file", file);
+        catalogOk = query.exec();
+        if (catalogOk) {
+            query.prepare("DELETE FROM main.SalesPartitionProducts WHERE period = :period");
+            query.bindValue(":period", period);
+            catalogOk = query.exec();
+        }
+        if (catalogOk) {
+            query.prepare("INSERT INTO main.SalesPartitionProducts (period, product_id, units) "
+                          "SELECT :period, product_id, SUM(quantity_sold) FROM archive.SaleItems GROUP BY product_id");
+            query.bindValue(":period", period);
+            catalogOk = query.exec();
+        }
+        if (!catalogOk) {
+            qDebug() << "Error: failed to record sales partition" << period << ":" << query.lastError();
+        }
+    }
+
+    if (!ok || !catalogOk) {
+        m_db.rollback();
+        detachDatabase("archive");
+        return false;
+    }
+    if (!m_db.commit()) {
+        qDebug() << "Failed to commit archive of" << period << ":" << m_db.lastError();
+        m_db.rollback();
+        detachDatabase("archive");
+        return false;
+    }
+
+    detachDatabase("archive");
+    qDebug() << "Archived sales for" << period << "to" << file;
+    return true;
+}
+
+bool DatabaseManager::snapshotTo(const QString &filePath)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    // VACUUM INTO writes a compacted, self-contained copy from one read
+    // transaction, so it is consistent without blocking writers under WAL.
+    QSqlQuery query(m_db);
+    query.prepare("VACUUM INTO :file");
+    query.bindValue(":file", filePath);
+    if (!query.exec()) {
+        qDebug() << "Error: failed to snapshot database to" << filePath << ":" << query.lastError();
+        return false;
+    }
+    return true;
+}
+
+namespace {
+// Tables copied into the analytics replica. Append-only tables are caught up by
+// id; the rest are small enough to copy whole on every refresh.
+struct ReplicaTable {
+    const char *name;
+    bool appendOnly;
+};
+
+const ReplicaTable ReplicaTables[] = {
+    { "Products", false },
+    { "Sales", true },
+    { "SaleItems", true },
+    { "SalesRollupHourly", false },
+    { "SalesRollupDaily", false },
+    { "SalesRollupMonthly", false },
+    { "SalesPartitions", false },
+    { "SalesPartitionProducts", false },
+};
+
+// Archive files attached per refresh to copy their sales into replica.ArchivedSales.
+// SQLite allows ten attachments by default and the replica itself takes one.
+const int MaxArchivesPerRefresh = 4;
+}
+
+bool DatabaseManager::refreshReplica(const QString &replicaPath)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+    if (!attachDatabase(replicaPath, "replica")) {
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    // Readers of the replica must not be blocked while it is refreshed
+    if (!query.exec("PRAGMA replica.journal_mode = WAL;")) {
+        qDebug() << "Error: failed to enable WAL mode on replica:" << query.lastError();
+    }
+
+    // Archived months are copied into the replica, so the Reports page can list them
+    // together with the live sales through SalesHistory without attaching every
+    // archive file. ArchivedPeriods records what each copy held; a month is copied
+    // again when the archiver has since moved more sales into it (synced sales keep
+    // their original dates). Months to copy are attached now, as DETACH is not
+    // allowed inside the transaction below.
+    if (!query.exec("CREATE TABLE IF NOT EXISTS replica.ArchivedSales ("
+                    "id INTEGER PRIMARY KEY, "
+                    "sale_date TIMESTAMP, "
+                    "total_amount REAL NOT NULL, "
+                    "user_id INTEGER, "
+                    "client_uuid TEXT, "
+                    "period TEXT NOT NULL"
+                    ");") ||
+        !query.exec("CREATE INDEX IF NOT EXISTS replica.idx_archivedsales_period ON ArchivedSales(period);") ||
+        !query.exec("CREATE TABLE IF NOT EXISTS replica.ArchivedPeriods ("
+                    "period TEXT PRIMARY KEY, "
+                    "sales_count INTEGER NOT NULL, "
+                    "max_sale_id INTEGER NOT NULL"
+                    ");") ||
+        !query.exec("CREATE VIEW IF NOT EXISTS replica.SalesHistory AS "
+                    "SELECT id, sale_date, total_amount, user_id, client_uuid FROM ArchivedSales "
+                    "UNION ALL "
+                    "SELECT id, sale_date, total_amount, user_id, client_uuid FROM Sales;")) {
+        qDebug() << "Error: failed to create replica sales history:" << query.lastError();
+    }
+    struct ArchiveCopy {
+        QString period;
+        QString alias;
+        qint64 salesCount;
+        qint64 maxSaleId;
+    };
+    QList<ArchiveCopy> archives;
+    QSqlQuery archiveQuery(m_db);
+    archiveQuery.prepare("SELECT P.period, P.file, P.sales_count, P.max_sale_id FROM main.SalesPartitions P "
+                         "WHERE NOT EXISTS (SELECT 1 FROM replica.ArchivedPeriods A WHERE A.period = P.period "
+                         "AND A.sales_count = P.sales_count AND A.max_sale_id = P.max_sale_id) "
+                         "ORDER BY P.period LIMIT :limit");
+    archiveQuery.bindValue(":limit", MaxArchivesPerRefresh);
+    if (archiveQuery.exec()) {
+        while (archiveQuery.next()) {
+            const QString alias = QString("archive%1").arg(archives.size());
+            if (attachPartition(archiveQuery.value(1).toString(), alias)) {
+                archives.append({ archiveQuery.value(0).toString(), alias,
+                                  archiveQuery.value(2).toLongLong(), archiveQuery.value(3).toLongLong() });
+            }
+        }
+    } else {
+        qDebug() << "Error: failed to look up archives to copy into the replica:" << archiveQuery.lastError();
+    }
+    auto detachArchives = [&]() {
+        for (const auto &archive : std::as_const(archives)) {
+            detachDatabase(archive.alias);
+        }
+    };
+
+    // One transaction, so the replica moves from one consistent state of the
+    // store to the next and readers never see a half-copied refresh.
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start replica refresh transaction:" << m_db.lastError();
+        detachArchives();
+        detachDatabase("replica");
+        return false;
+    }
+
+    auto schemaOf = [&](const QString &schema, const QString &table) {
+        QSqlQuery schemaQuery(m_db);
+        schemaQuery.prepare(QString("SELECT sql FROM %1.sqlite_master WHERE type = 'table' AND name = :name").arg(schema));
+        schemaQuery.bindValue(":name", table);
+        return schemaQuery.exec() && schemaQuery.next() ? schemaQuery.value(0).toString() : QString();
+    };
+
+    // Rows only leave the append-only tables when the archiver moves them out, which
+    // always changes the archive catalog; it is compared before the catalog itself is
+    // copied below. Synced sales archived into old months can have any id, so the
+    // rows to drop are found by id rather than below the lowest live id.
+    bool archivesChanged = true;
+    if (!schemaOf("main", "SalesPartitions").isEmpty() && !schemaOf("replica", "SalesPartitions").isEmpty()) {
+        QSqlQuery changed(m_db);
+        archivesChanged = !changed.exec("SELECT EXISTS (SELECT period, sales_count, max_sale_id FROM main.SalesPartitions "
+                                        "EXCEPT SELECT period, sales_count, max_sale_id FROM replica.SalesPartitions);") ||
+                          !changed.next() || changed.value(0).toBool();
+    }
+
+    bool ok = true;
+    for (const auto &table : ReplicaTables) {
+        const QString name = table.name;
+        const QString schema = schemaOf("main", name);
+        if (schema.isEmpty()) {
+            continue;
+        }
+
+        // New or changed table (e.g. a migration added a column): recreate it
+        // from the store's own definition, indexes included, and copy it whole.
+        bool recreated = false;
+        if (schemaOf("replica", name) != schema) {
+            QStringList statements = { QString("DROP TABLE IF EXISTS replica.%1").arg(name),
+                                       QString(schema).replace("CREATE TABLE ", "CREATE TABLE replica.") };
+            QSqlQuery indexQuery(m_db);
+            indexQuery.prepare("SELECT sql FROM main.sqlite_master "
+                               "WHERE type = 'index' AND tbl_name = :name AND sql IS NOT NULL");
+            indexQuery.bindValue(":name", name);
+            if (indexQuery.exec()) {
+                while (indexQuery.next()) {
+                    statements.append(indexQuery.value(0).toString().replace("INDEX ", "INDEX replica."));
+                }
+            }
+            for (const QString &statement : std::as_const(statements)) {
+                if (!(ok = query.exec(statement))) break;
+            }
+            recreated = true;
+        }
+
+        if (ok && table.appendOnly && !recreated) {
+            if (archivesChanged) {
+                ok = query.exec(QString("DELETE FROM replica.%1 WHERE NOT EXISTS "
+                                        "(SELECT 1 FROM main.%1 M WHERE M.id = replica.%1.id);").arg(name));
+            }
+            ok = ok &&
+                 query.exec(QString("INSERT INTO replica.%1 SELECT * FROM main.%1 "
+                                    "WHERE id > (SELECT COALESCE(MAX(id), 0) FROM replica.%1);").arg(name));
+        } else if (ok) {
+            ok = query.exec(QString("DELETE FROM replica.%1;").arg(name)) &&
+                 query.exec(QString("INSERT INTO replica.%1 SELECT * FROM main.%1;").arg(name));
+        }
+        if (!ok) {
+            qDebug() << "Error: failed to refresh replica table" << name << ":" << query.lastError();
+            break;
+        }
+    }
+
+    for (const auto &archive : std::as_const(archives)) {
+        if (!ok) break;
+        QSqlQuery clear(m_db);
+        clear.prepare("DELETE FROM replica.ArchivedSales WHERE period = :period");
+        clear.bindValue(":period", archive.period);
+        QSqlQuery copy(m_db);
+        copy.prepare(QString("INSERT OR IGNORE INTO replica.ArchivedSales "
+                             "(id, sale_date, total_amount, user_id, client_uuid, period) "
+                             "SELECT id, sale_date, total_amount, user_id, client_uuid, :period FROM %1.Sales").arg(archive.alias));
+        copy.bindValue(":period", archive.period);
+        QSqlQuery record(m_db);
+        record.prepare("INSERT OR REPLACE INTO replica.ArchivedPeriods (period, sales_count, max_sale_id) "
+                       "VALUES (:period, :sales_count, :max_sale_id)");
+        record.bindValue(":period", archive.period);
+        record.bindValue(":sales_count", archive.salesCount);
+        record.bindValue(":max_sale_id", archive.maxSaleId);
+        if (!(ok = clear.exec() && copy.exec() && record.exec())) {
+            qDebug() << "Error: failed to copy archived sales for" << archive.period << "into the replica:"
+                     << clear.lastError() << copy.lastError() << record.lastError();
+        }
+    }
+
+    if (!ok || !m_db.commit()) {
+        if (ok) {
+            qDebug() << "Failed to commit replica refresh:" << m_db.lastError();
+        }
+        m_db.rollback();
+        detachArchives();
+        detachDatabase("replica");
+        return false;
+    }
+
+    detachArchives();
+    detachDatabase("replica");
+    return true;
+}
+
+qint64 DatabaseManager::dataVersion() const
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return -1;
+    }
+
+    QSqlQuery query("PRAGMA data_version;", m_db);
+    if (query.next()) {
+        return query.value(0).toLongLong();
+    }
+    qDebug() << "Error getting data version:" << query.lastError();
+    return -1;
+}
+
+bool DatabaseManager::checkpoint(QString *result)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    // PASSIVE copies what it can without waiting on readers or writers
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA wal_checkpoint(PASSIVE);") || !query.next()) {
+        qDebug() << "Error: WAL checkpoint failed:" << query.lastError();
+        if (result) *result = query.lastError().text();
+        return false;
+    }
+    if (result) {
+        *result = QString("%1 of %2 WAL frames checkpointed").arg(query.value(2).toInt()).arg(query.value(1).toInt());
+    }
+    return true;
+}
+
+bool DatabaseManager::optimize(QString *result)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    // A row limit keeps any ANALYZE that optimize decides to run short
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA analysis_limit = 1000;") || !query.exec("PRAGMA optimize;")) {
+        qDebug() << "Error: PRAGMA optimize failed:" << query.lastError();
+        if (result) *result = query.lastError().text();
+        return false;
+    }
+    if (result) *result = "ok";
+    return true;
+}
+
+int DatabaseManager::incrementalVacuum(int pages)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return -1;
+    }
+
+    QSqlQuery query(m_db);
+    if (!query.exec("PRAGMA auto_vacuum;") || !query.next() || query.value(0).toInt() != 2) {
+        return -1; // Not in incremental mode; a full VACUUM would be needed
+    }
+    if (!query.exec(QString("PRAGMA incremental_vacuum(%1);").arg(pages))) {
+        qDebug() << "Error: incremental vacuum failed:" << query.lastError();
+        return -1;
+    }
+    while (query.next()) {} // Each step frees one page, so step to the end
+    if (query.exec("PRAGMA freelist_count;") && query.next()) {
+        return query.value(0).toInt();
+    }
+    return -1;
+}
+
+bool DatabaseManager::enableIncrementalVacuum(QString *result)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    if (query.exec("PRAGMA auto_vacuum;") && query.next() && query.value(0).toInt() == 2) {
+        if (result) *result = "already incremental";
+        return true;
+    }
+    // The new mode is only written into the file by a full VACUUM
+    if (!query.exec("PRAGMA auto_vacuum = INCREMENTAL;") || !query.exec("VACUUM;")) {
+        qDebug() << "Error: failed to convert to incremental vacuum:" << query.lastError();
+        if (result) *result = query.lastError().text();
+        return false;
+    }
+    if (!query.exec("PRAGMA auto_vacuum;") || !query.next() || query.value(0).toInt() != 2) {
+        if (result) *result = "the database did not switch modes";
+        return false;
+    }
+    if (result) *result = "converted";
+    return true;
+}
+
+QString DatabaseManager::quickCheck(const QString &table) const
+{
+    if (!m_db.isOpen()) {
+        return "database is not open";
+    }
+
+    QSqlQuery query(m_db);
+    const QString pragma = table.isEmpty() ? QString("PRAGMA quick_check;")
+                                           : QString("PRAGMA quick_check(%1);").arg(table);
+    if (!query.exec(pragma)) {
+        return query.lastError().text();
+    }
+    QStringList messages;
+    while (query.next()) {
+        messages.append(query.value(0).toString());
+    }
+    return messages.join("; ");
+}
+
+void DatabaseManager::logMaintenance(const QString &task, qint64 durationMs, int slices, const QString &result,
+                                     bool preempted)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("INSERT INTO MaintenanceLog (task, duration_ms, slices, preempted, result) "
+                  "VALUES (:task, :duration_ms, :slices, :preempted, :result)");
+    query.bindValue(":task", task);
+    query.bindValue(":duration_ms", durationMs);
+    query.bindValue(":slices", slices);
+    query.bindValue(":preempted", preempted ? 1 : 0);
+    query.bindValue(":result", result);
+    if (!query.exec()) {
+        qDebug() << "Error: failed to log maintenance:" << query.lastError();
+    }
+}
+
+QString DatabaseManager::siteId() const
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return QString();
+    }
+
+    QSqlQuery query(m_db);
+    if (!query.exec("SELECT value FROM SyncMeta WHERE key = 'site_id'") || !query.next()) {
+        qDebug() << "Error: failed to read site id:" << query.lastError();
+        return QString();
+    }
+    return query.value(0).toString();
+}
+
+bool DatabaseManager::forkSiteId()
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    // A copied file shares its site id with the original. The copy gets a new one, and
+    // everything it inherited is re-labelled as the original's, so neither side applies
+    // those changes again when the two are synced.
+    const QString oldSite = siteId();
+    if (oldSite.isEmpty() || !m_db.transaction()) {
+        return false;
+    }
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE ChangeLog SET origin = :origin, origin_seq = seq WHERE origin IS NULL");
+    query.bindValue(":origin", oldSite);
+    bool ok = query.exec();
+    if (ok) {
+        query.prepare("INSERT OR REPLACE INTO SyncProgress (origin, last_seq) "
+                      "SELECT :origin, COALESCE(MAX(origin_seq), 0) FROM ChangeLog WHERE origin = :log_origin");
+        query.bindValue(":origin", oldSite);
+        query.bindValue(":log_origin", oldSite);
+        ok = query.exec();
+    }
+    ok = ok && query.exec("UPDATE SyncMeta SET value = LOWER(HEX(RANDOMBLOB(16))) WHERE key = 'site_id'");
+    if (!ok || !m_db.commit()) {
+        qDebug() << "Error: failed to give the database a new site id:" << query.lastError();
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::pullChanges(const QString &peerPath, SyncStats *stats, int chunkSize)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+    const QString localSite = siteId();
+    if (localSite.isEmpty() || !attachDatabase(peerPath, "peer")) {
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    QString peerSite;
+    if (query.exec("SELECT value FROM peer.SyncMeta WHERE key = 'site_id'") && query.next()) {
+        peerSite = query.value(0).toString();
+    }
+    if (peerSite.isEmpty() || peerSite == localSite) {
+        qDebug() << "Error: cannot sync with" << peerPath
+                 << (peerSite.isEmpty() ? "(no change tracking)" : "(copy of this database without its own site id)");
+        detachDatabase("peer");
+        return false;
+    }
+
+    // Where we stopped reading the peer's log last time, and the highest change applied
+    // from every site (one row per store, so this stays small)
+    qint64 cursor = 0;
+    query.prepare("SELECT last_seq FROM SyncPeers WHERE peer = :peer");
+    query.bindValue(":peer", peerSite);
+    if (query.exec() && query.next()) {
+        cursor = query.value(0).toLongLong();
+    }
+    QHash<QString, qint64> progress;
+    if (query.exec("SELECT origin, last_seq FROM SyncProgress")) {
+        while (query.next()) {
+            progress.insert(query.value(0).toString(), query.value(1).toLongLong());
+        }
+    }
+
+    // Conflict rules: stock moves are merged by adding the peer's quantity deltas,
+    // catalog fields and users go to whichever side edited them last, a delete loses
+    // against a newer local edit, and sales are only ever added. Remote sales do not
+    // touch stock themselves; it arrives through the Products deltas.
+    QSqlQuery productInsert(m_db), productStock(m_db), productCatalog(m_db), productDelete(m_db);
+    QSqlQuery userInsert(m_db), userUpdate(m_db), userDelete(m_db);
+    QSqlQuery saleInsert(m_db), saleItemsInsert(m_db), forward(m_db);
+    const bool prepared =
+        productInsert.prepare("INSERT INTO main.Products (uuid, name, description, price, quantity, image_path, catalog_updated_at) "
+                              "SELECT uuid, name, description, price, :quantity, image_path, catalog_updated_at "
+                              "FROM peer.Products WHERE uuid = :key "
+                              "AND NOT EXISTS (SELECT 1 FROM main.Products WHERE uuid = :local_key)") &&
+        productStock.prepare("UPDATE main.Products SET quantity = quantity + :delta WHERE uuid = :key") &&
+        productCatalog.prepare("UPDATE main.Products SET (name, description, price, image_path, catalog_updated_at) = "
+                               "(SELECT name, description, price, image_path, catalog_updated_at FROM peer.Products WHERE uuid = :key) "
+                               "WHERE uuid = :local_key AND catalog_updated_at < "
+                               "(SELECT catalog_updated_at FROM peer.Products WHERE uuid = :peer_key)") &&
+        productDelete.prepare("DELETE FROM main.Products WHERE uuid = :key AND catalog_updated_at <= :changed_at") &&
+        userInsert.prepare("INSERT INTO main.Users (username, password_hash, role, updated_at) "
+                           "SELECT username, password_hash, role, updated_at FROM peer.Users WHERE username = :key "
+                           "AND NOT EXISTS (SELECT 1 FROM main.Users WHERE username = :local_key)") &&
+        userUpdate.prepare("UPDATE main.Users SET (password_hash, role, updated_at) = "
+                           "(SELECT password_hash, role, updated_at FROM peer.Users WHERE username = :key) "
+                           "WHERE username = :local_key AND updated_at < "
+                           "(SELECT updated_at FROM peer.Users WHERE username = :peer_key)") &&
+        userDelete.prepare("DELETE FROM main.Users WHERE username = :key AND updated_at <= :changed_at") &&
+        saleInsert.prepare("INSERT INTO main.Sales (sale_date, total_amount, user_id, client_uuid) "
+                           "SELECT S.sale_date, S.total_amount, "
+                           "(SELECT L.id FROM main.Users L JOIN peer.Users P ON P.username = L.username WHERE P.id = S.user_id), "
+                           "S.client_uuid FROM peer.Sales S WHERE S.client_uuid = :key "
+                           "AND NOT EXISTS (SELECT 1 FROM main.Sales WHERE client_uuid = :local_key)") &&
+        saleItemsInsert.prepare("INSERT INTO main.SaleItems (sale_id, product_id, quantity_sold, price_at_sale, discount) "
+                                "SELECT LS.id, LP.id, SI.quantity_sold, SI.price_at_sale, SI.discount "
+                                "FROM peer.Sales PS "
+                                "JOIN peer.SaleItems SI ON SI.sale_id = PS.id "
+                                "JOIN peer.Products PP ON PP.id = SI.product_id "
+                                "JOIN main.Products LP ON LP.uuid = PP.uuid "
+                                "JOIN main.Sales LS ON LS.client_uuid = PS.client_uuid "
+                                "WHERE PS.client_uuid = :key AND NOT EXISTS "
+                                "(SELECT 1 FROM main.SaleItems X WHERE X.sale_id = LS.id AND X.product_id = LP.id)") &&
+        forward.prepare("INSERT INTO main.ChangeLog (origin, origin_seq, table_name, row_key, op, qty_delta, changed_at) "
+                        "VALUES (:origin, :origin_seq, :table_name, :row_key, :op, :qty_delta, :changed_at)");
+    if (!prepared) {
+        qDebug() << "Error: failed to prepare sync statements:" << m_db.lastError();
+        detachDatabase("peer");
+        return false;
+    }
+
+    auto run = [](QSqlQuery &statement, std::initializer_list<std::pair<const char *, QVariant>> values) {
+        for (const auto &value : values) {
+            statement.bindValue(QString::fromLatin1(value.first), value.second);
+        }
+        if (!statement.exec()) {
+            qDebug() << "Error: failed to apply change:" << statement.lastError();
+            return -1;
+        }
+        return statement.numRowsAffected();
+    };
+
+    struct Change {
+        qint64 seq;
+        QString origin;
+        qint64 originSeq;
+        QString table;
+        QString key;
+        QString op;
+        qint64 qtyDelta;
+        QString changedAt;
+    };
+    auto apply = [&](const Change &c) {
+        if (c.table == "Products" && c.op == "D") {
+            return run(productDelete, { { ":key", c.key }, { ":changed_at", c.changedAt } }) >= 0;
+        }
+        if (c.table == "Products") {
+            int inserted = 0;
+            if (c.op == "I" && (inserted = run(productInsert, { { ":quantity", c.qtyDelta }, { ":key", c.key },
+                                                                { ":local_key", c.key } })) < 0) {
+                return false;
+            }
+            if (inserted == 0 && c.qtyDelta != 0 && run(productStock, { { ":delta", c.qtyDelta }, { ":key", c.key } }) < 0) {
+                return false;
+            }
+            return run(productCatalog, { { ":key", c.key }, { ":local_key", c.key }, { ":peer_key", c.key } }) >= 0;
+        }
+        if (c.table == "Users" && c.op == "D") {
+            return run(userDelete, { { ":key", c.key }, { ":changed_at", c.changedAt } }) >= 0;
+        }
+        if (c.table == "Users") {
+            return run(userInsert, { { ":key", c.key }, { ":local_key", c.key } }) >= 0 &&
+                   run(userUpdate, { { ":key", c.key }, { ":local_key", c.key }, { ":peer_key", c.key } }) >= 0;
+        }
+        if (c.table == "Sales") {
+            return run(saleInsert, { { ":key", c.key }, { ":local_key", c.key } }) >= 0;
+        }
+        if (c.table == "SaleItems") {
+            return run(saleItemsInsert, { { ":key", c.key } }) >= 0;
+        }
+        qDebug() << "Warning: ignoring change to unknown table" << c.table;
+        return true;
+    };
+
+    // The peer may have moved a logged sale into one of its monthly archives since. Such
+    // a sale is read from that archive, attached as peer_archive; only one is attached at
+    // a time and it can only be swapped between chunks, as DETACH is refused inside a
+    // transaction. A chunk stops before a sale that is in neither place yet.
+    QSqlQuery peerSale(m_db), archiveSale(m_db), archiveSaleInsert(m_db), archiveSaleItemsInsert(m_db);
+    peerSale.prepare("SELECT 1 FROM peer.Sales WHERE client_uuid = :key");
+    QString attachedArchive;
+    auto attachArchive = [&](const QString &file) {
+        if (!attachDatabase(QFileInfo(peerPath).absoluteDir().filePath(file), "peer_archive")) {
+            return false;
+        }
+        attachedArchive = file;
+        return archiveSale.prepare("SELECT 1 FROM peer_archive.Sales WHERE client_uuid = :key") &&
+               archiveSaleInsert.prepare(
+                   "INSERT INTO main.Sales (sale_date, total_amount, user_id, client_uuid) "
+                   "SELECT S.sale_date, S.total_amount, "
+                   "(SELECT L.id FROM main.Users L JOIN peer.Users P ON P.username = L.username WHERE P.id = S.user_id), "
+                   "S.client_uuid FROM peer_archive.Sales S WHERE S.client_uuid = :key "
+                   "AND NOT EXISTS (SELECT 1 FROM main.Sales WHERE client_uuid = :local_key)") &&
+               archiveSaleItemsInsert.prepare(
+                   "INSERT INTO main.SaleItems (sale_id, product_id, quantity_sold, price_at_sale, discount) "
+                   "SELECT LS.id, LP.id, SI.quantity_sold, SI.price_at_sale, SI.discount "
+                   "FROM peer_archive.Sales PS "
+                   "JOIN peer_archive.SaleItems SI ON SI.sale_id = PS.id "
+                   "JOIN peer.Products PP ON PP.id = SI.product_id "
+                   "JOIN main.Products LP ON LP.uuid = PP.uuid "
+                   "JOIN main.Sales LS ON LS.client_uuid = PS.client_uuid "
+                   "WHERE PS.client_uuid = :key AND NOT EXISTS "
+                   "(SELECT 1 FROM main.SaleItems X WHERE X.sale_id = LS.id AND X.product_id = LP.id)");
+    };
+    auto detachArchive = [&]() {
+        if (attachedArchive.isEmpty()) {
+            return;
+        }
+        for (QSqlQuery *statement : { &archiveSale, &archiveSaleInsert, &archiveSaleItemsInsert }) {
+            statement->finish();
+            statement->clear();
+        }
+        detachDatabase("peer_archive");
+        attachedArchive.clear();
+    };
+    auto findArchive = [&](const QString &key) {
+        detachArchive();
+        QSqlQuery partitions(m_db);
+        if (!partitions.exec("SELECT file FROM peer.SalesPartitions ORDER BY period DESC")) {
+            qDebug() << "Error: failed to list peer sales archives:" << partitions.lastError();
+            return false;
+        }
+        while (partitions.next()) {
+            if (attachArchive(partitions.value(0).toString()) && run(archiveSale, { { ":key", key } }) >= 0
+                && archiveSale.next()) {
+                archiveSale.finish();
+                return true;
+            }
+            detachArchive();
+        }
+        return false;
+    };
+    auto isIn = [&](QSqlQuery &probe, const QString &key) {
+        const bool found = run(probe, { { ":key", key } }) >= 0 && probe.next();
+        probe.finish();
+        return found;
+    };
+
+    // The peer's log is read in chunks, each applied in its own transaction together
+    // with the progress it represents, so memory stays bounded however long the log
+    // is and an interrupted sync resumes where it stopped.
+    std::vector<Change> chunk;
+    chunk.reserve(chunkSize);
+    bool ok = true;
+    QString missingSale; // Archived at the peer, in an archive that is not attached
+    while (ok) {
+        chunk.clear();
+        QSqlQuery read(m_db);
+        read.setForwardOnly(true);
+        read.prepare("SELECT seq, COALESCE(origin, :peer_site), COALESCE(origin_seq, seq), table_name, row_key, op, "
+                     "qty_delta, changed_at FROM peer.ChangeLog WHERE seq > :cursor ORDER BY seq LIMIT :limit");
+        read.bindValue(":peer_site", peerSite);
+        read.bindValue(":cursor", cursor);
+        read.bindValue(":limit", chunkSize);
+        if (!read.exec()) {
+            qDebug() << "Error: failed to read peer change log:" << read.lastError();
+            ok = false;
+            break;
+        }
+        while (read.next()) {
+            chunk.push_back({ read.value(0).toLongLong(), read.value(1).toString(), read.value(2).toLongLong(),
+                              read.value(3).toString(), read.value(4).toString(), read.value(5).toString(),
+                              read.value(6).toLongLong(), read.value(7).toString() });
+        }
+        read.finish();
+        if (chunk.empty()) {
+            break;
+        }
+
+        if (!m_db.transaction()) {
+            qDebug() << "Failed to start sync transaction:" << m_db.lastError();
+            ok = false;
+            break;
+        }
+        // Keeps the change-log triggers from logging these rows as local changes
+        ok = query.exec("INSERT OR REPLACE INTO main.SyncMeta (key, value) VALUES ('applying', '1')");
+        QHash<QString, qint64> chunkProgress = progress;
+        qint64 chunkCursor = cursor;
+        for (const Change &c : chunk) {
+            if (c.origin != localSite && c.originSeq > chunkProgress.value(c.origin, 0)
+                && (c.table == "Sales" || c.table == "SaleItems") && !isIn(peerSale, c.key)) {
+                if (attachedArchive.isEmpty() || !isIn(archiveSale, c.key)) {
+                    missingSale = c.key; // Not past it: find its archive, then resume here
+                    break;
+                }
+                ok = (c.table == "Sales"
+                          ? run(archiveSaleInsert, { { ":key", c.key }, { ":local_key", c.key } })
+                          : run(archiveSaleItemsInsert, { { ":key", c.key } })) >= 0;
+            } else if (c.origin == localSite || c.originSeq <= chunkProgress.value(c.origin, 0)) {
+                if (stats) {
+                    ++stats->read;
+                    ++stats->skipped;
+                }
+                chunkCursor = c.seq;
+                continue;
+            } else {
+                ok = apply(c);
+            }
+            if (stats) {
+                ++stats->read;
+            }
+            ok = ok &&
+                 run(forward, { { ":origin", c.origin }, { ":origin_seq", c.originSeq }, { ":table_name", c.table },
+                                { ":row_key", c.key }, { ":op", c.op }, { ":qty_delta", c.qtyDelta },
+                                { ":changed_at", c.changedAt } }) >= 0;
+            if (!ok) {
+                break;
+            }
+            chunkProgress.insert(c.origin, c.originSeq);
+            chunkCursor = c.seq;
+            if (stats) {
+                ++stats->applied;
+            }
+        }
+
+        for (auto it = chunkProgress.cbegin(); ok && it != chunkProgress.cend(); ++it) {
+            if (progress.value(it.key(), -1) == it.value()) {
+                continue;
+            }
+            query.prepare("INSERT OR REPLACE INTO main.SyncProgress (origin, last_seq) VALUES (:origin, :last_seq)");
+            query.bindValue(":origin", it.key());
+            query.bindValue(":last_seq", it.value());
+            ok = query.exec();
+        }
+        if (ok) {
+            query.prepare("INSERT OR REPLACE INTO main.SyncPeers (peer, last_seq) VALUES (:peer, :last_seq)");
+            query.bindValue(":peer", peerSite);
+            query.bindValue(":last_seq", chunkCursor);
+            ok = query.exec() && query.exec("DELETE FROM main.SyncMeta WHERE key = 'applying'");
+        }
+        if (!ok || !m_db.commit()) {
+            qDebug() << "Error: failed to apply changes from" << peerPath << ":" << query.lastError() << m_db.lastError();
+            m_db.rollback();
+            ok = false;
+            break;
+        }
+        progress = chunkProgress;
+        cursor = chunkCursor;
+
+        if (!missingSale.isEmpty()) {
+            if (!findArchive(missingSale)) {
+                // Leave the cursor before it, so a later sync picks it up
+                qDebug() << "Error: sale" << missingSale << "is in neither the peer's sales nor its archives";
+                ok = false;
+            }
+            missingSale.clear();
+        }
+    }
+
+    // The prepared statements refer to the peer schema and must go before DETACH
+    detachArchive();
+    for (QSqlQuery *statement : { &productInsert, &productStock, &productCatalog, &productDelete, &userInsert,
+                                  &userUpdate, &userDelete, &saleInsert, &saleItemsInsert, &forward, &peerSale }) {
+        statement->finish();
+        statement->clear();
+    }
+    detachDatabase("peer");
+    return ok;
+}
+
+bool DatabaseManager::addProduct(const ProductData &productData)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("INSERT INTO Products (name, description, price, quantity, image_path) "
+                  "VALUES (:name, :description, :price, :quantity, :image_path)");
+    query.bindValue(":name", productData.name);
+    query.bindValue(":description", productData.description);
+    query.bindValue(":price", productData.price);
+    query.bindValue(":quantity", productData.quantity);
+    query.bindValue(":image_path", productData.imagePath);
+
+    if (!query.exec()) {
+        qDebug() << "Error: failed to add product:" << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabaseManager::deleteProduct(int id)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("DELETE FROM Products WHERE id = :id");
+    query.bindValue(":id", id);
+
+    if (!query.exec()) {
+        qDebug() << "Error: failed to delete product:" << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabaseManager::updateProduct(int id, const ProductData &productData)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE Products SET name = :name, description = :description, "
+                  "price = :price, quantity = :quantity, image_path = :image_path WHERE id = :id");
+    query.bindValue(":name", productData.name);
+    query.bindValue(":description", productData.description);
+    query.bindValue(":price", productData.price);
+    query.bindValue(":quantity", productData.quantity);
+    query.bindValue(":image_path", productData.imagePath);
+    query.bindValue(":id", id);
+
+    if (!query.exec()) {
+        qDebug() << "Error: failed to update product:" << query.lastError();
+        return false;
+    }
+
+    return true;
+}
+
+bool DatabaseManager::setProductImages(const QHash<int, QString> &imagePaths)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start transaction:" << m_db.lastError();
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE Products SET image_path = :image_path WHERE id = :id");
+    for (auto it = imagePaths.constBegin(); it != imagePaths.constEnd(); ++it) {
+        query.bindValue(":image_path", it.value());
+        query.bindValue(":id", it.key());
+        if (!query.exec()) {
+            qDebug() << "Error: failed to update product image:" << query.lastError();
+            m_db.rollback();
+            return false;
+        }
+    }
+    return m_db.commit();
+}
+
+qint64 DatabaseManager::basketMiningPosition() const
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return -1;
+    }
+
+    QSqlQuery query(m_db);
+    if (!query.exec("SELECT COALESCE(MAX(last_sale_id), 0) FROM BasketMiningState") || !query.next()) {
+        qDebug() << "Error: failed to read basket mining position:" << query.lastError();
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+bool DatabaseManager::storeProductPairs(const QHash<quint64, int> &pairs, qint64 fromSaleId, qint64 lastSaleId,
+                                        int neighbours, bool *superseded)
+{
+    if (superseded) *superseded = false;
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    QSqlQuery query(m_db);
+    if (!query.exec("CREATE TEMP TABLE IF NOT EXISTS MinedProducts (product_id INTEGER PRIMARY KEY)")) {
+        qDebug() << "Error: failed to create mined products table:" << query.lastError();
+        return false;
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start transaction:" << m_db.lastError();
+        return false;
+    }
+
+    // Every lane mines the same store.db, and --mine-baskets can run alongside them.
+    // The write lock is taken first, so no other miner can store a round between
+    // checking the position and moving it.
+    if (!query.exec("INSERT OR IGNORE INTO BasketMiningState (id, last_sale_id) VALUES (1, 0)") ||
+        !query.exec("SELECT last_sale_id FROM BasketMiningState WHERE id = 1") || !query.next()) {
+        qDebug() << "Error: failed to read basket mining position:" << query.lastError();
+        m_db.rollback();
+        return false;
+    }
+    if (query.value(0).toLongLong() != fromSaleId) {
+        query.finish();
+        m_db.rollback(); // These sales were counted by another miner
+        if (superseded) *superseded = true;
+        return true;
+    }
+    query.finish();
+
+    // Each pair is added both ways round
+    QVariantList productIds;
+    QVariantList otherIds;
+    QVariantList counts;
+    QSet<int> touched;
+    productIds.reserve(pairs.size() * 2);
+    otherIds.reserve(pairs.size() * 2);
+    counts.reserve(pairs.size() * 2);
+    for (auto it = pairs.constBegin(); it != pairs.constEnd(); ++it) {
+        const int first = int(it.key() >> 32);
+        const int second = int(it.key() & 0xffffffffu);
+        productIds << first << second;
+        otherIds << second << first;
+        counts << it.value() << it.value();
+        touched.insert(first);
+        touched.insert(second);
+    }
+    QVariantList touchedIds;
+    touchedIds.reserve(touched.size());
+    for (int productId : std::as_const(touched)) {
+        touchedIds.append(productId);
+    }
+
+    bool ok = true;
+    if (!pairs.isEmpty()) {
+        query.prepare("INSERT INTO ProductPairs (product_id, other_id, count) VALUES (?, ?, ?) "
+                      "ON CONFLICT (product_id, other_id) DO UPDATE SET count = count + excluded.count");
+        query.addBindValue(productIds);
+        query.addBindValue(otherIds);
+        query.addBindValue(counts);
+        ok = query.execBatch();
+
+        // Only products with new pairs can have different neighbours
+        ok = ok && query.exec("DELETE FROM temp.MinedProducts");
+        if (ok) {
+            query.prepare("INSERT INTO temp.MinedProducts (product_id) VALUES (?)");
+            query.addBindValue(touchedIds);
+            ok = query.execBatch();
+        }
+        ok = ok && query.exec("DELETE FROM ProductNeighbours WHERE product_id IN (SELECT product_id FROM temp.MinedProducts)");
+        if (ok) {
+            query.prepare("INSERT INTO ProductNeighbours (product_id, rank, neighbour_id, count) "
+                          "SELECT product_id, rank, other_id, count FROM ("
+                          "SELECT product_id, other_id, count, "
+                          "ROW_NUMBER() OVER (PARTITION BY product_id ORDER BY count DESC, other_id) AS rank "
+                          "FROM ProductPairs WHERE product_id IN (SELECT product_id FROM temp.MinedProducts)"
+                          ") WHERE rank <= :neighbours");
+            query.bindValue(":neighbours", neighbours);
+            ok = query.exec();
+        }
+        ok = ok && query.exec("DELETE FROM temp.MinedProducts");
+    }
+    if (ok) {
+        query.prepare("INSERT OR REPLACE INTO BasketMiningState (id, last_sale_id, updated_at) "
+                      "VALUES (1, :last_sale_id, CURRENT_TIMESTAMP)");
+        query.bindValue(":last_sale_id", lastSaleId);
+        ok = query.exec();
+    }
+    if (!ok) {
+        qDebug() << "Error: failed to store product pairs:" << query.lastError();
+        m_db.rollback();
+        return false;
+    }
+    return m_db.commit();
+}
+
+QHash<int, QList<ProductNeighbour>> DatabaseManager::getProductNeighbours() const
+{
+    QHash<int, QList<ProductNeighbour>> neighbours;
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return neighbours;
+    }
+
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT product_id, neighbour_id, count FROM ProductNeighbours ORDER BY product_id, rank")) {
+        qDebug() << "Error: failed to read product neighbours:" << query.lastError();
+        return neighbours;
+    }
+    while (query.next()) {
+        neighbours[query.value(0).toInt()].append({ query.value(1).toInt(), query.value(2).toInt() });
+    }
+    return neighbours;
+}
+
+QList<Promotion> DatabaseManager::getPromotions() const
+{
+    QList<Promotion> promotions;
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return promotions;
+    }
+
+    // Expired promotions are left out; the engine decides what is active right now
+    QSqlQuery query(m_db);
+    if (!query.exec("SELECT id, name, kind, priority, percent, buy_quantity, free_quantity, bundle_price, "
+                    "starts_at, ends_at, daily_from, daily_to, weekdays FROM Promotions "
+                    "WHERE enabled AND (ends_at IS NULL OR ends_at > DATETIME('now', 'localtime')) ORDER BY id")) {
+        qDebug() << "Error: failed to read promotions:" << query.lastError();
+        return promotions;
+    }
+    QHash<int, int> indexById;
+    while (query.next()) {
+        Promotion promotion;
+        promotion.id = query.value(0).toInt();
+        promotion.name = query.value(1).toString();
+        const QString kind = query.value(2).toString();
+        promotion.kind = kind == "bundle" ? Promotion::Bundle
+                       : kind == "buy_x_get_y" ? Promotion::BuyXGetY : Promotion::Percent;
+        promotion.priority = query.value(3).toInt();
+        promotion.percent = qBound(0.0, query.value(4).toDouble(), 100.0); // Tables from before the CHECK
+        promotion.buyQuantity = query.value(5).toInt();
+        promotion.freeQuantity = query.value(6).toInt();
+        promotion.bundlePrice = query.value(7).toDouble();
+        promotion.startsAt = QDateTime::fromString(query.value(8).toString(), "yyyy-MM-dd HH:mm:ss");
+        promotion.endsAt = QDateTime::fromString(query.value(9).toString(), "yyyy-MM-dd HH:mm:ss");
+        promotion.dailyFrom = QTime::fromString(query.value(10).toString(), "HH:mm");
+        promotion.dailyTo = QTime::fromString(query.value(11).toString(), "HH:mm");
+        promotion.weekdays = query.value(12).toInt();
+        indexById.insert(promotion.id, promotions.size());
+        promotions.append(promotion);
+    }
 
-DatabaseManager::DatabaseManager()
+    if (!query.exec("SELECT promotion_id, product_id, quantity FROM PromotionProducts")) {
+        qDebug() << "Error: failed to read promotion products:" << query.lastError();
+        return {};
+    }
+    while (query.next()) {
+        auto it = indexById.constFind(query.value(0).toInt());
+        if (it != indexById.constEnd()) {
+            promotions[it.value()].products.insert(query.value(1).toInt(), query.value(2).toInt());
+        }
+    }
+    return promotions;
+}
+
+bool DatabaseManager::setProductPrices(const QList<PriceChange> &changes, int *changed)
 {
-    m_db = QSqlDatabase::addDatabase("QSQLITE");
-    m_db.setDatabaseName("store.db");
+    if (changed) *changed = 0;
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+    if (changes.isEmpty()) {
+        return true;
+    }
+
+    // Same shape as a stock batch: one batched insert, one UPDATE for every product
+    QSqlQuery query(m_db);
+    if (!query.exec("CREATE TEMP TABLE IF NOT EXISTS PriceBatch ("
+                    "product_id INTEGER PRIMARY KEY, old_price REAL NOT NULL, new_price REAL NOT NULL)")) {
+        qDebug() << "Error: failed to create price batch table:" << query.lastError();
+        return false;
+    }
+
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start transaction:" << m_db.lastError();
+        return false;
+    }
 
-    if (!m_db.open()) {
-        qDebug() << "Error: connection with database failed:" << m_db.lastError();
-    } else {
-        qDebug() << "Database: connection ok";
+    QVariantList productIds;
+    QVariantList oldPrices;
+    QVariantList newPrices;
+    productIds.reserve(changes.size());
+    oldPrices.reserve(changes.size());
+    newPrices.reserve(changes.size());
+    for (const PriceChange &change : changes) {
+        productIds.append(change.productId);
+        oldPrices.append(change.oldPrice);
+        newPrices.append(change.newPrice);
     }
-}
 
-DatabaseManager::~DatabaseManager()
-{
-    if (m_db.isOpen()) {
-        m_db.close();
+    bool ok = query.exec("DELETE FROM temp.PriceBatch");
+    if (ok) {
+        query.prepare("INSERT INTO temp.PriceBatch (product_id, old_price, new_price) VALUES (?, ?, ?)");
+        query.addBindValue(productIds);
+        query.addBindValue(oldPrices);
+        query.addBindValue(newPrices);
+        ok = query.execBatch();
+    }
+    // A product repriced elsewhere since the preview keeps that price
+    ok = ok && query.exec("UPDATE Products SET price = "
+                          "(SELECT B.new_price FROM temp.PriceBatch B WHERE B.product_id = Products.id) "
+                          "WHERE id IN (SELECT B.product_id FROM temp.PriceBatch B WHERE B.old_price = Products.price)");
+    if (ok && changed) *changed = query.numRowsAffected();
+    ok = ok && query.exec("DELETE FROM temp.PriceBatch");
+    if (!ok) {
+        qDebug() << "Error: failed to update prices:" << query.lastError();
+        m_db.rollback();
+        if (changed) *changed = 0;
+        return false;
     }
+    return m_db.commit();
 }
 
-void DatabaseManager::init()
+bool DatabaseManager::applyStockBatch(const QHash<int, int> &quantities, StockBatchMode mode,
+                                      const QString &reason, int *changed)
 {
+    if (changed) *changed = 0;
     if (!m_db.isOpen()) {
         qDebug() << "Error: database is not open";
-        return;
+        return false;
+    }
+    if (quantities.isEmpty()) {
+        return true;
     }
 
-    QSqlQuery query;
+    // The batch goes into a temporary table with one batched insert, then every
+    // product is updated by a single statement; the stock triggers log each change
+    QSqlQuery query(m_db);
+    if (!query.exec("CREATE TEMP TABLE IF NOT EXISTS StockBatch ("
+                    "product_id INTEGER PRIMARY KEY, quantity INTEGER NOT NULL)")) {
+        qDebug() << "Error: failed to create stock batch table:" << query.lastError();
+        return false;
+    }
 
-    // Create Products table
-    if (!query.exec("CREATE TABLE IF NOT EXISTS Products ("
-                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                    "name TEXT NOT NULL, "
-                    "description TEXT, "
-                    "price REAL NOT NULL, "
-                    "quantity INTEGER NOT NULL, "
-                    "image_path TEXT"
-                    ");")) {
-        qDebug() << "Error: failed to create Products table:" << query.lastError();
-    } else {
-        // Add image_path column if it doesn't exist
-        if (!query.exec("PRAGMA table_info(Products);")) {
-            qDebug() << "Error: failed to get table info for Products:" << query.lastError();
-        } else {
-            bool columnExists = false;
-            while (query.next()) {
-                if (query.value("name").toString() == "image_path") {
-                    columnExists = true;
-                    break;
-                }
-            }
-            if (!columnExists) {
-                if (!query.exec("ALTER TABLE Products ADD COLUMN image_path TEXT;")) {
-                    qDebug() << "Error: failed to add image_path column to Products table:" << query.lastError();
-                } else {
-                    qDebug() << "Added image_path column to Products table.";
-                }
-            }
-        }
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start transaction:" << m_db.lastError();
+        return false;
     }
 
-    // Create Sales table
-    if (!query.exec("CREATE TABLE IF NOT EXISTS Sales ("
-                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                    "sale_date TIMESTAMP DEFAULT CURRENT_TIMESTAMP, "
-                    "total_amount REAL NOT NULL, "
-                    "user_id INTEGER REFERENCES Users(id)"
-                    ");")) {
-        qDebug() << "Error: failed to create Sales table:" << query.lastError();
+    QVariantList productIds;
+    QVariantList batchQuantities;
+    productIds.reserve(quantities.size());
+    batchQuantities.reserve(quantities.size());
+    for (auto it = quantities.constBegin(); it != quantities.constEnd(); ++it) {
+        productIds.append(it.key());
+        batchQuantities.append(it.value());
     }
 
-    // Create SaleItems table
-    if (!query.exec("CREATE TABLE IF NOT EXISTS SaleItems ("
-                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                    "sale_id INTEGER, "
-                    "product_id INTEGER, "
-                    "quantity_sold INTEGER NOT NULL, "
-                    "price_at_sale REAL NOT NULL, "
-                    "FOREIGN KEY (sale_id) REFERENCES Sales(id), "
-                    "FOREIGN KEY (product_id) REFERENCES Products(id)"
-                    ");")) {
-        qDebug() << "Error: failed to create SaleItems table:" << query.lastError();
+    bool ok = query.exec("DELETE FROM temp.StockBatch");
+    if (ok) {
+        query.prepare("INSERT INTO temp.StockBatch (product_id, quantity) VALUES (?, ?)");
+        query.addBindValue(productIds);
+        query.addBindValue(batchQuantities);
+        ok = query.execBatch();
+    }
+    if (ok) {
+        // Counted quantities replace what is on hand; received ones are added to it.
+        // Lines that would leave a product below zero are refused as a whole.
+        const QString value = mode == StockTake
+            ? "(SELECT B.quantity FROM temp.StockBatch B WHERE B.product_id = Products.id)"
+            : "quantity + (SELECT B.quantity FROM temp.StockBatch B WHERE B.product_id = Products.id)";
+        ok = query.exec("SELECT COUNT(*) FROM temp.StockBatch B LEFT JOIN Products P ON P.id = B.product_id "
+                        "WHERE P.id IS NULL OR " + QString(mode == StockTake ? "B.quantity" : "P.quantity + B.quantity") + " < 0")
+             && query.next();
+        if (ok && query.value(0).toInt() > 0) {
+            qDebug() << "Stock batch refused:" << query.value(0).toInt() << "line(s) for missing products or below zero";
+            ok = false;
+        }
+        query.finish();
+        ok = ok && setStockContext(mode == StockTake ? "stocktake" : "receipt", reason)
+             && query.exec("UPDATE Products SET quantity = " + value + " "
+                           "WHERE id IN (SELECT product_id FROM temp.StockBatch) AND quantity IS NOT " + value);
+        if (ok && changed) *changed = query.numRowsAffected();
+        ok = ok && clearStockContext() && query.exec("DELETE FROM temp.StockBatch");
     }
+    if (!ok) {
+        qDebug() << "Error: failed to apply stock batch:" << query.lastError();
+        m_db.rollback();
+        if (changed) *changed = 0;
+        return false;
+    }
+    return m_db.commit();
+}
 
-    // Create Users table
-    if (!query.exec("CREATE TABLE IF NOT EXISTS Users ("
-                    "id INTEGER PRIMARY KEY AUTOINCREMENT, "
-                    "username TEXT NOT NULL UNIQUE, "
-                    "password_hash TEXT NOT NULL, "
-                    "role TEXT NOT NULL DEFAULT 'Admin'"
-                    ");")) {
-        qDebug() << "Error: failed to create Users table:" << query.lastError();
+bool DatabaseManager::setStockContext(const QString &kind, const QString &reason, const QString &reference)
+{
+    QSqlQuery query(m_db);
+    query.prepare("INSERT OR REPLACE INTO StockMovementContext (id, kind, reason, reference) "
+                  "VALUES (1, :kind, :reason, :reference)");
+    query.bindValue(":kind", kind);
+    query.bindValue(":reason", reason.isEmpty() ? QVariant() : QVariant(reason));
+    query.bindValue(":reference", reference.isEmpty() ? QVariant() : QVariant(reference));
+    if (!query.exec()) {
+        qDebug() << "Error: failed to set stock movement context:" << query.lastError();
+        return false;
     }
+    return true;
 }
 
-bool DatabaseManager::addProduct(const ProductData &productData)
+bool DatabaseManager::clearStockContext()
+{
+    QSqlQuery query(m_db);
+    if (!query.exec("DELETE FROM StockMovementContext")) {
+        qDebug() << "Error: failed to clear stock movement context:" << query.lastError();
+        return false;
+    }
+    return true;
+}
+
+bool DatabaseManager::adjustStock(int productId, int delta, const QString &kind, const QString &reason)
 {
     if (!m_db.isOpen()) {
         qDebug() << "Error: database is not open";
         return false;
     }
 
-    QSqlQuery query;
-    query.prepare("INSERT INTO Products (name, description, price, quantity, image_path) "
-                  "VALUES (:name, :description, :price, :quantity, :image_path)");
-    query.bindValue(":name", productData.name);
-    query.bindValue(":description", productData.description);
-    query.bindValue(":price", productData.price);
-    query.bindValue(":quantity", productData.quantity);
-    query.bindValue(":image_path", productData.imagePath);
-
-    if (!query.exec()) {
-        qDebug() << "Error: failed to add product:" << query.lastError();
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start transaction:" << m_db.lastError();
         return false;
     }
 
-    return true;
+    QSqlQuery query(m_db);
+    query.prepare("UPDATE Products SET quantity = quantity + :delta WHERE id = :id AND quantity + :min_delta >= 0");
+    query.bindValue(":delta", delta);
+    query.bindValue(":id", productId);
+    query.bindValue(":min_delta", delta);
+    bool ok = setStockContext(kind, reason) && query.exec() && clearStockContext();
+    if (ok && query.numRowsAffected() != 1) {
+        qDebug() << "Stock adjustment of" << delta << "for product" << productId << "refused";
+        ok = false;
+    }
+    if (!ok) {
+        m_db.rollback();
+        return false;
+    }
+    return m_db.commit();
 }
 
-bool DatabaseManager::deleteProduct(int id)
+bool DatabaseManager::takeStockSnapshot(int minMovements, QString *result)
 {
     if (!m_db.isOpen()) {
         qDebug() << "Error: database is not open";
         return false;
     }
 
-    QSqlQuery query;
-    query.prepare("DELETE FROM Products WHERE id = :id");
-    query.bindValue(":id", id);
-
-    if (!query.exec()) {
-        qDebug() << "Error: failed to delete product:" << query.lastError();
+    // Skip while the ledger has barely moved, but not for more than a day
+    QSqlQuery query(m_db);
+    if (!query.exec("SELECT (SELECT COALESCE(MAX(id), 0) FROM StockMovements) - COALESCE(MAX(last_movement_id), 0), "
+                    "COALESCE(MAX(taken_at) < DATETIME('now', '-1 day'), 1) FROM StockSnapshots") || !query.next()) {
+        qDebug() << "Error: failed to read stock snapshots:" << query.lastError();
+        if (result) *result = query.lastError().text();
         return false;
     }
+    const qint64 pending = query.value(0).toLongLong();
+    const bool stale = query.value(1).toBool();
+    query.finish();
+    if (minMovements > 0 && (pending == 0 || (pending < minMovements && !stale))) {
+        if (result) *result = QString("skipped: %1 movement(s) since the last snapshot").arg(pending);
+        return true;
+    }
 
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start transaction:" << m_db.lastError();
+        return false;
+    }
+    bool ok = query.exec("INSERT INTO StockSnapshots (last_movement_id) SELECT COALESCE(MAX(id), 0) FROM StockMovements");
+    const qint64 snapshotId = query.lastInsertId().toLongLong();
+    if (ok) {
+        query.prepare("INSERT INTO StockSnapshotItems (snapshot_id, product_id, quantity) "
+                      "SELECT :snapshot_id, id, quantity FROM Products WHERE quantity <> 0");
+        query.bindValue(":snapshot_id", snapshotId);
+        ok = query.exec();
+    }
+    if (!ok || !m_db.commit()) {
+        qDebug() << "Error: failed to take stock snapshot:" << query.lastError() << m_db.lastError();
+        if (result) *result = query.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    if (result) *result = QString("snapshot %1 after %2 movement(s)").arg(snapshotId).arg(pending);
     return true;
 }
 
-bool DatabaseManager::updateProduct(int id, const ProductData &productData)
+QHash<int, int> DatabaseManager::getStockAt(const QDateTime &when, int productId, bool *ok) const
 {
+    QHash<int, int> stock;
+    if (ok) *ok = false;
     if (!m_db.isOpen()) {
         qDebug() << "Error: database is not open";
-        return false;
+        return stock;
     }
 
-    QSqlQuery query;
-    query.prepare("UPDATE Products SET name = :name, description = :description, "
-                  "price = :price, quantity = :quantity, image_path = :image_path WHERE id = :id");
-    query.bindValue(":name", productData.name);
-    query.bindValue(":description", productData.description);
-    query.bindValue(":price", productData.price);
-    query.bindValue(":quantity", productData.quantity);
-    query.bindValue(":image_path", productData.imagePath);
-    query.bindValue(":id", id);
-
+    // Latest snapshot at or before the moment, and the next one's position in the
+    // ledger, which bounds the movements to add however long the history is
+    const QString at = when.toUTC().toString("yyyy-MM-dd HH:mm:ss");
+    QSqlQuery query(m_db);
+    query.prepare("SELECT S.id, S.last_movement_id, "
+                  "(SELECT MIN(N.last_movement_id) FROM StockSnapshots N WHERE N.id > S.id) "
+                  "FROM StockSnapshots S WHERE S.taken_at <= :at ORDER BY S.taken_at DESC, S.id DESC LIMIT 1");
+    query.bindValue(":at", at);
     if (!query.exec()) {
-        qDebug() << "Error: failed to update product:" << query.lastError();
-        return false;
+        qDebug() << "Error: failed to find stock snapshot:" << query.lastError();
+        return stock;
     }
-
-    return true;
+    if (!query.next()) {
+        return stock; // Before the ledger started
+    }
+    const qint64 snapshotId = query.value(0).toLongLong();
+    const qint64 fromMovement = query.value(1).toLongLong();
+    const qint64 toMovement = query.isNull(2) ? std::numeric_limits<qint64>::max() : query.value(2).toLongLong();
+    query.finish();
+
+    const QString productFilter = productId > 0 ? "AND product_id = :product_id" : "";
+    query.prepare(QString("SELECT product_id, SUM(quantity) FROM ("
+                          "SELECT product_id, quantity FROM StockSnapshotItems WHERE snapshot_id = :snapshot_id %1 "
+                          "UNION ALL "
+                          "SELECT product_id, delta FROM StockMovements "
+                          "WHERE id > :from_movement AND id <= :to_movement AND created_at <= :at %1"
+                          ") GROUP BY product_id").arg(productFilter));
+    query.bindValue(":snapshot_id", snapshotId);
+    query.bindValue(":from_movement", fromMovement);
+    query.bindValue(":to_movement", toMovement);
+    query.bindValue(":at", at);
+    if (productId > 0) {
+        query.bindValue(":product_id", productId);
+    }
+    if (!query.exec()) {
+        qDebug() << "Error: failed to compute stock at" << at << ":" << query.lastError();
+        return stock;
+    }
+    while (query.next()) {
+        stock.insert(query.value(0).toInt(), query.value(1).toInt());
+    }
+    if (ok) *ok = true;
+    return stock;
 }
 
 QList<Product> DatabaseManager::getAllProducts() const
@@ -177,7 +2148,7 @@ QList<Product> DatabaseManager::getAllProducts() const
         qDebug() << "Error: database is not open";
         return products;
     }
-    QSqlQuery query("SELECT id, name, price, quantity, image_path FROM Products");
+    QSqlQuery query("SELECT id, name, price, quantity, image_path FROM Products", m_db);
     while (query.next()) {
         products.append({
             query.value("id").toInt(),
@@ -198,7 +2169,7 @@ Product DatabaseManager::getProductById(int id) const
         return product;
     }
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("SELECT id, name, price, quantity, image_path FROM Products WHERE id = :id");
     query.bindValue(":id", id);
     if (query.exec() && query.next()) {
@@ -213,63 +2184,197 @@ Product DatabaseManager::getProductById(int id) const
     return product;
 }
 
-bool DatabaseManager::processSale(const QMap<int, CartItem>& cart, double totalAmount, int userId) {
+bool DatabaseManager::getProductChanges(qint64 sinceSeq, ProductChanges *changes)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    // One read transaction, so the rows match the ChangeLog position reported with them
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start product changes transaction:" << m_db.lastError();
+        return false;
+    }
+    QSqlQuery query(m_db);
+    bool ok = query.exec("SELECT COALESCE(MAX(seq), 0) FROM ChangeLog") && query.next();
+    if (ok) {
+        changes->lastSeq = query.value(0).toLongLong();
+        if (sinceSeq < 0) {
+            ok = query.exec("SELECT uuid, id, name, price, quantity, image_path FROM Products");
+        } else {
+            // Only the products touched in the log range, however many times each
+            query.prepare("SELECT C.row_key, P.id, P.name, P.price, P.quantity, P.image_path FROM "
+                          "(SELECT DISTINCT row_key FROM ChangeLog "
+                          "WHERE seq > :since AND seq <= :last AND table_name = 'Products') C "
+                          "LEFT JOIN Products P ON P.uuid = C.row_key");
+            query.bindValue(":since", sinceSeq);
+            query.bindValue(":last", changes->lastSeq);
+            ok = query.exec();
+        }
+    }
+    while (ok && query.next()) {
+        const QString uuid = query.value(0).toString();
+        if (query.value(1).isNull()) {
+            changes->removed.append(uuid);
+            continue;
+        }
+        changes->updated.append({ uuid, { query.value(1).toInt(), query.value(2).toString(), query.value(3).toDouble(),
+                                          query.value(4).toInt(), query.value(5).toString() } });
+    }
+    if (!ok) {
+        qDebug() << "Error: failed to read product changes:" << query.lastError();
+    }
+    query.finish();
+    m_db.commit();
+    return ok;
+}
+
+bool DatabaseManager::processSale(const QMap<int, CartItem>& cart, double totalAmount, int userId, const QString &saleUuid) {
+    // A retried submission of a sale that already committed is a success, not a duplicate.
+    if (!saleUuid.isEmpty() && isSaleCommitted(saleUuid)) {
+        qDebug() << "Sale" << saleUuid << "already committed, skipping";
+        return true;
+    }
+
     // Transactions ensure that all operations succeed or none do.
     if (!m_db.transaction()) {
         qDebug() << "Failed to start transaction:" << m_db.lastError();
         return false;
     }
 
-    // 1. Insert into Sales table
-    QSqlQuery saleQuery;
-    saleQuery.prepare("INSERT INTO Sales (total_amount, user_id) VALUES (:total, :user_id)");
+    if (!insertSaleRecords(cart, totalAmount, userId, saleUuid)) {
+        m_db.rollback();
+        return false;
+    }
+
+    // If all operations were successful, commit the transaction
+    return m_db.commit();
+}
+
+QList<bool> DatabaseManager::commitSaleBatch(const QList<PendingSale> &sales)
+{
+    // One transaction (and one fsync) for the whole batch. Each sale gets its own
+    // savepoint so a failing sale is rolled back on its own and the rest still commit.
+    QList<bool> results(sales.size(), false);
+    if (!m_db.transaction()) {
+        qDebug() << "Failed to start batch transaction:" << m_db.lastError();
+        return results;
+    }
+
+    QSqlQuery savepoint(m_db);
+    for (int i = 0; i < sales.size(); ++i) {
+        const PendingSale &sale = sales.at(i);
+        if (isSaleCommitted(sale.uuid)) {
+            results[i] = true; // Resubmitted after it was already committed
+            continue;
+        }
+
+        if (!savepoint.exec("SAVEPOINT batch_sale")) {
+            qDebug() << "Error: failed to open savepoint for sale" << sale.uuid << ":" << savepoint.lastError();
+            continue; // Nothing was written for this sale; it is reported as failed
+        }
+        if (insertSaleRecords(sale.cart, sale.totalAmount, sale.userId, sale.uuid, sale.soldAt)) {
+            results[i] = true;
+        } else if (!savepoint.exec("ROLLBACK TO batch_sale")) {
+            // The failed sale's partial writes would otherwise be committed with the rest
+            qDebug() << "Error: failed to roll back sale" << sale.uuid << ":" << savepoint.lastError();
+            m_db.rollback();
+            results.fill(false);
+            return results;
+        }
+        if (!savepoint.exec("RELEASE batch_sale")) {
+            qDebug() << "Error: failed to release savepoint for sale" << sale.uuid << ":" << savepoint.lastError();
+            m_db.rollback();
+            results.fill(false);
+            return results;
+        }
+    }
+
+    if (!m_db.commit()) {
+        qDebug() << "Batch commit failed:" << m_db.lastError();
+        m_db.rollback();
+        results.fill(false);
+    }
+    return results;
+}
+
+bool DatabaseManager::insertSaleRecords(const QMap<int, CartItem>& cart, double totalAmount, int userId, const QString &saleUuid,
+                                        const QDateTime &soldAt)
+{
+    // Must be called inside a transaction; the caller commits or rolls back.
+
+    // 1. Insert into Sales table. A sale that reaches the database late (journal
+    // replay, retry) keeps the time it was made at the till.
+    QSqlQuery saleQuery(m_db);
+    saleQuery.prepare("INSERT INTO Sales (sale_date, total_amount, user_id, client_uuid) "
+                      "VALUES (COALESCE(:sale_date, CURRENT_TIMESTAMP), :total, :user_id, :uuid)");
+    saleQuery.bindValue(":sale_date", soldAt.isValid() ? QVariant(soldAt.toUTC().toString("yyyy-MM-dd HH:mm:ss")) : QVariant());
     saleQuery.bindValue(":total", totalAmount);
     saleQuery.bindValue(":user_id", userId);
+    saleQuery.bindValue(":uuid", saleUuid.isEmpty() ? QVariant() : QVariant(saleUuid));
     if (!saleQuery.exec()) {
         qDebug() << "Sale insert failed:" << saleQuery.lastError();
-        m_db.rollback();
         return false;
     }
     int saleId = saleQuery.lastInsertId().toInt();
+    // Stock movements written by the quantity trigger are attributed to this sale
+    if (!setStockContext("sale", QString(), QString::number(saleId))) {
+        return false;
+    }
 
     // 2. Insert each cart item into SaleItems and update Products stock
+    QSqlQuery itemQuery(m_db);
+    itemQuery.prepare("INSERT INTO SaleItems (sale_id, product_id, quantity_sold, price_at_sale, discount) "
+                      "VALUES (:sale_id, :product_id, :qty, :price, :discount)");
+    QSqlQuery updateQuery(m_db);
+    // Never take stock below zero, whatever the lane's in-memory view said
+    updateQuery.prepare("UPDATE Products SET quantity = quantity - :qty WHERE id = :id AND quantity >= :min_qty");
+
     for (auto it = cart.constBegin(); it != cart.constEnd(); ++it) {
         int productId = it.key();
         const CartItem& item = it.value();
 
-        // Insert into SaleItems
-        QSqlQuery itemQuery;
-        itemQuery.prepare("INSERT INTO SaleItems (sale_id, product_id, quantity_sold, price_at_sale) "
-                          "VALUES (:sale_id, :product_id, :qty, :price)");
+        // Insert into SaleItems: the list price and the line's discount, so the line
+        // comes to quantity * price - discount
         itemQuery.bindValue(":sale_id", saleId);
         itemQuery.bindValue(":product_id", productId);
         itemQuery.bindValue(":qty", item.quantity);
         itemQuery.bindValue(":price", item.price);
+        itemQuery.bindValue(":discount", item.discount);
         if (!itemQuery.exec()) {
             qDebug() << "SaleItems insert failed:" << itemQuery.lastError();
-            m_db.rollback();
             return false;
         }
 
         // Update product quantity
-        QSqlQuery updateQuery;
-        updateQuery.prepare("UPDATE Products SET quantity = quantity - :qty WHERE id = :id");
         updateQuery.bindValue(":qty", item.quantity);
         updateQuery.bindValue(":id", productId);
+        updateQuery.bindValue(":min_qty", item.quantity);
         if (!updateQuery.exec()) {
             qDebug() << "Product quantity update failed:" << updateQuery.lastError();
-            m_db.rollback();
+            return false;
+        }
+        if (updateQuery.numRowsAffected() != 1) {
+            qDebug() << "Insufficient stock for product" << productId << "(wanted" << item.quantity << ")";
             return false;
         }
     }
 
-    // If all operations were successful, commit the transaction
-    return m_db.commit();
+    return clearStockContext();
+}
+
+bool DatabaseManager::isSaleCommitted(const QString &saleUuid) const
+{
+    QSqlQuery query(m_db);
+    query.prepare("SELECT 1 FROM Sales WHERE client_uuid = :uuid");
+    query.bindValue(":uuid", saleUuid);
+    return query.exec() && query.next();
 }
 
 void DatabaseManager::initialSetup() {
     // This method should be called once after creating tables.
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.exec("SELECT COUNT(*) FROM Users");
     if (query.next() && query.value(0).toInt() == 0) {
         qDebug() << "No users found. Creating default admin user.";
@@ -279,7 +2384,7 @@ void DatabaseManager::initialSetup() {
         QString password = "admin"; 
         QByteArray passwordHash = QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256);
 
-        QSqlQuery insertQuery;
+        QSqlQuery insertQuery(m_db);
         insertQuery.prepare("INSERT INTO Users (username, password_hash, role) VALUES (:user, :pass, 'Admin')");
         insertQuery.bindValue(":user", username);
         insertQuery.bindValue(":pass", passwordHash.toHex());
@@ -292,7 +2397,7 @@ void DatabaseManager::initialSetup() {
 std::optional<User> DatabaseManager::validateUser(const QString& username, const QString& password) const {
     QByteArray passwordHash = QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256);
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("SELECT id, username, password_hash, role FROM Users WHERE username = :user");
     query.bindValue(":user", username);
     query.exec();
@@ -323,28 +2428,104 @@ QList<SaleDetailItem> DatabaseManager::getSaleDetails(int saleId) const
         return details;
     }
 
-    QSqlQuery query;
-    query.prepare("SELECT P.name, SI.quantity_sold, SI.price_at_sale, P.image_path "
-                  "FROM SaleItems SI JOIN Products P ON SI.product_id = P.id "
-                  "WHERE SI.sale_id = :sale_id");
-    query.bindValue(":sale_id", saleId);
+    // Read the items from the given schema ("main" or an attached partition)
+    auto readItems = [&](const QString &schema) {
+        QSqlQuery query(m_db);
+        query.prepare(QString("SELECT P.name, SI.quantity_sold, SI.price_at_sale, SI.discount, P.image_path "
+                              "FROM %1.SaleItems SI JOIN main.Products P ON SI.product_id = P.id "
+                              "WHERE SI.sale_id = :sale_id").arg(schema));
+        query.bindValue(":sale_id", saleId);
+
+        if (!query.exec()) {
+            qDebug() << "Error: failed to get sale details:" << query.lastError();
+            return;
+        }
 
-    if (!query.exec()) {
-        qDebug() << "Error: failed to get sale details:" << query.lastError();
+        while (query.next()) {
+            details.append({
+                query.value("name").toString(),
+                query.value("quantity_sold").toInt(),
+                query.value("price_at_sale").toDouble(),
+                query.value("discount").toDouble(),
+                query.value("image_path").toString()
+            });
+        }
+    };
+
+    readItems("main");
+    if (!details.isEmpty()) {
         return details;
     }
 
-    while (query.next()) {
-        details.append({
-            query.value("name").toString(),
-            query.value("quantity_sold").toInt(),
-            query.value("price_at_sale").toDouble(),
-            query.value("image_path").toString()
-        });
+    // Not a live sale: look in the archived month(s) whose id range covers it
+    QSqlQuery partitions(m_db);
+    partitions.prepare("SELECT file FROM SalesPartitions "
+                       "WHERE :sale_id BETWEEN min_sale_id AND max_sale_id ORDER BY period");
+    partitions.bindValue(":sale_id", saleId);
+    if (!partitions.exec()) {
+        qDebug() << "Error: failed to look up sale partition:" << partitions.lastError();
+        return details;
+    }
+    while (details.isEmpty() && partitions.next()) {
+        if (attachPartition(partitions.value(0).toString(), "partition")) {
+            readItems("partition");
+            detachDatabase("partition");
+        }
     }
     return details;
 }
 
+bool DatabaseManager::storeZReport(const QDateTime &start, const QDateTime &end, int saleCount, double revenue,
+                                   const QByteArray &summary)
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return false;
+    }
+
+    // First writer wins: another till may have closed the same period already
+    QSqlQuery query(m_db);
+    query.prepare("INSERT OR IGNORE INTO ZReports (period_start, period_end, sale_count, revenue, summary) "
+                  "VALUES (:period_start, :period_end, :sale_count, :revenue, :summary)");
+    query.bindValue(":period_start", start.toUTC().toString("yyyy-MM-dd HH:mm:ss"));
+    query.bindValue(":period_end", end.toUTC().toString("yyyy-MM-dd HH:mm:ss"));
+    query.bindValue(":sale_count", saleCount);
+    query.bindValue(":revenue", revenue);
+    query.bindValue(":summary", QString::fromUtf8(summary));
+
+    if (!query.exec()) {
+        qDebug() << "Error: failed to store Z-report:" << query.lastError();
+        return false;
+    }
+    return true;
+}
+
+QByteArray DatabaseManager::getZReport(const QDateTime &start, const QDateTime &end, QDateTime *generatedAt) const
+{
+    if (!m_db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        return QByteArray();
+    }
+
+    QSqlQuery query(m_db);
+    query.prepare("SELECT summary, generated_at FROM ZReports WHERE period_start = :period_start AND period_end = :period_end");
+    query.bindValue(":period_start", start.toUTC().toString("yyyy-MM-dd HH:mm:ss"));
+    query.bindValue(":period_end", end.toUTC().toString("yyyy-MM-dd HH:mm:ss"));
+
+    if (!query.exec()) {
+        qDebug() << "Error: failed to read Z-report:" << query.lastError();
+        return QByteArray();
+    }
+    if (!query.next()) {
+        return QByteArray();
+    }
+    if (generatedAt) {
+        *generatedAt = QDateTime::fromString(query.value(1).toString(), "yyyy-MM-dd HH:mm:ss");
+        generatedAt->setTimeZone(QTimeZone::utc());
+    }
+    return query.value(0).toString().toUtf8();
+}
+
 bool DatabaseManager::addUser(const UserData &userData)
 {
     if (!m_db.isOpen()) {
@@ -354,7 +2535,7 @@ bool DatabaseManager::addUser(const UserData &userData)
 
     QByteArray passwordHash = QCryptographicHash::hash(userData.password.toUtf8(), QCryptographicHash::Sha256);
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("INSERT INTO Users (username, password_hash, role) "
                   "VALUES (:username, :password_hash, :role)");
     query.bindValue(":username", userData.username);
@@ -376,7 +2557,7 @@ bool DatabaseManager::updateUser(int id, const UserData &userData)
         return false;
     }
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     bool passwordChanged = !userData.password.isEmpty();
 
     QString queryString = "UPDATE Users SET username = :username, role = :role";
@@ -410,7 +2591,7 @@ bool DatabaseManager::deleteUser(int id)
         return false;
     }
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("DELETE FROM Users WHERE id = :id");
     query.bindValue(":id", id);
 
@@ -429,7 +2610,7 @@ void DatabaseManager::addSampleProducts()
         return;
     }
 
-    QSqlQuery countQuery;
+    QSqlQuery countQuery(m_db);
     countQuery.exec("SELECT COUNT(*) FROM Products");
     if (countQuery.next() && countQuery.value(0).toInt() == 0) {
         qDebug() << "No products found. Creating sample products.";
@@ -447,8 +2628,10 @@ double DatabaseManager::getTotalRevenue() const
         return 0.0;
     }
 
-    QSqlQuery query;
-    query.prepare("SELECT SUM(total_amount) FROM Sales");
+    // Archived months contribute their stored totals, so no partition is attached
+    QSqlQuery query(m_db);
+    query.prepare("SELECT (SELECT COALESCE(SUM(total_amount), 0) FROM Sales) + "
+                  "(SELECT COALESCE(SUM(revenue), 0) FROM SalesPartitions)");
     if (query.exec() && query.next()) {
         return query.value(0).toDouble();
     }
@@ -463,7 +2646,7 @@ double DatabaseManager::getTotalStockValue() const
         return 0.0;
     }
 
-    QSqlQuery query("SELECT SUM(price * quantity) FROM Products");
+    QSqlQuery query("SELECT SUM(price * quantity) FROM Products", m_db);
     if (query.exec() && query.next()) {
         return query.value(0).toDouble();
     }
@@ -478,7 +2661,7 @@ int DatabaseManager::getTotalItemQuantity() const
         return 0;
     }
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("SELECT SUM(quantity) FROM Products");
     if (query.exec() && query.next()) {
         return query.value(0).toInt();
@@ -494,9 +2677,11 @@ QString DatabaseManager::getTopSellingProduct() const
         return "N/A";
     }
 
-    QSqlQuery query;
-    query.prepare("SELECT P.name, SUM(SI.quantity_sold) AS total_sold "
-                  "FROM SaleItems SI JOIN Products P ON SI.product_id = P.id "
+    QSqlQuery query(m_db);
+    query.prepare("SELECT P.name, SUM(T.units) AS total_sold "
+                  "FROM (SELECT product_id, quantity_sold AS units FROM SaleItems "
+                  "      UNION ALL SELECT product_id, units FROM SalesPartitionProducts) T "
+                  "JOIN Products P ON T.product_id = P.id "
                   "GROUP BY P.name "
                   "ORDER BY total_sold DESC LIMIT 1");
     if (query.exec() && query.next()) {
@@ -523,7 +2708,7 @@ QMap<QString, double> DatabaseManager::getSalesForLast7Days() const
         daysOrder.prepend(dayName); // Prepend to keep chronological order
     }
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     // Note: SQLite's STRFTIME('%w', ...) returns 0 for Sunday, 1 for Monday, etc.
     // Use STRFTIME('%J', ...) for Julian day for date comparison
     query.prepare("SELECT STRFTIME('%w', sale_date) AS day_of_week, SUM(total_amount) AS daily_sales, "
@@ -548,6 +2733,87 @@ QMap<QString, double> DatabaseManager::getSalesForLast7Days() const
     return weeklySales;
 }
 
+SaleAmounts DatabaseManager::getSaleAmounts(const QSqlDatabase &db, const QDateTime &from, qint64 afterId)
+{
+    SaleAmounts result;
+    if (!db.isOpen()) {
+        qDebug() << "Error: database is not open";
+        result.ok = false;
+        return result;
+    }
+
+    const QString fromText = from.toUTC().toString("yyyy-MM-dd HH:mm:ss");
+    QSqlQuery query(db);
+    query.setForwardOnly(true); // Can be hundreds of thousands of rows
+    auto readAmounts = [&](const QString &schema) {
+        query.prepare(QString("SELECT sale_date, total_amount, client_uuid FROM %1.Sales "
+                              "WHERE id > :after AND sale_date >= :from").arg(schema));
+        query.bindValue(":after", qMax<qint64>(afterId, 0));
+        query.bindValue(":from", fromText);
+        if (!query.exec()) {
+            qDebug() << "Error getting sale amounts:" << query.lastError();
+            result.ok = false;
+            return;
+        }
+
+        while (query.next()) {
+            QDateTime when = QDateTime::fromString(query.value(0).toString(), "yyyy-MM-dd HH:mm:ss");
+            when.setTimeZone(QTimeZone::utc());
+            result.sales.append({ QPointF(when.toMSecsSinceEpoch(), query.value(1).toDouble()), query.value(2).toString() });
+        }
+    };
+
+    // Archived months only change which file a sale is in, so reads that only
+    // want the new sales skip them. One file is attached at a time.
+    if (afterId < 0) {
+        QStringList files;
+        query.prepare("SELECT file FROM SalesPartitions WHERE period >= :from_period ORDER BY period");
+        query.bindValue(":from_period", fromText.left(7));
+        if (query.exec()) {
+            while (query.next()) {
+                files.append(query.value(0).toString());
+            }
+        } else {
+            qDebug() << "Error: failed to look up sale partitions:" << query.lastError();
+        }
+        const QDir directory = QFileInfo(db.databaseName()).absoluteDir();
+        for (const QString &file : std::as_const(files)) {
+            query.prepare("ATTACH DATABASE :file AS partition");
+            query.bindValue(":file", directory.filePath(file));
+            if (!query.exec()) {
+                qDebug() << "Error: failed to attach" << file << ":" << query.lastError();
+                continue;
+            }
+            readAmounts("partition");
+            if (!query.exec("DETACH DATABASE partition")) {
+                qDebug() << "Error: failed to detach" << file << ":" << query.lastError();
+            }
+        }
+    }
+
+    // The live rows and the highest id come from one read transaction, so the
+    // next read from lastId neither misses nor repeats a sale
+    QSqlDatabase connection = db;
+    connection.transaction();
+    readAmounts("main");
+    if (query.exec("SELECT MAX(id) FROM main.Sales") && query.next()) {
+        result.lastId = qMax(query.value(0).toLongLong(), qMax<qint64>(afterId, 0));
+    } else {
+        qDebug() << "Error getting the last sale id:" << query.lastError();
+        result.ok = false;
+    }
+    query.finish();
+    connection.commit();
+
+    // The live table can hold sales older than an archived month (synced from
+    // another site, or journaled before the month was closed), so the merged
+    // points are sorted by time.
+    std::stable_sort(result.sales.begin(), result.sales.end(), [](const SaleAmount &a, const SaleAmount &b) {
+        return a.point.x() < b.point.x();
+    });
+    return result;
+}
+
 int DatabaseManager::getDistinctProductCount() const
 {
     if (!m_db.isOpen()) {
@@ -555,7 +2821,7 @@ int DatabaseManager::getDistinctProductCount() const
         return 0;
     }
 
-    QSqlQuery query("SELECT COUNT(id) FROM Products WHERE quantity > 0");
+    QSqlQuery query("SELECT COUNT(id) FROM Products WHERE quantity > 0", m_db);
     if (query.exec() && query.next()) {
         return query.value(0).toInt();
     }
@@ -570,7 +2836,7 @@ int DatabaseManager::getSalesCountForToday() const
         return 0;
     }
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("SELECT COUNT(id) FROM Sales WHERE DATE(sale_date) = DATE('now')");
     if (query.exec() && query.next()) {
         return query.value(0).toInt();
@@ -586,7 +2852,7 @@ int DatabaseManager::getSalesCountForThisMonth() const
         return 0;
     }
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     query.prepare("SELECT COUNT(id) FROM Sales WHERE STRFTIME('%Y-%m', sale_date) = STRFTIME('%Y-%m', 'now')");
     if (query.exec() && query.next()) {
         return query.value(0).toInt();
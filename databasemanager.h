@@ -4,11 +4,19 @@
 #include <QSqlDatabase>
 #include <QString>
 #include <QList>
+#include <QPair>
+#include <QStringList>
 #include <QMap>
+#include <QHash>
+#include <QDateTime>
+#include <QPointF>
 #include <QCryptographicHash> // For password hashing
 #include <optional> // Use std::optional instead of QOptional
 #include "product.h"
 #include "cartitem.h"
+#include "pendingsale.h"
+#include "bulkpricing.h"
+#include "promotionengine.h"
 
 struct ProductData {
     QString name;
@@ -21,10 +29,28 @@ struct ProductData {
 struct SaleDetailItem {
     QString productName;
     int quantitySold;
-    double priceAtSale;
+    double priceAtSale; // Unit price before promotions
+    double discount; // Off the whole line
     QString imagePath;
 };
 
+struct SalesPoint {
+    QDateTime bucket; // Start of the bucket, UTC
+    double revenue;
+    int units;
+};
+
+struct SaleAmount {
+    QPointF point; // x: msecs since epoch, y: amount
+    QString uuid;  // client_uuid, empty for sales recorded without one
+};
+
+struct SaleAmounts {
+    QList<SaleAmount> sales; // In time order
+    qint64 lastId = 0;       // Highest live sale id when read
+    bool ok = true;
+};
+
 struct User {
     int id;
     QString username;
@@ -38,18 +64,48 @@ struct UserData {
     QString role;
 };
 
+// Counts from one DatabaseManager::pullChanges() run
+struct SyncStats {
+    qint64 read = 0;    // Change-log rows read from the peer
+    qint64 applied = 0; // Rows this database had not seen yet
+    qint64 skipped = 0; // Own changes coming back, or already applied via another peer
+};
+
+// Products that changed after a ChangeLog position (see CatalogCache)
+struct ProductChanges {
+    qint64 lastSeq = 0; // ChangeLog position the changes are complete up to
+    QList<QPair<QString, Product>> updated; // By product uuid; includes new products
+    QStringList removed; // uuids of deleted products
+};
+
+// A product often bought with another one (see BasketMiner)
+struct ProductNeighbour {
+    int productId;
+    int count; // Baskets the two were bought together in
+};
+
 class DatabaseManager
 {
 public:
-    DatabaseManager();
+    enum SeriesResolution { Hourly, Daily, Monthly };
+    enum StockBatchMode { StockTake, Receiving };
+
+    explicit DatabaseManager(const QString &connectionName = QString(), const QString &databasePath = "store.db");
     ~DatabaseManager();
     void init();
     bool addProduct(const ProductData &productData);
     bool deleteProduct(int id);
     bool updateProduct(int id, const ProductData &productData);
+    bool setProductImages(const QHash<int, QString> &imagePaths); // By product id, in one transaction
+    // A bulk repricing in one transaction; changed is the number of products updated
+    bool setProductPrices(const QList<PriceChange> &changes, int *changed = nullptr);
     QList<Product> getAllProducts() const;
     Product getProductById(int id) const;
-    bool processSale(const QMap<int, CartItem>& cart, double totalAmount, int userId);
+    // Changes since sinceSeq, or the whole catalog when sinceSeq is negative
+    bool getProductChanges(qint64 sinceSeq, ProductChanges *changes);
+    bool processSale(const QMap<int, CartItem>& cart, double totalAmount, int userId, const QString &saleUuid = QString());
+    QList<bool> commitSaleBatch(const QList<PendingSale> &sales);
+    bool isSaleCommitted(const QString &saleUuid) const;
     void initialSetup();
     void addSampleProducts();
     std::optional<User> validateUser(const QString& username, const QString& password) const;
@@ -66,6 +122,70 @@ public:
     int getSalesCountForThisMonth() const;
     QString getTopSellingProduct() const;
     QMap<QString, double> getSalesForLast7Days() const;
+    QList<SalesPoint> getSalesSeries(const QDateTime &from, const QDateTime &to, int maxPoints = 400,
+                                     SeriesResolution *resolution = nullptr) const;
+    bool rebuildSalesRollups();
+    // Every sale since from, for charts that downsample themselves. Static so it can run on
+    // a pool thread's ReadConnection. With afterId >= 0 only live sales added after that
+    // id are read; lastId in the result is where the next such read starts.
+    static SaleAmounts getSaleAmounts(const QSqlDatabase &db, const QDateTime &from, qint64 afterId = -1);
+
+    // Sales archive: moves months older than monthsToKeep (plus the current
+    // month) into per-month files; returns the number of months moved
+    int archiveClosedMonths(int monthsToKeep = 1);
+
+    // Writes a consistent copy of the database to filePath (which must not exist)
+    bool snapshotTo(const QString &filePath);
+
+    // Brings a read-only reporting copy at replicaPath up to date with this database
+    bool refreshReplica(const QString &replicaPath);
+    // Changes whenever another connection commits to this database
+    qint64 dataVersion() const;
+
+    // Maintenance steps, each short enough to run between customers
+    bool checkpoint(QString *result = nullptr);
+    bool optimize(QString *result = nullptr);
+    int incrementalVacuum(int pages); // Free pages left, or -1 if not in incremental mode
+    QString quickCheck(const QString &table = QString()) const; // "ok" when healthy
+    // One-off: switches a database created before incremental vacuum to it. Rewrites
+    // the whole file with VACUUM, so nothing else may be using it.
+    bool enableIncrementalVacuum(QString *result = nullptr);
+    void logMaintenance(const QString &task, qint64 durationMs, int slices, const QString &result, bool preempted);
+
+    // Delta sync between store databases: applies the changes in peerPath's change
+    // log that this database has not seen, chunkSize rows per transaction
+    bool pullChanges(const QString &peerPath, SyncStats *stats = nullptr, int chunkSize = 5000);
+    QString siteId() const;
+    bool forkSiteId(); // Gives a copied database file its own identity
+
+    // End-of-day reports, stored once per period and never changed afterwards
+    bool storeZReport(const QDateTime &start, const QDateTime &end, int saleCount, double revenue,
+                      const QByteArray &summary);
+    QByteArray getZReport(const QDateTime &start, const QDateTime &end, QDateTime *generatedAt = nullptr) const;
+
+    // Stock movement ledger. Every quantity change is logged by triggers; these add
+    // a kind and reason to a change, snapshot the catalog, and answer "how many were
+    // on hand at that moment" (by product id; one product if productId > 0)
+    bool adjustStock(int productId, int delta, const QString &kind, const QString &reason);
+    // A whole stock-take (counted quantities) or delivery (quantities received), by
+    // product id, in one transaction; changed is the number of products whose stock moved
+    bool applyStockBatch(const QHash<int, int> &quantities, StockBatchMode mode, const QString &reason,
+                         int *changed = nullptr);
+    bool takeStockSnapshot(int minMovements = 0, QString *result = nullptr);
+    QHash<int, int> getStockAt(const QDateTime &when, int productId = 0, bool *ok = nullptr) const;
+
+    // Frequently bought together: pair counts accumulated by BasketMiner from the sales
+    // after basketMiningPosition(), and each product's top neighbours kept ready.
+    // Pairs are keyed by (smaller product id << 32) | larger product id.
+    qint64 basketMiningPosition() const; // Last sale id counted, or -1 on error
+    // Adds a round counted from fromSaleId up to lastSaleId. If another miner has moved
+    // the position since, the round is discarded and *superseded set instead.
+    bool storeProductPairs(const QHash<quint64, int> &pairs, qint64 fromSaleId, qint64 lastSaleId, int neighbours,
+                           bool *superseded = nullptr);
+    QHash<int, QList<ProductNeighbour>> getProductNeighbours() const; // Best first
+
+    // Promotions that are enabled and not yet over, with their products
+    QList<Promotion> getPromotions() const;
 
     // User management functions
     bool addUser(const UserData &userData);
@@ -73,6 +193,24 @@ public:
     bool deleteUser(int id);
 
 private:
+    bool ensureColumn(const QString &table, const QString &column, const QString &definition);
+    void initSalesRollups();
+    void initSalesPartitions();
+    void initChangeTracking();
+    void initZReports();
+    void initStockMovements();
+    void initPromotions();
+    void initBasketMining();
+    bool setStockContext(const QString &kind, const QString &reason = QString(), const QString &reference = QString());
+    bool clearStockContext();
+    QString partitionPath(const QString &file) const;
+    bool attachDatabase(const QString &filePath, const QString &alias) const;
+    void detachDatabase(const QString &alias) const;
+    bool attachPartition(const QString &file, const QString &alias) const;
+    bool archivePeriod(const QString &period);
+    bool insertSaleRecords(const QMap<int, CartItem>& cart, double totalAmount, int userId, const QString &saleUuid,
+                           const QDateTime &soldAt = QDateTime());
+
     QSqlDatabase m_db;
 };
 
@@ -0,0 +1,150 @@
+#include "groupcommitter.h"
+#include "databasemanager.h"
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QThread>
+#include <vector>
+
+namespace {
+const qint64 StatsLogIntervalMs = 10000;
+}
+
+GroupCommitter::GroupCommitter(const QString &databasePath, int windowMs, int maxBatchSize) :
+    m_databasePath(databasePath),
+    m_stopping(false),
+    m_windowMs(qMax(0, windowMs)),
+    m_maxBatchSize(qMax(1, maxBatchSize))
+{
+    m_clock.start();
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName("GroupCommitter");
+    m_thread->start();
+}
+
+GroupCommitter::~GroupCommitter()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+    }
+    m_wake.wakeAll();
+    m_thread->wait(); // run() drains the queue before returning
+    delete m_thread;
+}
+
+QFuture<bool> GroupCommitter::submit(const PendingSale &sale)
+{
+    Submission submission;
+    submission.sale = sale;
+    submission.promise.start();
+    submission.queuedAt.start();
+    QFuture<bool> future = submission.promise.future();
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue.push_back(std::move(submission));
+    }
+    m_wake.wakeOne();
+    return future;
+}
+
+void GroupCommitter::setWindow(int windowMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_windowMs = qMax(0, windowMs);
+}
+
+void GroupCommitter::setMaxBatchSize(int maxBatchSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxBatchSize = qMax(1, maxBatchSize);
+}
+
+GroupCommitter::Stats GroupCommitter::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats stats = m_stats;
+    stats.elapsedMs = m_clock.elapsed();
+    return stats;
+}
+
+void GroupCommitter::run()
+{
+    // The connection belongs to this thread for its whole life
+    DatabaseManager dbManager("groupcommit", m_databasePath);
+    QElapsedTimer intervalClock;
+    intervalClock.start();
+
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        while (m_queue.empty() && !m_stopping) {
+            m_wake.wait(&m_mutex);
+        }
+        if (m_queue.empty()) {
+            break; // Stopping and fully drained
+        }
+
+        // Hold the window open from the first sale's arrival, not from now
+        const qint64 waited = m_queue.front().queuedAt.elapsed();
+        QDeadlineTimer deadline(qMax<qint64>(0, m_windowMs - waited));
+        while (!m_stopping && static_cast<int>(m_queue.size()) < m_maxBatchSize) {
+            if (!m_wake.wait(&m_mutex, deadline)) {
+                break;
+            }
+        }
+
+        std::vector<Submission> batch;
+        QList<PendingSale> sales;
+        while (!m_queue.empty() && static_cast<int>(batch.size()) < m_maxBatchSize) {
+            sales.append(m_queue.front().sale);
+            batch.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+        locker.unlock();
+
+        const QList<bool> results = dbManager.commitSaleBatch(sales);
+
+        double latencySum = 0.0;
+        double latencyMax = 0.0;
+        qint64 failed = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const double latencyMs = batch[i].queuedAt.nsecsElapsed() / 1.0e6;
+            latencySum += latencyMs;
+            latencyMax = qMax(latencyMax, latencyMs);
+            if (!results.at(static_cast<int>(i))) {
+                failed++;
+            }
+            batch[i].promise.addResult(results.at(static_cast<int>(i)));
+            batch[i].promise.finish();
+        }
+
+        locker.relock();
+        for (Stats *stats : { &m_stats, &m_interval }) {
+            stats->sales += static_cast<qint64>(batch.size());
+            stats->failedSales += failed;
+            stats->batches++;
+            stats->totalLatencyMs += latencySum;
+            stats->maxLatencyMs = qMax(stats->maxLatencyMs, latencyMax);
+        }
+        if (intervalClock.elapsed() >= StatsLogIntervalMs) {
+            m_interval.elapsedMs = intervalClock.restart();
+            logStats();
+            m_interval = Stats();
+        }
+    }
+}
+
+void GroupCommitter::logStats()
+{
+    // Throughput versus the latency the window adds, for tuning windowMs/maxBatchSize
+    if (m_interval.sales == 0 || m_interval.elapsedMs == 0) {
+        return;
+    }
+    qDebug().nospace() << "Group commit: "
+                       << m_interval.sales * 1000.0 / m_interval.elapsedMs << " sales/s, "
+                       << double(m_interval.sales) / m_interval.batches << " sales/batch, "
+                       << "avg latency " << m_interval.totalLatencyMs / m_interval.sales << " ms, "
+                       << "max " << m_interval.maxLatencyMs << " ms, "
+                       << m_interval.failedSales << " failed "
+                       << "(window " << m_windowMs << " ms, max batch " << m_maxBatchSize << ")";
+}
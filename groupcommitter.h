@@ -0,0 +1,69 @@
+#ifndef GROUPCOMMITTER_H
+#define GROUPCOMMITTER_H
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QMutex>
+#include <QPromise>
+#include <QString>
+#include <QWaitCondition>
+#include <deque>
+#include "pendingsale.h"
+
+class QThread;
+
+// Sits in front of a DatabaseManager and turns concurrently submitted sales into
+// shared transactions. The first sale to arrive opens a window; everything submitted
+// before it closes (or until the batch is full) is committed together with a single
+// fsync. Every sale still gets its own result through the returned future.
+class GroupCommitter
+{
+public:
+    struct Stats {
+        qint64 sales = 0;
+        qint64 failedSales = 0;
+        qint64 batches = 0;
+        double totalLatencyMs = 0.0; // Submit-to-result, summed over all sales
+        double maxLatencyMs = 0.0;
+        qint64 elapsedMs = 0; // Wall time the stats cover
+    };
+
+    static constexpr int DefaultWindowMs = 5;
+    static constexpr int DefaultMaxBatchSize = 64;
+
+    explicit GroupCommitter(const QString &databasePath,
+                            int windowMs = DefaultWindowMs,
+                            int maxBatchSize = DefaultMaxBatchSize);
+    ~GroupCommitter();
+
+    // Thread-safe; may be called from any thread.
+    QFuture<bool> submit(const PendingSale &sale);
+
+    void setWindow(int windowMs);
+    void setMaxBatchSize(int maxBatchSize);
+    Stats stats() const;
+
+private:
+    struct Submission {
+        PendingSale sale;
+        QPromise<bool> promise;
+        QElapsedTimer queuedAt;
+    };
+
+    void run();
+    void logStats();
+
+    QString m_databasePath;
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    std::deque<Submission> m_queue;
+    bool m_stopping;
+    int m_windowMs;
+    int m_maxBatchSize;
+    Stats m_stats; // Lifetime totals
+    Stats m_interval; // Since the last log line
+    QElapsedTimer m_clock;
+    QThread *m_thread;
+};
+
+#endif // GROUPCOMMITTER_H
@@ -0,0 +1,216 @@
+#include "imagestore.h"
+#include "databasemanager.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QtConcurrent>
+
+namespace {
+const char *const VariantNames[] = { "tile", "row", "preview" };
+
+bool isHashDirectory(const QString &name)
+{
+    if (name.size() != 64) return false;
+    for (const QChar c : name) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+    }
+    return true;
+}
+
+bool writeImage(const QImage &image, const QString &path, QString *error)
+{
+    // QSaveFile renames into place, so a concurrent import of the same picture or a
+    // crash never leaves a half-written file under the final name
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    QImageWriter writer(&file, QFileInfo(path).suffix().toLatin1());
+    if (writer.format() == "jpg") {
+        writer.setQuality(ImageStore::JpegQuality);
+        writer.setOptimizedWrite(true);
+        writer.setProgressiveScanWrite(true);
+    }
+    if (!writer.write(image)) {
+        *error = writer.errorString();
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+}
+
+int ImageStore::maxSize(Variant variant)
+{
+    switch (variant) {
+    case Tile:
+        return 100; // posProductListView icon size
+    case Row:
+        return 60; // Sale detail row height
+    case Preview:
+        return 400;
+    }
+    return 400;
+}
+
+QString ImageStore::variantPath(const QString &imagePath, Variant variant)
+{
+    if (!isStored(imagePath)) {
+        return imagePath;
+    }
+    const QFileInfo info(imagePath);
+    return info.dir().filePath(QString("%1.%2").arg(QLatin1String(VariantNames[variant]), info.suffix()));
+}
+
+bool ImageStore::isStored(const QString &imagePath)
+{
+    const QFileInfo info(imagePath);
+    return info.completeBaseName() == QLatin1String(VariantNames[Preview]) && isHashDirectory(info.dir().dirName());
+}
+
+QImage ImageStore::decode(const QString &sourcePath, int maxSize, QString *error)
+{
+    QImageReader reader(sourcePath);
+    reader.setAutoTransform(true); // Camera photos carry their rotation in EXIF
+
+    // Ask the decoder for the target size; JPEG then decodes at 1/2, 1/4 or 1/8
+    // scale instead of expanding a multi-megapixel photo first
+    QSize size = reader.size();
+    if (size.isValid() && (size.width() > maxSize || size.height() > maxSize)) {
+        size.scale(maxSize, maxSize, Qt::KeepAspectRatio);
+        reader.setScaledSize(size);
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        *error = reader.errorString();
+        return image;
+    }
+    if (image.width() > maxSize || image.height() > maxSize) {
+        image = image.scaled(maxSize, maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+ImageStore::Result ImageStore::ingest(const QString &sourcePath, const QString &root)
+{
+    Result result;
+    result.sourcePath = sourcePath;
+
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly)) {
+        result.error = source.errorString();
+        return result;
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!hash.addData(&source)) {
+        result.error = source.errorString();
+        return result;
+    }
+    source.close();
+    const QString digest = QString::fromLatin1(hash.result().toHex());
+    const QDir dir(QDir(root).filePath(digest.left(2) + "/" + digest));
+
+    // Same content as an earlier import: point at what is already there
+    for (const char *suffix : { "jpg", "png" }) {
+        const QString preview = dir.filePath(QString("%1.%2").arg(QLatin1String(VariantNames[Preview]), QLatin1String(suffix)));
+        if (QFile::exists(preview) && QFile::exists(variantPath(preview, Tile)) && QFile::exists(variantPath(preview, Row))) {
+            result.imagePath = preview;
+            result.reused = true;
+            return result;
+        }
+    }
+
+    // Decoded once at the largest size; the smaller ones are scaled from that
+    QImage preview = decode(sourcePath, maxSize(Preview), &result.error);
+    if (preview.isNull()) {
+        return result;
+    }
+    const bool alpha = preview.hasAlphaChannel();
+    if (!alpha && preview.format() != QImage::Format_RGB32) {
+        preview = preview.convertToFormat(QImage::Format_RGB32);
+    }
+    const QString suffix = alpha ? "png" : "jpg";
+
+    if (!dir.mkpath(".")) {
+        result.error = QString("Could not create %1").arg(dir.path());
+        return result;
+    }
+    for (Variant variant : { Tile, Row, Preview }) {
+        const int size = maxSize(variant);
+        const QImage image = (preview.width() > size || preview.height() > size)
+                                 ? preview.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+                                 : preview;
+        const QString path = dir.filePath(QString("%1.%2").arg(QLatin1String(VariantNames[variant]), suffix));
+        if (!writeImage(image, path, &result.error)) {
+            return result;
+        }
+    }
+    result.imagePath = dir.filePath(QString("%1.%2").arg(QLatin1String(VariantNames[Preview]), suffix));
+    return result;
+}
+
+QList<ImageStore::Result> ImageStore::ingestAll(const QStringList &sourcePaths, const QString &root)
+{
+    return QtConcurrent::blockingMapped<QList<Result>>(sourcePaths, [root](const QString &sourcePath) {
+        return ingest(sourcePath, root);
+    });
+}
+
+int runImageMigration(const QString &databasePath)
+{
+    QTextStream out(stdout);
+    DatabaseManager dbManager("image-migration", databasePath);
+    dbManager.init();
+
+    // Several products may share a file; each file is imported once
+    QHash<QString, QList<int>> productsByFile;
+    for (const Product &product : dbManager.getAllProducts()) {
+        if (!product.imagePath.isEmpty() && !ImageStore::isStored(product.imagePath)) {
+            productsByFile[product.imagePath].append(product.id);
+        }
+    }
+    if (productsByFile.isEmpty()) {
+        out << "All product images are already in the image store\n";
+        return 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QList<ImageStore::Result> results = ImageStore::ingestAll(productsByFile.keys());
+
+    QHash<int, QString> imagePaths;
+    int reused = 0;
+    int failed = 0;
+    for (const ImageStore::Result &result : results) {
+        if (result.imagePath.isEmpty()) {
+            out << "  Skipped " << result.sourcePath << ": " << result.error << "\n";
+            ++failed;
+            continue;
+        }
+        reused += result.reused ? 1 : 0;
+        for (int productId : productsByFile.value(result.sourcePath)) {
+            imagePaths.insert(productId, result.imagePath);
+        }
+    }
+    if (!imagePaths.isEmpty() && !dbManager.setProductImages(imagePaths)) {
+        out << "FAIL: could not update the products; the imported files are kept\n";
+        return 1;
+    }
+
+    out << QString("Imported %1 images (%2 already stored, %3 skipped) for %4 products in %5 ms\n")
+               .arg(results.size() - failed).arg(reused).arg(failed).arg(imagePaths.size()).arg(timer.elapsed());
+    return failed == 0 ? 0 : 1;
+}
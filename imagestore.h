@@ -0,0 +1,51 @@
+#ifndef IMAGESTORE_H
+#define IMAGESTORE_H
+
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Product pictures stored by content. An imported file is hashed (SHA-256) and
+// its display sizes are written once to images/<2 hex>/<hash>/, so the same photo
+// from two suppliers is stored once and two different photos with the same file
+// name no longer collide. The original is decoded once, at Preview size (JPEG
+// decodes at scale), and the smaller sizes are scaled down from that; each is
+// saved as JPEG, or PNG when the picture has transparency. Products.image_path
+// holds the Preview file; the other sizes sit next to it and are found with
+// variantPath(). Paths from before the store are returned unchanged.
+class ImageStore
+{
+public:
+    enum Variant {
+        Tile,    // POS product grid
+        Row,     // Sale detail rows
+        Preview  // Product dialog; the path stored in the database
+    };
+
+    struct Result {
+        QString sourcePath;
+        QString imagePath; // Preview path to store, empty on failure
+        bool reused = false; // The same content was already in the store
+        QString error;
+    };
+
+    static constexpr int JpegQuality = 85;
+
+    static int maxSize(Variant variant);
+    static QString variantPath(const QString &imagePath, Variant variant);
+    static bool isStored(const QString &imagePath);
+
+    static Result ingest(const QString &sourcePath, const QString &root = "images");
+    static QList<Result> ingestAll(const QStringList &sourcePaths, const QString &root = "images"); // In parallel
+
+private:
+    static QImage decode(const QString &sourcePath, int maxSize, QString *error);
+};
+
+// Moves every product picture that is not in the store yet into it, importing on
+// the global thread pool, and repoints Products.image_path in one transaction.
+// Prints what was imported. Returns a process exit code. Started with --migrate-images.
+int runImageMigration(const QString &databasePath);
+
+#endif // IMAGESTORE_H
@@ -1,7 +1,7 @@
 #include "logindialog.h"
 #include "ui_logindialog.h"
 #include <QMessageBox> // Will be removed soon, but keep for now
-#include <QGraphicsDropShadowEffect>
+#include "shadoweffect.h"
 #include <optional>
 
 LoginDialog::LoginDialog(QWidget *parent) :
@@ -12,18 +12,10 @@ LoginDialog::LoginDialog(QWidget *parent) :
     ui->setupUi(this);
 
     // Shadow effect for the central frame
-    QGraphicsDropShadowEffect *frameEffect = new QGraphicsDropShadowEffect(this);
-    frameEffect->setBlurRadius(25);
-    frameEffect->setColor(QColor(0, 0, 0, 80));
-    frameEffect->setOffset(5, 5);
-    ui->centralFrame->setGraphicsEffect(frameEffect);
+    ui->centralFrame->setGraphicsEffect(ShadowEffect::create(25, 5, 5, QColor(0, 0, 0, 80), ShadowEffect::RoundedRect, 0, this));
 
-    // Shadow effect for the logo
-    QGraphicsDropShadowEffect *logoEffect = new QGraphicsDropShadowEffect(this);
-    logoEffect->setBlurRadius(15);
-    logoEffect->setColor(QColor(0, 0, 0, 100));
-    logoEffect->setOffset(2, 2);
-    ui->logoLabel->setGraphicsEffect(logoEffect);
+    // Shadow effect for the logo, following its transparent outline
+    ui->logoLabel->setGraphicsEffect(ShadowEffect::create(15, 2, 2, QColor(0, 0, 0, 100), ShadowEffect::Alpha, 0, this));
 
     connect(ui->loginButton, &QPushButton::clicked, this, &LoginDialog::on_loginButton_clicked);
     
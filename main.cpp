@@ -3,14 +3,110 @@
 #include "databasemanager.h" // Include the db manager
 #include <QApplication>
 #include <QIcon>
-#include <QFile>
 #include <QTextStream>
 #include <QFontDatabase>
 #include <QDir>
 #include <QDebug>
+#include <QCommandLineParser>
+#include <memory>
+#include "storeprotocol.h"
+#include "storeserver.h"
+#include "storeloopback.h"
+#include "storesync.h"
+#include "uibenchmark.h"
+#include "posstyle.h"
+#include "imagestore.h"
+#include "stockhistory.h"
+#include "basketminer.h"
+#include "maintenancescheduler.h"
 
 int main(int argc, char *argv[]) {
-    QApplication a(argc, argv);
+    // The store server, the loopback test, sync, image and vacuum migration, stock history and basket mining are headless and must not need a display
+    bool headless = false;
+    for (int i = 1; i < argc; ++i) {
+        const QByteArray arg(argv[i]);
+        if (arg == "--server" || arg == "--loopback-test" || arg == "--sync" || arg == "--migrate-images" || arg == "--enable-incremental-vacuum" || arg == "--stock-at" || arg == "--mine-baskets") {
+            headless = true;
+        }
+    }
+    std::unique_ptr<QCoreApplication> app(headless ? new QCoreApplication(argc, argv) : new QApplication(argc, argv));
+
+    // Several tills can run on one host; each needs its own journal files
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption laneOption("lane", "Lane (till) number for this instance.", "number", "1");
+    parser.addOption(laneOption);
+    QCommandLineOption serverOption("server", "Run the headless store server that owns store.db.");
+    parser.addOption(serverOption);
+    QCommandLineOption listenOption("listen", "Store server address: a TCP port or a local socket name.", "address",
+                                    StoreProtocol::DefaultServerName);
+    parser.addOption(listenOption);
+    QCommandLineOption bindOption("bind", "IP address the store server's TCP port listens on; 0.0.0.0 accepts other hosts.",
+                                  "ip", "127.0.0.1");
+    parser.addOption(bindOption);
+    QCommandLineOption connectOption("connect", "Send this till's sales to a store server (host:port or local socket name).",
+                                     "address");
+    parser.addOption(connectOption);
+    QCommandLineOption loopbackOption("loopback-test", "Run several lanes against a scratch store server and exit.");
+    parser.addOption(loopbackOption);
+    QCommandLineOption lanesOption("lanes", "Lanes for --loopback-test.", "count", "4");
+    parser.addOption(lanesOption);
+    QCommandLineOption salesOption("sales", "Sales per lane for --loopback-test.", "count", "500");
+    parser.addOption(salesOption);
+    QCommandLineOption syncOption("sync", "Exchange changes with another store database and exit.", "peer.db");
+    parser.addOption(syncOption);
+    QCommandLineOption migrateImagesOption("migrate-images", "Move product images into the image store and exit.");
+    parser.addOption(migrateImagesOption);
+    QCommandLineOption vacuumOption("enable-incremental-vacuum",
+                                    "Convert store.db so idle-time maintenance can vacuum it, and exit.");
+    parser.addOption(vacuumOption);
+    QCommandLineOption stockAtOption("stock-at", "Print stock on hand at a past date (or date and time) and exit.", "when");
+    parser.addOption(stockAtOption);
+    QCommandLineOption mineBasketsOption("mine-baskets", "Count products bought together for POS suggestions and exit.");
+    parser.addOption(mineBasketsOption);
+    QCommandLineOption paintBenchmarkOption("paint-benchmark", "Time dashboard and login repaints and exit.");
+    parser.addOption(paintBenchmarkOption);
+    QCommandLineOption themeBenchmarkOption("theme-benchmark", "Compare PosStyle with style.qss and exit.");
+    parser.addOption(themeBenchmarkOption);
+    QCommandLineOption framesOption("frames", "Iterations per measurement for --paint-benchmark and --theme-benchmark.",
+                                    "count", "200");
+    parser.addOption(framesOption);
+    parser.process(*app);
+    const int laneId = qMax(1, parser.value(laneOption).toInt());
+
+    if (parser.isSet(loopbackOption)) {
+        return runStoreLoopbackTest(qMax(1, parser.value(lanesOption).toInt()), qMax(1, parser.value(salesOption).toInt()));
+    }
+    if (parser.isSet(syncOption)) {
+        return runStoreSync("store.db", parser.value(syncOption));
+    }
+    if (parser.isSet(migrateImagesOption)) {
+        return runImageMigration("store.db");
+    }
+    if (parser.isSet(vacuumOption)) {
+        return runVacuumMigration("store.db");
+    }
+    if (parser.isSet(mineBasketsOption)) {
+        return runBasketMining("store.db");
+    }
+    if (parser.isSet(stockAtOption)) {
+        return runStockAt("store.db", parser.value(stockAtOption));
+    }
+    if (parser.isSet(serverOption)) {
+        StoreServer server("store.db");
+        const QHostAddress bindAddress(parser.value(bindOption));
+        if (bindAddress.isNull()) {
+            qCritical() << "Invalid --bind address:" << parser.value(bindOption);
+            return 1;
+        }
+        if (!server.listen(parser.value(listenOption), bindAddress)) {
+            qCritical() << "Store server failed to listen:" << server.errorString();
+            return 1;
+        }
+        return app->exec();
+    }
+
+    QApplication &a = *static_cast<QApplication *>(app.get());
     a.setWindowIcon(QIcon(":/images/iconapp.png"));
 
     // Load custom fonts from resources
@@ -26,23 +122,31 @@ int main(int argc, char *argv[]) {
         qWarning() << "Font resource directory not found: :/fonts/Font/";
     }
 
-    QFile styleFile(":/style.qss");
-    if (!styleFile.open(QFile::ReadOnly)) {
-        qWarning("Failed to open stylesheet file.");
+    // POS_THEME=qss falls back to the stylesheet the style was derived from
+    if (qEnvironmentVariable("POS_THEME") == QLatin1String("qss")) {
+        PosStyle::applyStyleSheet(a);
+    } else {
+        PosStyle::apply(a);
+    }
+
+    if (parser.isSet(paintBenchmarkOption)) {
+        return runPaintBenchmark(qMax(1, parser.value(framesOption).toInt()));
+    }
+    if (parser.isSet(themeBenchmarkOption)) {
+        return runThemeBenchmark(qMax(1, parser.value(framesOption).toInt()));
     }
-    QString styleSheet = QLatin1String(styleFile.readAll());
-    a.setStyleSheet(styleSheet);
 
     // Create the one and only DatabaseManager instance
     DatabaseManager dbManager; // Instantiate the manager
     dbManager.init(); // Initialize tables
     dbManager.initialSetup(); // Create default admin if needed
     dbManager.addSampleProducts(); // Create sample products if needed
+    dbManager.archiveClosedMonths(); // Move closed months out of the live tables
 
     LoginDialog loginDialog;
     loginDialog.setDatabaseManager(&dbManager);
 
-    MainWindow w;
+    MainWindow w(laneId, parser.value(connectOption));
     w.setDatabaseManager(&dbManager);
 
     QObject::connect(&w, &MainWindow::userLoggedOut, &loginDialog, [&]() {
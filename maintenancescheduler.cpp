@@ -0,0 +1,232 @@
+#include "maintenancescheduler.h"
+#include "databasemanager.h"
+#include "basketminer.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTimer>
+
+namespace {
+const char *const TaskNames[] = { "stock_snapshot", "basket_mining", "wal_checkpoint", "optimize", "incremental_vacuum", "quick_check" };
+}
+
+MaintenanceWorker::MaintenanceWorker(const QString &databasePath, const std::atomic<bool> *preempted, QObject *parent) :
+    QObject(parent),
+    m_databasePath(databasePath),
+    m_preempted(preempted),
+    m_dbManager(nullptr),
+    m_running(false),
+    m_task(StockSnapshot),
+    m_minedSales(0),
+    m_slices(0),
+    m_windowSlices(0),
+    m_taskMs(0)
+{
+}
+
+MaintenanceWorker::~MaintenanceWorker()
+{
+    delete m_dbManager;
+}
+
+void MaintenanceWorker::start()
+{
+    // Created here so the connection belongs to the maintenance thread
+    m_dbManager = new DatabaseManager("maintenance", m_databasePath);
+}
+
+void MaintenanceWorker::runIdle()
+{
+    if (!m_dbManager || m_running) {
+        return;
+    }
+    m_running = true;
+    m_windowSlices = 0;
+    runSlice();
+}
+
+void MaintenanceWorker::runSlice()
+{
+    if (!m_dbManager) {
+        return; // Shut down
+    }
+    if (m_preempted->load()) {
+        // The task resumes here next time; log what this window managed
+        if (m_windowSlices > 0) {
+            finishTask(QString("preempted after %1 slice(s)").arg(m_slices), true);
+        }
+        m_running = false;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    bool taskDone = false;
+    QString result;
+    const bool ok = runTaskSlice(&taskDone, &result);
+    m_taskMs += timer.elapsed();
+    m_slices++;
+    m_windowSlices++;
+
+    if (!ok || taskDone) {
+        finishTask(ok ? result : QString("error: %1").arg(result), false);
+        if (++m_task == TaskCount) {
+            m_task = StockSnapshot;
+            m_running = false;
+            emit runFinished();
+            return;
+        }
+    }
+    // Back through the event loop so shutdown and new requests are seen between slices
+    QTimer::singleShot(0, this, &MaintenanceWorker::runSlice);
+}
+
+bool MaintenanceWorker::runTaskSlice(bool *taskDone, QString *result)
+{
+    switch (m_task) {
+    case StockSnapshot:
+        *taskDone = true;
+        return m_dbManager->takeStockSnapshot(StockSnapshotMovements, result);
+    case BasketMining: {
+        // A long backlog (say, after an import) is worked through over several slices
+        const MiningStats stats = BasketMiner::mine(m_dbManager, MiningSalesPerSlice);
+        m_minedSales = (m_slices == 0 ? 0 : m_minedSales) + stats.sales;
+        *taskDone = !stats.ok || stats.caughtUp;
+        *result = stats.ok ? QString("%1 sale(s) counted, up to sale %2").arg(m_minedSales).arg(stats.lastSaleId)
+                           : QString("failed at sale %1").arg(stats.lastSaleId);
+        return stats.ok;
+    }
+    case Checkpoint:
+        *taskDone = true;
+        return m_dbManager->checkpoint(result);
+    case Optimize:
+        *taskDone = true;
+        return m_dbManager->optimize(result);
+    case IncrementalVacuum: {
+        const int freePages = m_dbManager->incrementalVacuum(VacuumPagesPerSlice);
+        if (freePages < 0) {
+            *taskDone = true;
+            *result = "skipped: auto_vacuum is not incremental";
+            return true;
+        }
+        *taskDone = (freePages == 0);
+        *result = QString("%1 slice(s) of %2 pages").arg(m_slices + 1).arg(VacuumPagesPerSlice);
+        return true;
+    }
+    case QuickCheck: {
+        // One table per slice, so a large database is checked across several windows
+        if (m_slices == 0) {
+            m_tablesToCheck = m_dbManager->getDatabase().tables();
+            m_problems.clear();
+        }
+        if (!m_tablesToCheck.isEmpty()) {
+            const QString table = m_tablesToCheck.takeFirst();
+            const QString check = m_dbManager->quickCheck(table);
+            if (check != "ok") {
+                m_problems.append(QString("%1: %2").arg(table, check));
+            }
+        }
+        *taskDone = m_tablesToCheck.isEmpty();
+        *result = m_problems.isEmpty() ? QString("ok") : m_problems.join("; ");
+        if (*taskDone && !m_problems.isEmpty()) {
+            qWarning() << "Database quick_check found problems:" << *result;
+        }
+        return true;
+    }
+    default:
+        *taskDone = true;
+        return true;
+    }
+}
+
+void MaintenanceWorker::finishTask(const QString &result, bool preempted)
+{
+    const QString task = TaskNames[m_task];
+    m_dbManager->logMaintenance(task, m_taskMs, m_slices, result, preempted);
+    qDebug() << "Maintenance" << task << (preempted ? "preempted" : "finished") << "in" << m_taskMs << "ms:" << result;
+    if (!preempted) {
+        m_slices = 0;
+        m_taskMs = 0;
+    } else if (m_task != QuickCheck && m_task != IncrementalVacuum && m_task != BasketMining) {
+        m_slices = 0; // Single-slice tasks simply run again
+        m_taskMs = 0;
+    }
+}
+
+void MaintenanceWorker::shutdown()
+{
+    delete m_dbManager;
+    m_dbManager = nullptr;
+}
+
+MaintenanceScheduler::MaintenanceScheduler(const QString &databasePath, QObject *parent) :
+    QObject(parent),
+    m_preempted(false)
+{
+    int idleSeconds = DefaultIdleSeconds;
+    bool ok = false;
+    const int idleOverride = qEnvironmentVariableIntValue("POS_MAINTENANCE_IDLE_S", &ok);
+    if (ok && idleOverride > 0) idleSeconds = idleOverride;
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(idleSeconds * 1000);
+    connect(m_idleTimer, &QTimer::timeout, this, &MaintenanceScheduler::onIdle);
+
+    m_worker = new MaintenanceWorker(databasePath, &m_preempted);
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &MaintenanceWorker::runFinished, this, &MaintenanceScheduler::onRunFinished);
+    m_thread.setObjectName("MaintenanceScheduler");
+    m_thread.start(QThread::IdlePriority);
+    QMetaObject::invokeMethod(m_worker, &MaintenanceWorker::start, Qt::QueuedConnection);
+
+    m_idleTimer->start();
+}
+
+MaintenanceScheduler::~MaintenanceScheduler()
+{
+    m_preempted = true; // Stops a run at the next slice boundary
+    QMetaObject::invokeMethod(m_worker, &MaintenanceWorker::shutdown, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void MaintenanceScheduler::noteActivity()
+{
+    m_preempted = true;
+    m_idleTimer->start();
+}
+
+void MaintenanceScheduler::onIdle()
+{
+    if (m_sinceLastRun.isValid() && m_sinceLastRun.elapsed() < MinRunIntervalMs) {
+        m_idleTimer->start(); // Look again after another idle period
+        return;
+    }
+    m_preempted = false;
+    QMetaObject::invokeMethod(m_worker, &MaintenanceWorker::runIdle, Qt::QueuedConnection);
+}
+
+void MaintenanceScheduler::onRunFinished()
+{
+    m_sinceLastRun.start();
+    m_idleTimer->start();
+}
+
+int runVacuumMigration(const QString &databasePath)
+{
+    QTextStream out(stdout);
+    DatabaseManager dbManager("vacuum-migration", databasePath);
+    dbManager.init();
+
+    QElapsedTimer timer;
+    timer.start();
+    QString result;
+    if (!dbManager.enableIncrementalVacuum(&result)) {
+        out << "Could not enable incremental vacuum: " << result << "\n";
+        return 1;
+    }
+    out << "Incremental vacuum: " << result << " in " << timer.elapsed() << " ms\n";
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef MAINTENANCESCHEDULER_H
+#define MAINTENANCESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QStringList>
+#include <QThread>
+#include <atomic>
+
+class DatabaseManager;
+class QTimer;
+
+// Runs maintenance on its own connection, one short slice per event so it can stop
+// between any two slices.
+class MaintenanceWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int VacuumPagesPerSlice = 64;
+    static constexpr int StockSnapshotMovements = 1000; // Bounds the ledger scan of a point-in-time stock query
+    static constexpr int MiningSalesPerSlice = 20000; // Sales counted for suggestions per slice
+
+    MaintenanceWorker(const QString &databasePath, const std::atomic<bool> *preempted, QObject *parent = nullptr);
+    ~MaintenanceWorker();
+
+public slots:
+    void start();
+    void runIdle(); // Start (or resume) a run; returns at the first preemption
+    void shutdown();
+
+signals:
+    void runFinished();
+
+private:
+    enum Task { StockSnapshot, BasketMining, Checkpoint, Optimize, IncrementalVacuum, QuickCheck, TaskCount };
+
+    void runSlice();
+    bool runTaskSlice(bool *taskDone, QString *result);
+    void finishTask(const QString &result, bool preempted);
+
+    QString m_databasePath;
+    const std::atomic<bool> *m_preempted;
+    DatabaseManager *m_dbManager;
+    bool m_running;
+    int m_task; // Resumes here after a preemption
+    QStringList m_tablesToCheck;
+    QStringList m_problems;
+    qint64 m_minedSales; // Sales counted by the current basket mining task
+    int m_slices; // Slices run for the current task
+    int m_windowSlices; // Slices run in the current idle window
+    qint64 m_taskMs; // Time spent in the current task, across idle windows
+};
+
+// Keeps store.db healthy in the gaps between customers. After the cart has been idle
+// for a while it snapshots stock levels for the movement ledger, counts new baskets
+// for product suggestions, checkpoints the WAL, refreshes planner statistics (PRAGMA
+// optimize), returns free pages to the file system (incremental vacuum) and
+// quick-checks each table. Work is split into short
+// slices, and any cart activity stops it before the next slice; an interrupted run
+// picks up where it left off. Each task's timings are written to MaintenanceLog. The
+// idle threshold can be tuned with POS_MAINTENANCE_IDLE_S.
+class MaintenanceScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultIdleSeconds = 120;
+    static constexpr int MinRunIntervalMs = 30 * 60 * 1000; // Between completed runs
+
+    MaintenanceScheduler(const QString &databasePath, QObject *parent = nullptr);
+    ~MaintenanceScheduler();
+
+    void noteActivity(); // Cart activity: stop maintenance and restart the idle clock
+
+private slots:
+    void onIdle();
+    void onRunFinished();
+
+private:
+    QThread m_thread;
+    MaintenanceWorker *m_worker;
+    QTimer *m_idleTimer;
+    std::atomic<bool> m_preempted;
+    QElapsedTimer m_sinceLastRun; // Invalid until a run completes
+};
+
+// Converts store.db created before incremental vacuum so the idle-time vacuum can
+// run on it, and prints the outcome. Returns a process exit code. Started with
+// --enable-incremental-vacuum, with no lane or server using the database.
+int runVacuumMigration(const QString &databasePath);
+
+#endif // MAINTENANCESCHEDULER_H
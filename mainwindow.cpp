@@ -4,20 +4,40 @@
 #include "productdialog.h" // Include the dialog header
 #include "saledetaildialog.h" // Include the sale detail dialog header
 #include "userdialog.h" // Include UserDialog
+#include "checkoutpipeline.h"
+#include "backupservice.h"
+#include "analyticsreplica.h"
+#include "maintenancescheduler.h"
+#include "catalogcache.h"
+#include "saledetailcache.h"
+#include "imagestore.h"
+#include "zreportdialog.h"
+#include "stocktakedialog.h"
+#include "bulkpricedialog.h"
 #include <QDate>
 #include <QDebug> // Include QDebug for debugging purposes
 #include <QModelIndex>
 #include <QStandardItemModel>
 #include <QStyle> // For standard icons
 #include <QMessageBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QSqlRecord>
+#include <QTimer>
+#include <QFileInfo>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <utility> // Required for std::as_const
 
 // Remove 'using namespace QtCharts;'
 // All QtCharts classes will be explicitly qualified with 'QtCharts::'
 
-MainWindow::MainWindow(QWidget *parent)
+MainWindow::MainWindow(int laneId, const QString &storeServer, QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , m_laneId(laneId)
 {
     ui->setupUi(this);
 
@@ -30,60 +50,88 @@ MainWindow::MainWindow(QWidget *parent)
     m_dbManager = nullptr;
     m_posProductsModel = nullptr;
     m_proxyModel = nullptr;
+    // Page models are created the first time their page is opened
+    m_productsModel = nullptr;
+    m_salesModel = nullptr;
+    m_usersModel = nullptr;
+    m_catalogDirty = true;
+    m_seedDeferred = false;
+
+    // Price and stock changes made by any lane reach the POS grid within a poll period
+    m_catalogCache = new CatalogCache("store.db", this);
+    connect(m_catalogCache, &CatalogCache::productsChanged, this, &MainWindow::onCatalogChanged);
+    connect(m_catalogCache, &CatalogCache::catalogReset, this, [this]() {
+        if (m_dbManager) setupPosTab();
+    });
+
+    // Built once; logins only change which items are visible
+    setupNavigation();
+
+    // Sales are committed in the background so the cashier can start the next basket
+    m_checkoutPipeline = new CheckoutPipeline("store.db", QString("sales-lane%1.journal").arg(m_laneId), storeServer, this);
+    connect(m_checkoutPipeline, &CheckoutPipeline::saleCommitted, this, &MainWindow::onSaleCommitted);
+    connect(m_checkoutPipeline, &CheckoutPipeline::saleFailed, this, &MainWindow::onSaleFailed);
+    connect(m_checkoutPipeline, &CheckoutPipeline::saleApplied, this, &MainWindow::onSaleApplied);
+    connect(m_checkoutPipeline, &CheckoutPipeline::salesApplied, this, [this]() {
+        m_saleRefreshTimer->start(); // Refresh once per batch rather than once per sale
+    });
+    connect(m_checkoutPipeline, &CheckoutPipeline::pendingCountChanged, this, &MainWindow::onPendingSalesChanged);
+
+    // Non-modal status area for sales still in flight or needing attention
+    m_pendingSalesLabel = new QLabel(this);
+    m_retryFailedButton = new QPushButton(this);
+    m_retryFailedButton->hide();
+    ui->statusbar->addPermanentWidget(m_pendingSalesLabel);
+    ui->statusbar->addPermanentWidget(m_retryFailedButton);
+    connect(m_retryFailedButton, &QPushButton::clicked, this, &MainWindow::onRetryFailedSalesClicked);
+
+    // Reports and the dashboard read a periodically refreshed copy of store.db. Each lane
+    // has its own, as two refreshers writing one file would wait on each other's locks.
+    const QString replicaPath = QString("store-replica-lane%1.db").arg(m_laneId);
+    m_replica = new AnalyticsReplica("store.db", replicaPath, this);
+    connect(m_replica, &AnalyticsReplica::refreshed, this, &MainWindow::onReplicaRefreshed);
+    m_saleDetailCache = new SaleDetailCache(replicaPath, this);
+    m_replicaLagLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(m_replicaLagLabel);
+    m_replicaLagTimer = new QTimer(this);
+    m_replicaLagTimer->setInterval(1000);
+    connect(m_replicaLagTimer, &QTimer::timeout, this, &MainWindow::updateReplicaLag);
+    m_replicaLagTimer->start();
+
+    // Database upkeep runs only while the till is idle
+    m_maintenance = new MaintenanceScheduler("store.db", this);
+
+    // Promotions are recompiled when one starts or ends (a happy hour, say)
+    m_promotionTimer = new QTimer(this);
+    m_promotionTimer->setSingleShot(true);
+    connect(m_promotionTimer, &QTimer::timeout, this, &MainWindow::compilePromotions);
+
+    m_saleRefreshTimer = new QTimer(this);
+    m_saleRefreshTimer->setSingleShot(true);
+    m_saleRefreshTimer->setInterval(250);
+    connect(m_saleRefreshTimer, &QTimer::timeout, this, &MainWindow::refreshAfterSales);
+
+    // Periodic snapshots of store.db, taken without pausing checkout
+    m_backupService = new BackupService("store.db", "backups", this);
+    connect(m_backupService, &BackupService::backupFinished, this, [this](const QString &snapshotPath) {
+        ui->statusbar->showMessage(tr("Backup saved: %1").arg(QFileInfo(snapshotPath).fileName()), 5000);
+    });
+    connect(m_backupService, &BackupService::backupFailed, this, [this](const QString &reason) {
+        ui->statusbar->showMessage(tr("Backup failed: %1").arg(reason));
+    });
 }
 
 void MainWindow::setDatabaseManager(DatabaseManager *dbManager)
 {
     m_dbManager = dbManager;
 
-    // Now that we have the db manager, we can set up the models
-    // Initialize and configure the QSqlTableModel for products
-    m_productsModel = new QSqlTableModel(this);
-    m_productsModel->setTable("Products");
-    m_productsModel->select(); // Populate the model with data
-
-    // Set user-friendly header names for products
-    m_productsModel->setHeaderData(0, Qt::Horizontal, tr("ID"));
-    m_productsModel->setHeaderData(1, Qt::Horizontal, tr("Name"));
-    m_productsModel->setHeaderData(2, Qt::Horizontal, tr("Description"));
-    m_productsModel->setHeaderData(3, Qt::Horizontal, tr("Price"));
-    m_productsModel->setHeaderData(4, Qt::Horizontal, tr("Quantity"));
-    m_productsModel->setHeaderData(5, Qt::Horizontal, tr("Image Path"));
-
-    // Link the product model to the QTableView
-    ui->productsTableView->setModel(m_productsModel);
-    ui->productsTableView->hideColumn(0); // Hide ID
-    ui->productsTableView->hideColumn(5); // Hide Image Path
-    
-    // Initialize and configure the QSqlTableModel for sales (reports tab)
-    m_salesModel = new QSqlTableModel(this, m_dbManager->getDatabase()); 
-    m_salesModel->setTable("Sales");
-    m_salesModel->select();
-    m_salesModel->setHeaderData(0, Qt::Horizontal, QObject::tr("ID"));
-    m_salesModel->setHeaderData(1, Qt::Horizontal, QObject::tr("Date"));
-    m_salesModel->setHeaderData(2, Qt::Horizontal, QObject::tr("Total Amount"));
-
-    ui->salesTableView->setModel(m_salesModel);
-    ui->salesTableView->hideColumn(0); // Hide ID
-    ui->salesTableView->resizeColumnsToContents();
-
-    // Initialize and configure the QSqlTableModel for users (user management tab)
-    m_usersModel = new QSqlTableModel(this, m_dbManager->getDatabase());
-    m_usersModel->setTable("Users");
-    m_usersModel->select();
-    m_usersModel->setHeaderData(0, Qt::Horizontal, QObject::tr("ID"));
-    m_usersModel->setHeaderData(1, Qt::Horizontal, QObject::tr("Username"));
-    m_usersModel->setHeaderData(2, Qt::Horizontal, QObject::tr("Password Hash")); // Will be hidden
-    m_usersModel->setHeaderData(3, Qt::Horizontal, QObject::tr("Role"));
-
-    ui->usersTableView->setModel(m_usersModel);
-    ui->usersTableView->hideColumn(0); // Hide ID
-    ui->usersTableView->hideColumn(2); // Hide password hash
-    ui->usersTableView->resizeColumnsToContents();
+    // The inventory, reports and user models are created by their pages on
+    // first use (see ensureProductsModel() and friends), so a role that never
+    // sees a page never loads its table.
 
     // Initialize the cart model
-    m_cartModel = new QStandardItemModel(0, 3, this);
-    m_cartModel->setHorizontalHeaderLabels({"Product", "Quantity", "Subtotal"});
+    m_cartModel = new QStandardItemModel(0, 4, this);
+    m_cartModel->setHorizontalHeaderLabels({"Product", "Quantity", "Discount", "Subtotal"});
     ui->cartTableView->setModel(m_cartModel);
     ui->cartTableView->setAlternatingRowColors(true);
     ui->cartTableView->setShowGrid(false);
@@ -95,6 +143,9 @@ void MainWindow::setDatabaseManager(DatabaseManager *dbManager)
 
     // Call setupPosTab to populate m_posProductsModel
     setupPosTab();
+    loadPromotions();
+    m_productNeighbours = m_dbManager->getProductNeighbours();
+    restoreCart(); // Needs the catalog and stock ledger from setupPosTab
 
     m_proxyModel->setSourceModel(m_posProductsModel);
     ui->posProductListView->setModel(m_proxyModel);
@@ -116,26 +167,137 @@ void MainWindow::setDatabaseManager(DatabaseManager *dbManager)
     
     // Connect signals and slots
     connect(ui->posProductListView, &QListView::clicked, this, &MainWindow::onProductListViewClicked);
+    // The list is rebuilt by the click it handles, so the product is added afterwards
+    connect(ui->suggestionsListWidget, &QListWidget::itemClicked, this, [this](QListWidgetItem *item) {
+        const int productId = item->data(Qt::UserRole).toInt();
+        QTimer::singleShot(0, this, [this, productId]() { addProductToCart(productId); });
+    });
     connect(ui->completeSaleButton, &QPushButton::clicked, this, &MainWindow::onCompleteSaleClicked);
     connect(ui->cancelSaleButton, &QPushButton::clicked, this, &MainWindow::onCancelSaleClicked);
     connect(ui->navigationListWidget, &QListWidget::currentRowChanged, this, &MainWindow::on_navigationListWidget_currentRowChanged);
 }
 
+void MainWindow::ensureProductsModel()
+{
+    if (m_productsModel) return;
+
+    // Initialize and configure the QSqlTableModel for products
+    m_productsModel = new QSqlTableModel(this);
+    m_productsModel->setTable("Products");
+    m_productsModel->select(); // Populate the model with data
+
+    // Set user-friendly header names for products
+    m_productsModel->setHeaderData(0, Qt::Horizontal, tr("ID"));
+    m_productsModel->setHeaderData(1, Qt::Horizontal, tr("Name"));
+    m_productsModel->setHeaderData(2, Qt::Horizontal, tr("Description"));
+    m_productsModel->setHeaderData(3, Qt::Horizontal, tr("Price"));
+    m_productsModel->setHeaderData(4, Qt::Horizontal, tr("Quantity"));
+    m_productsModel->setHeaderData(5, Qt::Horizontal, tr("Image Path"));
+
+    // Link the product model to the QTableView
+    ui->productsTableView->setModel(m_productsModel);
+    ui->productsTableView->hideColumn(0); // Hide ID
+    ui->productsTableView->hideColumn(5); // Hide Image Path
+}
+
+void MainWindow::ensureSalesModel()
+{
+    if (m_salesModel) return;
+
+    // Initialize and configure the QSqlTableModel for sales (reports tab). The replica's
+    // SalesHistory view lists archived months ahead of the live Sales table.
+    m_salesModel = new QSqlTableModel(this, m_replica->database()->getDatabase());
+    setSalesModelTable();
+    m_salesModel->select();
+
+    ui->salesTableView->setModel(m_salesModel);
+    ui->salesTableView->hideColumn(0); // Hide ID
+    ui->salesTableView->resizeColumnsToContents();
+
+    // Details of the rows around the current one are loaded before they are opened
+    connect(ui->salesTableView->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+            [this](const QModelIndex &current) {
+        if (current.isValid()) prefetchSaleDetails(current.row());
+    });
+    prefetchSaleDetails(0);
+
+    // Build the dialog while the page is idle so the first double-click only fills it
+    QTimer::singleShot(0, this, [this]() {
+        saleDetailDialog()->ensurePolished();
+    });
+}
+
+void MainWindow::setSalesModelTable()
+{
+    m_salesModel->setTable("SalesHistory");
+    m_salesModel->setHeaderData(0, Qt::Horizontal, QObject::tr("ID"));
+    m_salesModel->setHeaderData(1, Qt::Horizontal, QObject::tr("Date"));
+    m_salesModel->setHeaderData(2, Qt::Horizontal, QObject::tr("Total Amount"));
+}
+
+void MainWindow::prefetchSaleDetails(int row)
+{
+    QList<int> saleIds;
+    const int first = qMax(0, row - SaleDetailPrefetchRows);
+    const int last = qMin(m_salesModel->rowCount() - 1, row + SaleDetailPrefetchRows);
+    for (int r = first; r <= last; ++r) {
+        saleIds.append(m_salesModel->data(m_salesModel->index(r, 0)).toInt());
+    }
+    m_saleDetailCache->prefetch(saleIds);
+}
+
+SaleDetailDialog *MainWindow::saleDetailDialog()
+{
+    for (SaleDetailDialog *dialog : std::as_const(m_saleDetailDialogs)) {
+        if (!dialog->isVisible()) return dialog;
+    }
+    auto *dialog = new SaleDetailDialog(this);
+    m_saleDetailDialogs.append(dialog);
+    return dialog;
+}
+
+void MainWindow::ensureUsersModel()
+{
+    if (m_usersModel) return;
+
+    // Initialize and configure the QSqlTableModel for users (user management tab)
+    m_usersModel = new QSqlTableModel(this, m_dbManager->getDatabase());
+    m_usersModel->setTable("Users");
+    m_usersModel->select();
+    m_usersModel->setHeaderData(0, Qt::Horizontal, QObject::tr("ID"));
+    m_usersModel->setHeaderData(1, Qt::Horizontal, QObject::tr("Username"));
+    m_usersModel->setHeaderData(2, Qt::Horizontal, QObject::tr("Password Hash")); // Will be hidden
+    m_usersModel->setHeaderData(3, Qt::Horizontal, QObject::tr("Role"));
+
+    ui->usersTableView->setModel(m_usersModel);
+    ui->usersTableView->hideColumn(0); // Hide ID
+    ui->usersTableView->hideColumn(2); // Hide password hash
+    ui->usersTableView->resizeColumnsToContents();
+}
+
 void MainWindow::postLoginSetup(const User &user)
 {
-    // Scale logo to fit the label without distortion
-    QPixmap logoPixmap(":/images/poslogo.png");
-    if (!logoPixmap.isNull()) {
-        ui->logoLabel->setPixmap(logoPixmap.scaled(ui->logoLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    // Scale logo to fit the label without distortion; only redone if the label was resized
+    if (ui->logoLabel->size() != m_logoSize) {
+        QPixmap logoPixmap(":/images/poslogo.png");
+        if (!logoPixmap.isNull()) {
+            ui->logoLabel->setPixmap(logoPixmap.scaled(ui->logoLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+            m_logoSize = ui->logoLabel->size();
+        }
     }
 
     m_currentUser = user;
     ui->greetingLabel->setText(QString("Hello, %1").arg(user.username));
     qDebug() << "User" << m_currentUser.username << "logged in with role" << m_currentUser.role;
 
-    // Apply permissions and setup tabs now that the user is logged in
+    // Apply permissions now that the user is logged in. Models, icons and the POS
+    // grid stay warm across logins; the grid is only rebuilt if products changed.
     applyPermissions();
-    setupPosTab();
+    if (m_catalogDirty) {
+        setupPosTab();
+    }
+    loadPromotions(); // Picks up promotions added since the last login
+    m_productNeighbours = m_dbManager->getProductNeighbours(); // Mined while the till was idle
     updateStatsBar();
 }
 
@@ -158,7 +320,7 @@ void MainWindow::on_addProductButton_clicked()
         ProductData data = dialog.getProductData();
         if (m_dbManager->addProduct(data)) {
             m_productsModel->select(); // Refresh the model
-            setupPosTab(); // Refresh the POS tab
+            refreshCatalog(); // The POS grid follows through the catalog cache
             updateStatsBar();
         } else {
             QMessageBox::warning(this, "Error", "Failed to add product to the database.");
@@ -189,7 +351,7 @@ void MainWindow::on_editProductButton_clicked()
         ProductData data = dialog.getProductData();
         if (m_dbManager->updateProduct(id, data)) {
             m_productsModel->select(); // Refresh the model
-            setupPosTab(); // Refresh the POS tab
+            refreshCatalog(); // The POS grid follows through the catalog cache
             updateStatsBar();
         } else {
             QMessageBox::warning(this, "Error", "Failed to update product in the database.");
@@ -215,7 +377,7 @@ void MainWindow::on_deleteProductButton_clicked()
     if (reply == QMessageBox::Yes) {
         if (m_dbManager->deleteProduct(id)) {
             m_productsModel->select(); // Refresh the model
-            setupPosTab(); // Refresh the POS tab
+            refreshCatalog(); // The POS grid follows through the catalog cache
             updateStatsBar();
         } else {
             QMessageBox::warning(this, "Error", "Failed to delete product from the database.");
@@ -223,6 +385,29 @@ void MainWindow::on_deleteProductButton_clicked()
     }
 }
 
+void MainWindow::on_stockTakeButton_clicked()
+{
+    StockTakeDialog dialog(m_dbManager, m_catalogCache->products(), this);
+    if (dialog.exec() == QDialog::Accepted) {
+        // One refresh for the whole batch, however many products it touched
+        m_productsModel->select();
+        refreshCatalog(); // The POS grid follows through the catalog cache
+        updateStatsBar();
+        ui->statusbar->showMessage(tr("Stock updated for %1 product(s)").arg(dialog.changedProducts()), 5000);
+    }
+}
+
+void MainWindow::on_bulkPriceButton_clicked()
+{
+    BulkPriceDialog dialog(m_dbManager, m_catalogCache->products(), this);
+    if (dialog.exec() == QDialog::Accepted) {
+        m_productsModel->select();
+        refreshCatalog(); // Arrives as one change set, applied to the grid in one pass
+        updateStatsBar();
+        ui->statusbar->showMessage(tr("Prices updated for %1 product(s)").arg(dialog.changedProducts()), 5000);
+    }
+}
+
 void MainWindow::on_searchLineEdit_textChanged(const QString &text)
 {
     if (m_proxyModel) {
@@ -236,11 +421,19 @@ void MainWindow::setupPosTab()
     if (!m_posProductsModel) {
         m_posProductsModel = new QStandardItemModel(this);
     }
+    m_catalogDirty = false;
     m_posProductsModel->clear();
+    m_posItems.clear();
+    m_catalog.clear();
     ui->posProductListView->setModel(m_posProductsModel);
 
-    QList<Product> products = m_dbManager->getAllProducts();
+    QList<Product> products = m_catalogCache->products();
+    // Items already in carts stay reserved. New products need a counter even while sales
+    // are held; the re-seed once those drain corrects anything this snapshot counts twice.
+    m_stockLedger.seed(stockOnHand(products));
+    m_seedDeferred = !m_heldSales.isEmpty();
     for (const auto& product : std::as_const(products)) {
+        m_catalog.insert(product.id, product);
         if (product.quantity > 0) { // Only show items that are in stock
             // Format text with a newline for better layout in grid view
             QString itemText = QString("%1\n$%2").arg(product.name).arg(product.price, 0, 'f', 2);
@@ -251,7 +444,7 @@ void MainWindow::setupPosTab()
 
             // Load and set the icon
             if (!product.imagePath.isEmpty()) {
-                QPixmap pixmap(product.imagePath);
+                QPixmap pixmap(ImageStore::variantPath(product.imagePath, ImageStore::Tile));
                 if (!pixmap.isNull()) {
                     item->setIcon(QIcon(pixmap));
                 } else {
@@ -260,16 +453,107 @@ void MainWindow::setupPosTab()
                 }
             }
             m_posProductsModel->appendRow(item);
+            m_posItems.insert(product.id, item);
+            updatePosItemStock(product.id);
         }
     }
 }
 
+void MainWindow::refreshCatalog()
+{
+    // Without a shared segment the cache reports no changes, so the grid reloads instead
+    if (m_catalogCache->isShared()) {
+        m_catalogCache->refresh();
+    } else if (m_dbManager) {
+        setupPosTab();
+    }
+}
+
+void MainWindow::updatePosItemStock(int productId)
+{
+    // Grey out items whose remaining stock is already in carts or in-flight sales
+    QStandardItem *item = m_posItems.value(productId);
+    if (item) {
+        item->setEnabled(m_stockLedger.available(productId) > 0);
+    }
+}
+
+void MainWindow::seedStockLedger(const QList<Product> &products)
+{
+    // A snapshot read while this lane has sales in flight may already count some of
+    // them, and their saleApplied would take the stock off a second time. Seed once
+    // they have drained; refreshAfterSales runs again when the last one is settled.
+    if (!m_heldSales.isEmpty()) {
+        m_seedDeferred = true;
+        return;
+    }
+    m_seedDeferred = false;
+    m_stockLedger.seed(stockOnHand(products));
+}
+
+QList<Product> MainWindow::stockOnHand(const QList<Product> &products)
+{
+    // A till connected to a store server never sees other tills' sales in its own
+    // store.db, so its on-hand counts come from the server when it answers
+    QList<Product> serverProducts;
+    if (m_checkoutPipeline->hasServer() && m_checkoutPipeline->serverProducts(&serverProducts)) {
+        return serverProducts;
+    }
+    return products;
+}
+
+bool MainWindow::reserveStock(int productId, int quantity)
+{
+    // With a store server the hold is granted by its ledger, shared by every till;
+    // the local ledger only mirrors it for greying out the grid
+    if (m_checkoutPipeline->hasServer()) {
+        if (!m_checkoutPipeline->reserveStock(productId, quantity)) {
+            return false;
+        }
+        m_stockLedger.hold(productId, quantity);
+        return true;
+    }
+    return m_stockLedger.reserve(productId, quantity);
+}
+
+void MainWindow::releaseStock(int productId, int quantity)
+{
+    m_stockLedger.release(productId, quantity);
+    if (m_checkoutPipeline->hasServer()) {
+        m_checkoutPipeline->releaseStock(productId, quantity);
+    }
+}
+
+void MainWindow::releaseHeldSale(const QString &uuid)
+{
+    const QMap<int, CartItem> cart = m_heldSales.take(uuid);
+    for (auto it = cart.constBegin(); it != cart.constEnd(); ++it) {
+        releaseStock(it.key(), it.value().quantity);
+        updatePosItemStock(it.key());
+    }
+}
+
 void MainWindow::onProductListViewClicked(const QModelIndex &index)
 {
-    int productId = index.data(Qt::UserRole).toInt();
+    addProductToCart(index.data(Qt::UserRole).toInt());
+}
+
+void MainWindow::addProductToCart(int productId)
+{
+    m_maintenance->noteActivity(); // A sale is starting; maintenance backs off
 
-    // Get product details from the database to ensure they are current
-    Product p = m_dbManager->getProductById(productId);
+    // Product details come from the catalog loaded in setupPosTab, not a per-click query
+    auto catalogIt = m_catalog.constFind(productId);
+    if (catalogIt == m_catalog.constEnd()) {
+        return;
+    }
+    const Product &p = catalogIt.value();
+
+    if (!reserveStock(productId, 1)) {
+        ui->statusbar->showMessage(QString("%1 is out of stock").arg(p.name), 3000);
+        updatePosItemStock(productId);
+        return;
+    }
     
     if (m_cart.contains(productId)) {
         // If item is already in cart, just increase quantity
@@ -278,7 +562,28 @@ void MainWindow::onProductListViewClicked(const QModelIndex &index)
         // Otherwise, add new item to cart
         m_cart[productId] = { p.name, p.price, 1 };
     }
+    m_cartJournal.setQuantity(productId, m_cart[productId].quantity);
+    m_promotions.setLine(productId, m_cart[productId].price, m_cart[productId].quantity);
     
+    updatePosItemStock(productId);
+    updateCartView();
+}
+
+void MainWindow::loadPromotions()
+{
+    m_promotions.setPromotions(m_dbManager->getPromotions());
+    compilePromotions();
+}
+
+void MainWindow::compilePromotions()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    m_promotions.compile(now);
+
+    // Wake up when the active set next changes; at least hourly in case the clock moves
+    const QDateTime next = m_promotions.nextChange(now);
+    const qint64 hour = 60 * 60 * 1000;
+    m_promotionTimer->start(int(next.isValid() ? qBound<qint64>(0, now.msecsTo(next) + 1, hour) : hour));
     updateCartView();
 }
 
@@ -289,15 +594,53 @@ void MainWindow::updateCartView()
     double total = 0.0;
     for (auto it = m_cart.constBegin(); it != m_cart.constEnd(); ++it) {
         const CartItem& item = it.value();
+        // Discounts were worked out as the lines changed; this only reads them
+        const double discount = m_promotions.discount(it.key());
         QList<QStandardItem*> rowItems;
         rowItems << new QStandardItem(item.name);
         rowItems << new QStandardItem(QString::number(item.quantity));
-        rowItems << new QStandardItem(QString::number(item.price * item.quantity, 'f', 2));
+        rowItems << new QStandardItem(discount > 0.0 ? QString("-%1").arg(discount, 0, 'f', 2) : QString());
+        rowItems << new QStandardItem(QString::number(item.price * item.quantity - discount, 'f', 2));
+        rowItems[2]->setToolTip(m_promotions.promotionName(it.key()));
         m_cartModel->appendRow(rowItems);
         total += item.price * item.quantity;
     }
+    total -= m_promotions.totalDiscount();
     
     ui->totalAmountLabel->setText(QString("Total: $%1").arg(total, 0, 'f', 2));
+    updateSuggestions();
+}
+
+void MainWindow::updateSuggestions()
+{
+    // Each line's neighbours come from an in-memory table, weighted by how often they
+    // were bought together; the cost depends on the cart, not on the sales history
+    QHash<int, int> scores;
+    for (auto it = m_cart.constBegin(); it != m_cart.constEnd(); ++it) {
+        auto neighbours = m_productNeighbours.constFind(it.key());
+        if (neighbours == m_productNeighbours.constEnd()) continue;
+        for (const ProductNeighbour &neighbour : neighbours.value()) {
+            if (!m_cart.contains(neighbour.productId) && m_catalog.contains(neighbour.productId)
+                && m_stockLedger.available(neighbour.productId) > 0) {
+                scores[neighbour.productId] += neighbour.count;
+            }
+        }
+    }
+    QList<QPair<int, int>> ranked; // Score, product id
+    for (auto it = scores.constBegin(); it != scores.constEnd(); ++it) {
+        ranked.append({ it.value(), it.key() });
+    }
+    std::sort(ranked.begin(), ranked.end(), std::greater<QPair<int, int>>());
+
+    ui->suggestionsListWidget->clear();
+    for (int i = 0; i < qMin(int(ranked.size()), MaxSuggestions); ++i) {
+        const Product &product = m_catalog[ranked.at(i).second];
+        auto *item = new QListWidgetItem(QString("%1 ($%2)").arg(product.name).arg(product.price, 0, 'f', 2));
+        item->setData(Qt::UserRole, product.id);
+        ui->suggestionsListWidget->addItem(item);
+    }
+    ui->suggestionsLabel->setVisible(!ranked.isEmpty());
+    ui->suggestionsListWidget->setVisible(!ranked.isEmpty());
 }
 
 void MainWindow::onCompleteSaleClicked()
@@ -307,38 +650,257 @@ void MainWindow::onCompleteSaleClicked()
         return;
     }
 
+    // Lines are recorded at their list price with the promotion discount rounded to
+    // the cent, so the items of a sale add up to its total in every report
+    QMap<int, CartItem> cart = m_cart;
     double total = 0.0;
-    for(const auto& item : std::as_const(m_cart)) total += item.price * item.quantity;
+    for (auto it = cart.begin(); it != cart.end(); ++it) {
+        it->discount = std::round(m_promotions.discount(it.key()) * 100.0) / 100.0;
+        total += it->price * it->quantity - it->discount;
+    }
 
-    bool success = m_dbManager->processSale(m_cart, total, m_currentUser.id);
+    // Hand the captured basket to the pipeline and free the lane immediately
+    QString uuid = m_checkoutPipeline->submit(cart, total, m_currentUser.id);
+    m_heldSales.insert(uuid, cart);
+    ui->statusbar->showMessage(QString("Sale %1 submitted ($%2)").arg(uuid.left(8)).arg(total, 0, 'f', 2), 3000);
+    clearCart(); // The stock stays held until the sale reaches the database
+}
 
-    if (success) {
-        QMessageBox::information(this, "Success", "Sale completed successfully!");
-        onCancelSaleClicked(); // Clear the cart
+void MainWindow::onSaleCommitted(const QString &uuid)
+{
+    ui->statusbar->showMessage(QString("Sale %1 completed").arg(uuid.left(8)), 3000);
+}
+
+void MainWindow::onSaleFailed(const PendingSale &sale)
+{
+    // Keep the basket so it can be retried with the same ID, but give its stock back;
+    // a retry takes it again
+    releaseHeldSale(sale.uuid);
+    if (m_seedDeferred && m_heldSales.isEmpty()) {
+        m_saleRefreshTimer->start();
+    }
+    m_failedSales.append(sale);
+    m_retryFailedButton->setText(QString("Retry failed sales (%1)").arg(m_failedSales.size()));
+    m_retryFailedButton->show();
+    ui->statusbar->showMessage(QString("Sale %1 could not be saved. Check database connection.").arg(sale.uuid.left(8)));
+}
+
+void MainWindow::onSaleApplied(const PendingSale &sale)
+{
+    m_dashboardPage->addSale(sale.uuid, sale.soldAt.isValid() ? sale.soldAt : QDateTime::currentDateTimeUtc(),
+                             sale.totalAmount);
+
+    // Products now reflects this sale, so its hold turns into an on-hand decrement.
+    // Sales replayed from the journal, or retried without stock, never took a hold;
+    // the next seed picks them up from the database instead.
+    if (m_heldSales.remove(sale.uuid)) {
+        for (auto it = sale.cart.constBegin(); it != sale.cart.constEnd(); ++it) {
+            m_stockLedger.applied(it.key(), it.value().quantity);
+        }
+    }
+    if (m_seedDeferred && m_heldSales.isEmpty()) {
+        m_saleRefreshTimer->start();
+    }
+}
+
+void MainWindow::onPendingSalesChanged(int count)
+{
+    m_pendingSalesLabel->setText(count > 0 ? QString("Saving %1 sale(s)...").arg(count) : QString());
+}
+
+void MainWindow::onRetryFailedSalesClicked()
+{
+    const QList<PendingSale> failedSales = m_failedSales;
+    m_failedSales.clear();
+    m_retryFailedButton->hide();
+    for (const auto &sale : failedSales) {
+        // Hold the stock again if it is all still there; if not, the database decides
+        QList<int> reserved;
+        for (auto it = sale.cart.constBegin(); it != sale.cart.constEnd(); ++it) {
+            if (!reserveStock(it.key(), it.value().quantity)) {
+                break;
+            }
+            reserved.append(it.key());
+        }
+        if (reserved.size() == sale.cart.size()) {
+            m_heldSales.insert(sale.uuid, sale.cart);
+        } else {
+            for (int productId : std::as_const(reserved)) {
+                releaseStock(productId, sale.cart.value(productId).quantity);
+            }
+        }
+        for (auto it = sale.cart.constBegin(); it != sale.cart.constEnd(); ++it) {
+            updatePosItemStock(it.key());
+        }
+        m_checkoutPipeline->resubmit(sale);
+    }
+}
+
+void MainWindow::refreshAfterSales()
+{
+    if (!m_dbManager) return; // Journal replay can finish before the models exist
+
+    if (m_productsModel) {
         m_productsModel->select(); // Refresh inventory view
-        m_salesModel->select();    // Refresh sales view
-        setupPosTab(); // Refresh POS product list (to update quantities)
-        updateStatsBar();
-    } else {
-        QMessageBox::critical(this, "Error", "Failed to process the sale. Check database connection.");
+    }
+    // This batch's holds are applied now, so on-hand stock can come from the catalog again
+    refreshCatalog();
+    seedStockLedger(m_catalog.values());
+    for (auto it = m_posItems.cbegin(); it != m_posItems.cend(); ++it) {
+        updatePosItemStock(it.key());
+    }
+    m_replica->requestRefresh(); // Sales view and totals follow once the replica catches up
+}
+
+void MainWindow::onReplicaRefreshed(const QDateTime &asOf, bool changed)
+{
+    Q_UNUSED(asOf);
+    updateReplicaLag();
+    if (!changed || !m_dbManager) return;
+
+    if (m_salesModel) {
+        if (m_salesModel->record().isEmpty()) {
+            setSalesModelTable(); // Opened before the first refresh created the view
+        }
+        m_salesModel->select();
+    }
+    updateStatsBar();
+    if (ui->contentStackedWidget->currentWidget() == m_dashboardPage) {
+        m_dashboardPage->refreshData(m_replica->database());
+    }
+}
+
+void MainWindow::updateReplicaLag()
+{
+    const qint64 lagMs = m_replica->lagMs();
+    if (lagMs < 0) {
+        m_replicaLagLabel->setText(tr("Reports: not loaded"));
+        return;
+    }
+    // Refreshes normally land every few seconds; only call out a replica that is behind
+    const qint64 lagSeconds = lagMs / 1000;
+    m_replicaLagLabel->setText(lagSeconds < 30 ? tr("Reports up to date")
+                                               : tr("Reports %1 s behind").arg(lagSeconds));
+    m_replicaLagLabel->setToolTip(tr("Reports as of %1").arg(m_replica->asOf().toString("HH:mm:ss")));
+}
+
+void MainWindow::onCatalogChanged(const QList<Product> &changed, const QList<int> &removed)
+{
+    if (!m_dbManager) return;
+
+    // Price, name and stock changes are applied to the grid in place; anything that
+    // adds or removes a tile (or changes its picture) rebuilds it from the cache
+    bool rebuild = !removed.isEmpty();
+    bool detailsStale = !removed.isEmpty();
+    // Items change silently and the view hears about them once, so a bulk repricing
+    // costs one proxy update and one repaint rather than one per tile
+    QSignalBlocker blocker(m_posProductsModel);
+    for (const Product &product : changed) {
+        const Product old = m_catalog.value(product.id);
+        const QString oldImagePath = old.imagePath;
+        detailsStale = detailsStale || product.name != old.name || product.imagePath != oldImagePath;
+        m_catalog.insert(product.id, product);
+        QStandardItem *item = m_posItems.value(product.id);
+        if (!item) {
+            rebuild = rebuild || product.quantity > 0;
+            continue;
+        }
+        if (product.imagePath != oldImagePath) {
+            rebuild = true;
+            continue;
+        }
+        item->setText(QString("%1\n$%2").arg(product.name).arg(product.price, 0, 'f', 2));
+    }
+    if (detailsStale) {
+        m_saleDetailCache->clear(); // Sale details show current product names and pictures
+    }
+    if (rebuild) {
+        blocker.unblock();
+        setupPosTab();
+        return;
+    }
+
+    seedStockLedger(m_catalog.values());
+    for (const Product &product : changed) {
+        updatePosItemStock(product.id);
+    }
+    blocker.unblock();
+    if (!changed.isEmpty() && m_posProductsModel->rowCount() > 0) {
+        emit m_posProductsModel->dataChanged(m_posProductsModel->index(0, 0),
+                                             m_posProductsModel->index(m_posProductsModel->rowCount() - 1, 0));
     }
 }
 
 void MainWindow::onCancelSaleClicked()
 {
+    // Give the reserved stock back before dropping the basket
+    for (auto it = m_cart.constBegin(); it != m_cart.constEnd(); ++it) {
+        releaseStock(it.key(), it.value().quantity);
+        updatePosItemStock(it.key());
+    }
+    clearCart();
+}
+
+void MainWindow::clearCart()
+{
+    m_maintenance->noteActivity();
     m_cart.clear();
+    m_cartJournal.clear();
+    m_promotions.clearCart();
     updateCartView(); // This will clear the table and reset the total
 }
 
+void MainWindow::restoreCart()
+{
+    // Bring back the basket that was being scanned when the application last stopped
+    const QMap<int, int> lines = m_cartJournal.open(QString("cart-lane%1.ring").arg(m_laneId));
+    for (auto it = lines.constBegin(); it != lines.constEnd(); ++it) {
+        auto catalogIt = m_catalog.constFind(it.key());
+        if (catalogIt == m_catalog.constEnd()) {
+            m_cartJournal.setQuantity(it.key(), 0); // Product no longer exists
+            continue;
+        }
+
+        // Take back as much as is still available. The local count may be stale when a
+        // store server holds the stock, so each refusal also asks for at least one less.
+        int quantity = qMin(it.value(), m_stockLedger.available(it.key()));
+        while (quantity > 0 && !reserveStock(it.key(), quantity)) {
+            quantity = qMin(m_stockLedger.available(it.key()), quantity - 1);
+        }
+        if (quantity != it.value()) {
+            m_cartJournal.setQuantity(it.key(), quantity);
+        }
+        if (quantity > 0) {
+            m_cart[it.key()] = { catalogIt->name, catalogIt->price, quantity };
+            m_promotions.setLine(it.key(), catalogIt->price, quantity);
+            updatePosItemStock(it.key());
+        }
+    }
+
+    if (!m_cart.isEmpty()) {
+        updateCartView();
+        ui->statusbar->showMessage(QString("Restored unfinished sale with %1 item(s)").arg(m_cart.size()), 5000);
+    }
+}
+
 void MainWindow::on_salesTableView_doubleClicked(const QModelIndex &index)
 {
     if (!index.isValid())
         return;
 
     int saleId = m_salesModel->data(m_salesModel->index(index.row(), 0)).toInt(); // Column 0 is ID
-    
-    SaleDetailDialog dialog(this);
-    dialog.setSaleId(saleId, m_dbManager);
+
+    SaleDetailDialog *dialog = saleDetailDialog();
+    dialog->setSaleDetails(saleId, m_saleDetailCache->details(saleId, m_replica->database()));
+    dialog->exec();
+}
+
+void MainWindow::on_zReportButton_clicked()
+{
+    // A day is only closed once none of this till's sales are still on their way
+    ZReportDialog dialog(m_dbManager, [this]() {
+        return m_checkoutPipeline->unappliedCount() + int(m_failedSales.size());
+    }, this);
     dialog.exec();
 }
 
@@ -430,9 +992,19 @@ void MainWindow::on_deleteUserButton_clicked()
 
 void MainWindow::applyPermissions()
 {
-    // This function now just triggers the navigation setup,
-    // which internally handles the role-based logic.
-    setupNavigation();
+    // The navigation items are built once; a login only shows or hides the
+    // admin pages, whose models are never created for other roles.
+    const bool isAdmin = (m_currentUser.role == "Admin");
+    for (QListWidgetItem *item : std::as_const(m_adminNavItems)) {
+        item->setHidden(!isAdmin);
+    }
+
+    // Start on the Dashboard; refresh it explicitly if it was already selected
+    if (ui->navigationListWidget->currentRow() == 0) {
+        on_navigationListWidget_currentRowChanged(0);
+    } else {
+        ui->navigationListWidget->setCurrentRow(0);
+    }
 }
 
 void MainWindow::setupNavigation()
@@ -453,8 +1025,8 @@ void MainWindow::setupNavigation()
     QListWidgetItem *posItem = new QListWidgetItem(posIcon, "Point of Sale");
     ui->navigationListWidget->addItem(posItem);
 
-    // Add Admin-only items (Indices 2, 3, 4)
-    if (m_currentUser.role == "Admin") {
+    // Add Admin-only items (Indices 2, 3, 4), hidden by applyPermissions() for other roles
+    {
         // Inventory Icon (Index 2)
         QPixmap docPixmap(":/images/document.png");
         QIcon docIcon(docPixmap.scaled(iconSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
@@ -472,11 +1044,11 @@ void MainWindow::setupNavigation()
         QIcon profilIcon(profilPixmap.scaled(iconSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
         QListWidgetItem *usersItem = new QListWidgetItem(profilIcon, "User Management");
         ui->navigationListWidget->addItem(usersItem);
-    }
-    
-    // Set the default selected item to be the first one (Dashboard)
-    if (ui->navigationListWidget->count() > 0) {
-        ui->navigationListWidget->setCurrentRow(0);
+
+        m_adminNavItems = { inventoryItem, reportsItem, usersItem };
+        for (QListWidgetItem *item : std::as_const(m_adminNavItems)) {
+            item->setHidden(true);
+        }
     }
 }
 
@@ -492,16 +1064,22 @@ void MainWindow::on_navigationListWidget_currentRowChanged(int row)
     if (text == "Dashboard") {
         // Refresh dashboard data when dashboard page is selected
         if (m_dashboardPage && m_dbManager) {
-            m_dashboardPage->refreshData(m_dbManager);
+            m_dashboardPage->refreshData(m_replica->database());
         }
         ui->contentStackedWidget->setCurrentWidget(m_dashboardPage);
     } else if (text == "Point of Sale") {
+        if (m_catalogDirty && m_dbManager) {
+            setupPosTab(); // Products were edited since the grid was built
+        }
         ui->contentStackedWidget->setCurrentWidget(ui->posPage);
     } else if (text == "Inventory") {
+        ensureProductsModel();
         ui->contentStackedWidget->setCurrentWidget(ui->inventoryPage);
     } else if (text == "Reports") {
+        ensureSalesModel();
         ui->contentStackedWidget->setCurrentWidget(ui->reportsPage);
     } else if (text == "User Management") {
+        ensureUsersModel();
         ui->contentStackedWidget->setCurrentWidget(ui->usersPage);
     }
 }
@@ -520,7 +1098,7 @@ void MainWindow::updateStatsBar()
 {
     if (!m_dbManager) return;
 
-    double revenue = m_dbManager->getTotalRevenue();
+    double revenue = m_replica->database()->getTotalRevenue();
     double stockValue = m_dbManager->getTotalStockValue();
 
     ui->revenueValueLabel->setText(formatValue(revenue));
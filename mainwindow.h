@@ -11,6 +11,10 @@
 #include "cartitem.h"
 #include "databasemanager.h" // For User struct
 #include "dashboardpage.h" // Include the new DashboardPage header
+#include "pendingsale.h"
+#include "stockledger.h"
+#include "cartjournal.h"
+#include "promotionengine.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -19,14 +23,25 @@ class MainWindow;
 QT_END_NAMESPACE
 
 class DatabaseManager; // Forward declaration
+class CheckoutPipeline;
+class BackupService;
+class AnalyticsReplica;
+class MaintenanceScheduler;
+class CatalogCache;
+class SaleDetailCache;
+class SaleDetailDialog;
 class QStandardItemModel;
+class QLabel;
+class QPushButton;
+class QTimer;
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    // storeServer: address of a StoreServer to send sales to; empty writes store.db directly
+    explicit MainWindow(int laneId = 1, const QString &storeServer = QString(), QWidget *parent = nullptr);
     ~MainWindow();
 
     void setDatabaseManager(DatabaseManager *dbManager);
@@ -39,12 +54,15 @@ private slots:
     void on_addProductButton_clicked();
     void on_editProductButton_clicked();
     void on_deleteProductButton_clicked();
+    void on_stockTakeButton_clicked();
+    void on_bulkPriceButton_clicked();
     void onProductListViewClicked(const QModelIndex &index);
     void updateCartView();
     void onCompleteSaleClicked();
     void onCancelSaleClicked();
     void on_searchLineEdit_textChanged(const QString &text);
     void on_salesTableView_doubleClicked(const QModelIndex &index);
+    void on_zReportButton_clicked();
     void on_logoutButton_clicked();
 
     // User Management Slots
@@ -54,7 +72,21 @@ private slots:
 
     void on_navigationListWidget_currentRowChanged(int row);
 
+    // Checkout pipeline slots
+    void onSaleCommitted(const QString &uuid);
+    void onSaleFailed(const PendingSale &sale);
+    void onSaleApplied(const PendingSale &sale);
+    void onPendingSalesChanged(int count);
+    void onRetryFailedSalesClicked();
+    void refreshAfterSales();
+    void onReplicaRefreshed(const QDateTime &asOf, bool changed);
+    void updateReplicaLag();
+    void onCatalogChanged(const QList<Product> &changed, const QList<int> &removed);
+
 private:
+    static constexpr int SaleDetailPrefetchRows = 5; // Each side of the current Reports row
+    static constexpr int MaxSuggestions = 4; // Add-ons offered under the cart
+
     void setupNavigation();
     void updateStatsBar();
     Ui::MainWindow *ui;
@@ -68,8 +100,53 @@ private:
     QStandardItemModel *m_cartModel;
     User m_currentUser; // Store the currently logged-in user
     DashboardPage *m_dashboardPage;
+    CheckoutPipeline *m_checkoutPipeline;
+    QList<PendingSale> m_failedSales; // Baskets that could not be committed, kept for retry
+    QLabel *m_pendingSalesLabel;
+    QPushButton *m_retryFailedButton;
+    QTimer *m_saleRefreshTimer; // Coalesces view refreshes after a burst of commits
+    StockLedger m_stockLedger; // Sellable stock, reserved as items go into the cart
+    QHash<int, Product> m_catalog; // Products shown on the POS page, by id
+    QHash<int, QStandardItem*> m_posItems; // POS grid items, by product id
+    int m_laneId; // Identifies this till's journal files when several run side by side
+    CartJournal m_cartJournal; // Survives a crash mid-basket
+    PromotionEngine m_promotions; // Prices the cart as lines change
+    QTimer *m_promotionTimer; // Fires when a promotion starts or ends
+    QHash<int, QList<ProductNeighbour>> m_productNeighbours; // Bought-together lists, by product id
+    BackupService *m_backupService;
+    AnalyticsReplica *m_replica; // Read-only copy that reports and the dashboard query
+    QLabel *m_replicaLagLabel;
+    QTimer *m_replicaLagTimer;
+    MaintenanceScheduler *m_maintenance;
+    QList<QListWidgetItem*> m_adminNavItems; // Shown for the Admin role only
+    QSize m_logoSize; // Label size the logo was last scaled for
+    bool m_catalogDirty; // Products changed since the POS grid was built
+    CatalogCache *m_catalogCache; // Catalog shared with the other lanes on this host
+    QHash<QString, QMap<int, CartItem>> m_heldSales; // Sales whose stock this lane still holds, by uuid
+    bool m_seedDeferred; // The ledger skipped a re-seed while sales were held
+    SaleDetailCache *m_saleDetailCache; // Opened sales and their neighbours in the Reports table
+    QList<SaleDetailDialog*> m_saleDetailDialogs; // Built once and reused
 
     void setupPosTab();
+    void refreshCatalog();
+    void ensureProductsModel();
+    void ensureSalesModel();
+    void setSalesModelTable();
+    void prefetchSaleDetails(int row);
+    SaleDetailDialog *saleDetailDialog();
+    void ensureUsersModel();
+    void updatePosItemStock(int productId);
+    void seedStockLedger(const QList<Product> &products);
+    QList<Product> stockOnHand(const QList<Product> &products);
+    bool reserveStock(int productId, int quantity);
+    void releaseStock(int productId, int quantity);
+    void releaseHeldSale(const QString &uuid);
+    void clearCart();
+    void loadPromotions();
+    void compilePromotions();
+    void addProductToCart(int productId);
+    void updateSuggestions();
+    void restoreCart();
     void applyPermissions();
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,22 @@
+#ifndef PENDINGSALE_H
+#define PENDINGSALE_H
+
+#include <QDateTime>
+#include <QMap>
+#include <QMetaType>
+#include <QString>
+#include "cartitem.h"
+
+// A captured basket waiting to be committed by the checkout pipeline
+struct PendingSale {
+    QString uuid; // Client-generated, makes resubmission idempotent
+    QMap<int, CartItem> cart; // Key: product_id, Value: CartItem
+    double totalAmount = 0.0;
+    int userId = 0;
+    QDateTime soldAt; // UTC, when the basket was completed; becomes Sales.sale_date
+    int attempts = 0;
+};
+
+Q_DECLARE_METATYPE(PendingSale)
+
+#endif // PENDINGSALE_H
@@ -0,0 +1,560 @@
+#include "posstyle.h"
+#include <QAbstractItemView>
+#include <QApplication>
+#include <QDialog>
+#include <QEvent>
+#include <QFile>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMainWindow>
+#include <QPainter>
+#include <QPushButton>
+#include <QStyleFactory>
+#include <QStyleOption>
+#include <QTableView>
+
+namespace {
+// Colours from style.qss
+constexpr QRgb Primary = 0xff0d6efd;
+constexpr QRgb Success = 0xff198754;
+constexpr QRgb Danger = 0xffdc3545;
+constexpr QRgb Text = 0xff212529;
+constexpr QRgb MutedText = 0xff495057;
+constexpr QRgb Background = 0xfff8f9fa;
+constexpr QRgb Surface = 0xffffffff;
+constexpr QRgb Subtle = 0xfff1f3f5;
+constexpr QRgb Hover = 0xffe9ecef;
+constexpr QRgb Border = 0xffdee2e6;
+constexpr QRgb InputBorder = 0xffced4da;
+constexpr QRgb FocusBorder = 0xff86b7fe;
+constexpr QRgb TableSelection = 0xffcfe2ff;
+constexpr QRgb DisabledButton = 0xffa0a0a0;
+constexpr QRgb DisabledButtonText = 0xffe0e0e0;
+
+constexpr int ButtonRadius = 5;
+constexpr int InputRadius = 4;
+constexpr int ScrollBarExtent = 10;
+
+constexpr Qt::Edges AllEdges = Qt::TopEdge | Qt::LeftEdge | Qt::RightEdge | Qt::BottomEdge;
+constexpr QRgb CardBorder = 0xffe0e0e0;
+constexpr QRgb CardHoverBorder = 0xffb2bec3;
+
+// Widgets that draw a background (and optionally border edges) behind their content
+struct Panel {
+    const char *objectName;
+    QRgb background;
+    QRgb border;
+    Qt::Edges borderEdges;
+    int radius;
+    int padding;
+    QRgb hoverBorder; // 0 keeps the border under the mouse
+};
+
+const Panel Panels[] = {
+    { "sidebarWidget", Subtle, Border, Qt::RightEdge, 0, 0, 0 },
+    { "statsBarWidget", Surface, Border, Qt::BottomEdge, 0, 0, 0 },
+    { "revenueWidget", Background, 0, {}, 8, 10, 0 },
+    { "stockValueWidget", Background, 0, {}, 8, 10, 0 },
+    { "totalAmountLabel", Subtle, Border, Qt::TopEdge, 5, 15, 0 },
+    // Dashboard cards; the KPI cards keep the border and radius of their .ui stylesheets
+    { "cardTotalProducts", Surface, CardBorder, AllEdges, 5, 12, CardHoverBorder },
+    { "cardTotalItems", Surface, CardBorder, AllEdges, 5, 12, CardHoverBorder },
+    { "cardStockValue", Surface, CardBorder, AllEdges, 5, 12, CardHoverBorder },
+    { "cardTotalRevenue", Surface, CardBorder, AllEdges, 5, 12, CardHoverBorder },
+    { "cardSalesToday", Surface, CardBorder, AllEdges, 5, 12, CardHoverBorder },
+    { "cardSalesMonth", Surface, CardBorder, AllEdges, 5, 12, CardHoverBorder },
+    { "weeklySalesCard", Surface, 0xffdcdde1, AllEdges, 12, 10, 0 },
+};
+
+// Text overrides; 0 keeps the inherited size, weight or colour
+struct TextRole {
+    const char *objectName;
+    int pixelSize;
+    int weight;
+    QRgb color;
+};
+
+const TextRole TextRoles[] = {
+    { "revenueTitleLabel", 12, QFont::Medium, 0xff6c757d },
+    { "stockValueTitleLabel", 12, QFont::Bold, 0xff7f8fa6 }, // Stats bar and dashboard card share the name
+    { "revenueValueLabel", 20, QFont::DemiBold, Text },
+    { "stockValueLabel", 20, QFont::DemiBold, Text },
+    { "totalAmountLabel", 24, QFont::Bold, Text },
+    { "dashboardTitleLabel", 0, 0, 0xff2c3e50 },
+    { "totalProductsTitleLabel", 0, QFont::Bold, 0xff7f8fa6 },
+    { "totalItemsTitleLabel", 0, QFont::Bold, 0xff7f8fa6 },
+    { "totalRevenueTitleLabel", 0, QFont::Bold, 0xff7f8fa6 },
+    { "salesTodayTitleLabel", 0, QFont::Bold, 0xff7f8fa6 },
+    { "salesMonthTitleLabel", 0, QFont::Bold, 0xff7f8fa6 },
+    { "weeklySalesTitle", 0, QFont::Bold, 0xff7f8fa6 },
+    { "totalProductsValueLabel", 0, 0, 0xff2c3e50 },
+    { "totalItemsValueLabel", 0, 0, 0xff2c3e50 },
+    { "salesTodayValueLabel", 0, 0, 0xff2c3e50 },
+    { "salesMonthValueLabel", 0, 0, 0xff2c3e50 },
+    { "totalRevenueValueLabel", 0, 0, 0xff27ae60 },
+    { "stockValueValueLabel", 0, 0, 0xff27ae60 },
+};
+
+// Buttons that are not the primary blue
+const struct {
+    const char *objectName;
+    QRgb color;
+} Accents[] = {
+    { "completeSaleButton", Success },
+    { "addProductButton", Success },
+    { "cancelSaleButton", Danger },
+    { "deleteProductButton", Danger },
+};
+
+// Pages and windows with their own background
+const struct {
+    const char *objectName;
+    QRgb color;
+} Backgrounds[] = {
+    { "posPage", Surface },
+    { "inventoryPage", Surface },
+    { "DashboardPage", 0xfff5f6fa },
+    { "ProductDialog", Background },
+};
+
+template <typename T, size_t N>
+const T *findByName(const T (&table)[N], const QString &name)
+{
+    for (const T &entry : table) {
+        if (name == QLatin1String(entry.objectName)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void fillRounded(QPainter *painter, const QRectF &rect, qreal radius, const QColor &fill, const QColor &border = QColor())
+{
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(border.isValid() ? QPen(border, 1) : Qt::NoPen);
+    painter->setBrush(fill);
+    const QRectF r = border.isValid() ? rect.adjusted(0.5, 0.5, -0.5, -0.5) : rect;
+    if (radius > 0) {
+        painter->drawRoundedRect(r, radius, radius);
+    } else {
+        painter->drawRect(r);
+    }
+    painter->restore();
+}
+}
+
+PosStyle::PosStyle() :
+    QProxyStyle(QStyleFactory::create("Fusion"))
+{
+}
+
+void PosStyle::apply(QApplication &app)
+{
+    app.setStyleSheet(QString());
+    app.setStyle(new PosStyle);
+    QFont font("Poppins");
+    font.setPixelSize(14);
+    app.setFont(font);
+}
+
+void PosStyle::applyStyleSheet(QApplication &app)
+{
+    app.setStyleSheet(styleSheet());
+}
+
+QString PosStyle::styleSheet()
+{
+    QFile styleFile(":/style.qss");
+    if (!styleFile.open(QFile::ReadOnly)) {
+        qWarning("Failed to open stylesheet file.");
+        return QString();
+    }
+    return QLatin1String(styleFile.readAll());
+}
+
+QPalette PosStyle::standardPalette() const
+{
+    QPalette palette = QProxyStyle::standardPalette();
+    const_cast<PosStyle *>(this)->polish(palette);
+    return palette;
+}
+
+void PosStyle::polish(QPalette &palette)
+{
+    QProxyStyle::polish(palette);
+    palette.setColor(QPalette::Window, QColor(Background));
+    palette.setColor(QPalette::WindowText, QColor(Text));
+    palette.setColor(QPalette::Base, QColor(Surface));
+    palette.setColor(QPalette::AlternateBase, QColor(Background));
+    palette.setColor(QPalette::Text, QColor(Text));
+    palette.setColor(QPalette::Button, QColor(Primary));
+    palette.setColor(QPalette::ButtonText, QColor(Qt::white));
+    palette.setColor(QPalette::Highlight, QColor(TableSelection));
+    palette.setColor(QPalette::HighlightedText, QColor(Primary));
+    palette.setColor(QPalette::Disabled, QPalette::Button, QColor(DisabledButton));
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, QColor(DisabledButtonText));
+}
+
+void PosStyle::polish(QWidget *widget)
+{
+    QProxyStyle::polish(widget);
+    const QString name = widget->objectName();
+
+    if (qobject_cast<QPushButton *>(widget) || qobject_cast<QLineEdit *>(widget)) {
+        widget->setAttribute(Qt::WA_Hover);
+    }
+    if (qobject_cast<QMainWindow *>(widget) || qobject_cast<QDialog *>(widget)) {
+        QPalette palette = widget->palette();
+        palette.setColor(QPalette::Window, QColor(Surface));
+        widget->setPalette(palette);
+    }
+    if (const auto *background = findByName(Backgrounds, name)) {
+        QPalette palette = widget->palette();
+        palette.setColor(QPalette::Window, QColor(background->color));
+        widget->setPalette(palette);
+        widget->setAutoFillBackground(true);
+    }
+    if (const auto *accent = findByName(Accents, name)) {
+        QPalette palette = widget->palette();
+        palette.setColor(QPalette::Active, QPalette::Button, QColor(accent->color));
+        palette.setColor(QPalette::Inactive, QPalette::Button, QColor(accent->color));
+        widget->setPalette(palette);
+    }
+    if (const auto *role = findByName(TextRoles, name)) {
+        QFont font = widget->font();
+        if (role->pixelSize) font.setPixelSize(role->pixelSize);
+        if (role->weight) font.setWeight(QFont::Weight(role->weight));
+        widget->setFont(font);
+        QPalette palette = widget->palette();
+        palette.setColor(QPalette::WindowText, QColor(role->color));
+        widget->setPalette(palette);
+    }
+    if (const auto *panel = findByName(Panels, name)) {
+        m_panels.insert(widget, int(panel - Panels));
+        if (panel->hoverBorder) {
+            widget->setAttribute(Qt::WA_Hover);
+        }
+        widget->setContentsMargins(panel->padding, panel->padding, panel->padding, panel->padding);
+        widget->installEventFilter(this);
+    }
+
+    if (auto *view = qobject_cast<QAbstractItemView *>(widget)) {
+        ViewRole role = TableView;
+        QPalette palette = view->palette();
+        palette.setColor(QPalette::Text, QColor(MutedText));
+        if (name == QLatin1String("navigationListWidget")) {
+            role = NavigationView;
+            palette.setColor(QPalette::Base, Qt::transparent);
+            palette.setColor(QPalette::Highlight, QColor(Primary));
+            palette.setColor(QPalette::HighlightedText, QColor(Qt::white));
+            QFont font = view->font();
+            font.setWeight(QFont::Medium);
+            view->setFont(font);
+            view->setFrameShape(QFrame::NoFrame);
+        } else if (name == QLatin1String("posProductListView")) {
+            role = ProductGridView;
+        }
+        view->setPalette(palette);
+        view->viewport()->setAttribute(Qt::WA_Hover);
+        if (auto *table = qobject_cast<QTableView *>(view)) {
+            table->setShowGrid(false);
+        }
+        if (!m_viewRoles.contains(view)) {
+            connect(view, &QObject::destroyed, this, [this](QObject *object) { m_viewRoles.remove(object); });
+        }
+        m_viewRoles.insert(view, role);
+    }
+}
+
+void PosStyle::unpolish(QWidget *widget)
+{
+    if (m_panels.remove(widget)) {
+        widget->removeEventFilter(this);
+    }
+    m_viewRoles.remove(widget);
+    QProxyStyle::unpolish(widget);
+}
+
+bool PosStyle::eventFilter(QObject *watched, QEvent *event)
+{
+    // Panel backgrounds go down before the widget paints its own content
+    if (event->type() == QEvent::HoverEnter || event->type() == QEvent::HoverLeave) {
+        const auto it = m_panels.constFind(watched);
+        if (it != m_panels.constEnd() && Panels[it.value()].hoverBorder) {
+            static_cast<QWidget *>(watched)->update();
+        }
+    } else if (event->type() == QEvent::Paint) {
+        const auto it = m_panels.constFind(watched);
+        if (it != m_panels.constEnd()) {
+            auto *widget = static_cast<QWidget *>(watched);
+            const Panel &panel = Panels[it.value()];
+            QPainter painter(widget);
+            if (panel.borderEdges == AllEdges) {
+                const bool hovered = panel.hoverBorder && widget->underMouse();
+                fillRounded(&painter, widget->rect(), panel.radius, QColor(panel.background),
+                            QColor(hovered ? panel.hoverBorder : panel.border));
+            } else {
+                fillRounded(&painter, widget->rect(), panel.radius, QColor(panel.background));
+            }
+            if (panel.borderEdges && panel.borderEdges != AllEdges) {
+                const QRect r = widget->rect();
+                painter.setPen(QColor(panel.border));
+                if (panel.borderEdges & Qt::RightEdge) painter.drawLine(r.topRight(), r.bottomRight());
+                if (panel.borderEdges & Qt::BottomEdge) painter.drawLine(r.bottomLeft(), r.bottomRight());
+                if (panel.borderEdges & Qt::TopEdge) painter.drawLine(r.topLeft(), r.topRight());
+            }
+        }
+    }
+    return QProxyStyle::eventFilter(watched, event);
+}
+
+PosStyle::ViewRole PosStyle::viewRole(const QWidget *widget) const
+{
+    return m_viewRoles.value(widget, TableView);
+}
+
+int PosStyle::pixelMetric(PixelMetric metric, const QStyleOption *option, const QWidget *widget) const
+{
+    switch (metric) {
+    case PM_ScrollBarExtent:
+        return ScrollBarExtent;
+    case PM_ScrollBarSliderMin:
+        return 20;
+    case PM_DefaultFrameWidth:
+        if (qobject_cast<const QLineEdit *>(widget)) return 1;
+        break;
+    default:
+        break;
+    }
+    return QProxyStyle::pixelMetric(metric, option, widget);
+}
+
+QSize PosStyle::sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size,
+                                 const QWidget *widget) const
+{
+    switch (type) {
+    case CT_PushButton:
+        return size + QSize(2 * 15, 2 * 10); // padding: 10px 15px, no border
+    case CT_LineEdit:
+        return size + QSize(2 * 8 + 2, 2 * 8 + 2); // padding: 8px plus the 1px border
+    case CT_ItemViewItem: {
+        const QSize base = QProxyStyle::sizeFromContents(type, option, size, widget);
+        switch (viewRole(widget)) {
+        case NavigationView:
+            return base + QSize(2 * 20 + 2 * 10, 2 * 15 + 2 * 2); // padding 15/20, margin 2/10
+        case ProductGridView:
+            return base + QSize(2 * 10 + 2 * 5, 2 * 10 + 2 * 5); // padding 10, margin 5
+        case TableView:
+            return base + QSize(2 * 15, 2 * 10);
+        }
+        return base;
+    }
+    case CT_HeaderSection: {
+        const QSize base = QProxyStyle::sizeFromContents(type, option, size, widget);
+        return QSize(base.width() + 2 * 15, base.height() + 2 * 12 - 2 * 4);
+    }
+    default:
+        break;
+    }
+    return QProxyStyle::sizeFromContents(type, option, size, widget);
+}
+
+QRect PosStyle::subElementRect(SubElement element, const QStyleOption *option, const QWidget *widget) const
+{
+    switch (element) {
+    case SE_LineEditContents:
+        return option->rect.adjusted(8, 0, -8, 0);
+    case SE_ItemViewItemText:
+    case SE_ItemViewItemDecoration:
+    case SE_ItemViewItemCheckIndicator:
+        if (const auto *item = qstyleoption_cast<const QStyleOptionViewItem *>(option)) {
+            // Lay the content out inside the item's margin and padding
+            QStyleOptionViewItem inner(*item);
+            switch (viewRole(widget)) {
+            case NavigationView:
+                inner.rect = item->rect.adjusted(30, 17, -30, -17);
+                break;
+            case ProductGridView:
+                inner.rect = item->rect.adjusted(15, 15, -15, -15);
+                break;
+            case TableView:
+                inner.rect = item->rect.adjusted(15, 0, -15, 0);
+                break;
+            }
+            return QProxyStyle::subElementRect(element, &inner, widget);
+        }
+        break;
+    default:
+        break;
+    }
+    return QProxyStyle::subElementRect(element, option, widget);
+}
+
+QRect PosStyle::subControlRect(ComplexControl control, const QStyleOptionComplex *option, SubControl subControl,
+                               const QWidget *widget) const
+{
+    // Flat scroll bars: no arrow buttons, the groove is the whole bar
+    if (control == CC_ScrollBar) {
+        if (const auto *bar = qstyleoption_cast<const QStyleOptionSlider *>(option)) {
+            const bool horizontal = bar->orientation == Qt::Horizontal;
+            const QRect groove = bar->rect;
+            const int length = horizontal ? groove.width() : groove.height();
+            const int range = bar->maximum - bar->minimum;
+            int sliderLength = length;
+            if (range > 0) {
+                sliderLength = int(qint64(length) * bar->pageStep / (qint64(range) + bar->pageStep));
+                sliderLength = qBound(pixelMetric(PM_ScrollBarSliderMin, bar, widget), sliderLength, length);
+            }
+            const int start = sliderPositionFromValue(bar->minimum, bar->maximum, bar->sliderPosition,
+                                                      length - sliderLength, bar->upsideDown);
+            const QRect slider = horizontal ? QRect(groove.x() + start, groove.y(), sliderLength, groove.height())
+                                            : QRect(groove.x(), groove.y() + start, groove.width(), sliderLength);
+            switch (subControl) {
+            case SC_ScrollBarGroove:
+                return groove;
+            case SC_ScrollBarSlider:
+                return slider;
+            case SC_ScrollBarSubPage:
+                return horizontal ? QRect(groove.left(), groove.top(), start, groove.height())
+                                  : QRect(groove.left(), groove.top(), groove.width(), start);
+            case SC_ScrollBarAddPage:
+                return horizontal ? QRect(slider.right() + 1, groove.top(), groove.right() - slider.right(), groove.height())
+                                  : QRect(groove.left(), slider.bottom() + 1, groove.width(), groove.bottom() - slider.bottom());
+            default:
+                return QRect();
+            }
+        }
+    }
+    return QProxyStyle::subControlRect(control, option, subControl, widget);
+}
+
+void PosStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter,
+                             const QWidget *widget) const
+{
+    switch (element) {
+    case PE_PanelButtonCommand: {
+        QColor color = option->palette.color(QPalette::Button);
+        if (!(option->state & State_Enabled)) {
+            color = QColor(DisabledButton);
+        } else if (option->state & (State_Sunken | State_On)) {
+            color = color.darker(120);
+        } else if (option->state & State_MouseOver) {
+            color = color.darker(110);
+        }
+        fillRounded(painter, option->rect, ButtonRadius, color);
+        return;
+    }
+    case PE_FrameDefaultButton:
+    case PE_FrameFocusRect:
+        return; // outline: 0
+    case PE_PanelLineEdit:
+    case PE_FrameLineEdit: {
+        const QColor border((option->state & State_HasFocus) ? FocusBorder : InputBorder);
+        fillRounded(painter, option->rect, InputRadius, QColor(Surface), border);
+        return;
+    }
+    case PE_Frame:
+        if (qobject_cast<const QAbstractItemView *>(widget) && viewRole(widget) != NavigationView) {
+            painter->save();
+            painter->setPen(QColor(viewRole(widget) == ProductGridView ? 0xffe0e0e0 : Border));
+            painter->setBrush(Qt::NoBrush);
+            painter->drawRect(option->rect.adjusted(0, 0, -1, -1));
+            painter->restore();
+            return;
+        }
+        break;
+    case PE_PanelItemViewItem: {
+        const bool selected = option->state & State_Selected;
+        const bool hovered = option->state & State_MouseOver;
+        switch (viewRole(widget)) {
+        case NavigationView:
+            if (selected || hovered) {
+                fillRounded(painter, QRectF(option->rect).adjusted(10, 2, -10, -2), 5,
+                            selected ? option->palette.color(QPalette::Highlight) : QColor(Hover));
+            }
+            return;
+        case ProductGridView: {
+            const QRectF tile = QRectF(option->rect).adjusted(5, 5, -5, -5);
+            if (selected) {
+                painter->save();
+                painter->setRenderHint(QPainter::Antialiasing);
+                painter->setPen(QPen(QColor(Primary), 2));
+                painter->setBrush(QColor(Background));
+                painter->drawRoundedRect(tile.adjusted(1, 1, -1, -1), 8, 8);
+                painter->restore();
+            } else {
+                fillRounded(painter, tile, 8, QColor(hovered ? Subtle : Surface), QColor(0xffe0e0e0));
+            }
+            return;
+        }
+        case TableView:
+            if (selected) {
+                painter->fillRect(option->rect, option->palette.color(QPalette::Highlight));
+            } else if (hovered) {
+                painter->fillRect(option->rect, QColor(Hover));
+            }
+            painter->save();
+            painter->setPen(QColor(Subtle));
+            painter->drawLine(option->rect.bottomLeft(), option->rect.bottomRight());
+            painter->restore();
+            return;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    QProxyStyle::drawPrimitive(element, option, painter, widget);
+}
+
+void PosStyle::drawControl(ControlElement element, const QStyleOption *option, QPainter *painter,
+                           const QWidget *widget) const
+{
+    switch (element) {
+    case CE_HeaderSection:
+        painter->fillRect(option->rect, QColor(Subtle));
+        painter->save();
+        painter->setPen(QColor(Border));
+        painter->drawLine(option->rect.bottomLeft(), option->rect.bottomRight());
+        painter->restore();
+        return;
+    case CE_HeaderLabel:
+        if (const auto *header = qstyleoption_cast<const QStyleOptionHeader *>(option)) {
+            painter->save();
+            QFont font = painter->font();
+            font.setPixelSize(13);
+            font.setWeight(QFont::DemiBold);
+            painter->setFont(font);
+            painter->setPen(QColor(MutedText));
+            painter->drawText(header->rect.adjusted(15, 0, -15, 0), int(header->textAlignment | Qt::AlignVCenter),
+                              header->text.toUpper());
+            painter->restore();
+            return;
+        }
+        break;
+    case CE_ShapedFrame:
+        if (qobject_cast<const QAbstractItemView *>(widget)) {
+            proxy()->drawPrimitive(PE_Frame, option, painter, widget);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    QProxyStyle::drawControl(element, option, painter, widget);
+}
+
+void PosStyle::drawComplexControl(ComplexControl control, const QStyleOptionComplex *option, QPainter *painter,
+                                  const QWidget *widget) const
+{
+    if (control == CC_ScrollBar) {
+        painter->fillRect(option->rect, QColor(Hover));
+        const QRect slider = subControlRect(control, option, SC_ScrollBarSlider, widget);
+        if (slider.isValid() && (option->state & State_Enabled)) {
+            fillRounded(painter, slider, ScrollBarExtent / 2, QColor(InputBorder));
+        }
+        return;
+    }
+    QProxyStyle::drawComplexControl(control, option, painter, widget);
+}
@@ -0,0 +1,58 @@
+#ifndef POSSTYLE_H
+#define POSSTYLE_H
+
+#include <QHash>
+#include <QProxyStyle>
+
+class QApplication;
+
+// The application's look (style.qss) as a QProxyStyle over Fusion. The stylesheet
+// path sends every widget through QStyleSheetStyle, which matches selectors on each
+// polish and re-resolves rules while painting; here colours, fonts and paddings are
+// looked up by object name once, when a widget is polished, and painting only reads
+// the palette and a few fixed metrics.
+//
+// POS_THEME=qss switches back to style.qss; --theme-benchmark compares the two.
+class PosStyle : public QProxyStyle
+{
+    Q_OBJECT
+
+public:
+    PosStyle();
+
+    static void apply(QApplication &app); // Installs this style, its palette and font
+    static void applyStyleSheet(QApplication &app); // The original style.qss path
+    static QString styleSheet();
+
+    QPalette standardPalette() const override;
+    void polish(QPalette &palette) override;
+    void polish(QWidget *widget) override;
+    void unpolish(QWidget *widget) override;
+
+    int pixelMetric(PixelMetric metric, const QStyleOption *option = nullptr,
+                    const QWidget *widget = nullptr) const override;
+    QSize sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size,
+                           const QWidget *widget) const override;
+    QRect subElementRect(SubElement element, const QStyleOption *option, const QWidget *widget) const override;
+    QRect subControlRect(ComplexControl control, const QStyleOptionComplex *option, SubControl subControl,
+                         const QWidget *widget) const override;
+    void drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter,
+                       const QWidget *widget = nullptr) const override;
+    void drawControl(ControlElement element, const QStyleOption *option, QPainter *painter,
+                     const QWidget *widget = nullptr) const override;
+    void drawComplexControl(ComplexControl control, const QStyleOptionComplex *option, QPainter *painter,
+                            const QWidget *widget = nullptr) const override;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    enum ViewRole { TableView, NavigationView, ProductGridView };
+
+    ViewRole viewRole(const QWidget *widget) const;
+
+    QHash<const QObject *, ViewRole> m_viewRoles; // Filled in polish(), read while painting
+    QHash<const QObject *, int> m_panels; // Widgets with a painted panel, index into the panel table
+};
+
+#endif // POSSTYLE_H
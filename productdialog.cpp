@@ -1,5 +1,6 @@
 #include "productdialog.h"
 #include "ui_productdialog.h"
+#include "imagestore.h"
 #include <QFileDialog>
 #include <QPixmap>
 #include <QDebug>
@@ -47,7 +48,7 @@ void ProductDialog::setImage(const QString &imagePath)
         return;
     }
 
-    QPixmap pixmap(imagePath);
+    QPixmap pixmap(ImageStore::variantPath(imagePath, ImageStore::Preview));
     if (pixmap.isNull()) {
         qDebug() << "Error loading image:" << imagePath;
         ui->imagePreviewLabel->setText("Failed to load image");
@@ -65,20 +66,14 @@ void ProductDialog::on_browseImageButton_clicked()
         return;
     }
 
-    QDir imagesDir("images");
-    if (!imagesDir.exists()) {
-        imagesDir.mkpath(".");
-    }
-
-    QString fileName = QFileInfo(imagePath).fileName();
-    QString destinationPath = imagesDir.filePath(fileName);
-
-    if (!QFile::exists(destinationPath)) {
-        if (!QFile::copy(imagePath, destinationPath)) {
-            QMessageBox::warning(this, tr("Error"), tr("Could not copy image to application folder."));
-            return;
-        }
+    // Stored by content, already resized for the grid, sale details and this preview
+    const ImageStore::Result stored = ImageStore::ingest(imagePath);
+    if (stored.imagePath.isEmpty()) {
+        qDebug() << "Error importing image:" << imagePath << stored.error;
+        QMessageBox::warning(this, tr("Error"), tr("Could not import the image: %1").arg(stored.error));
+        return;
     }
+    const QString destinationPath = stored.imagePath;
 
     // Store the relative path to be portable
     ui->imagePathEdit->setText(destinationPath);
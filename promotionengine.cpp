@@ -0,0 +1,212 @@
+#include "promotionengine.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace {
+
+double roundCents(double amount)
+{
+    return std::round(amount * 100.0) / 100.0;
+}
+
+} // namespace
+
+bool Promotion::isActive(const QDateTime &when) const
+{
+    if (startsAt.isValid() && when < startsAt) return false;
+    if (endsAt.isValid() && when >= endsAt) return false;
+    if (!(weekdays & (1 << (when.date().dayOfWeek() - 1)))) return false;
+    if (dailyFrom.isValid() && dailyTo.isValid()) {
+        const QTime time = when.time();
+        if (dailyFrom <= dailyTo) {
+            return time >= dailyFrom && time < dailyTo;
+        }
+        return time >= dailyFrom || time < dailyTo; // Runs past midnight
+    }
+    return true;
+}
+
+void PromotionEngine::setPromotions(const QList<Promotion> &promotions)
+{
+    m_promotions = promotions;
+    m_active.clear();
+    m_activeLines.clear();
+    m_owner.clear();
+}
+
+void PromotionEngine::compile(const QDateTime &now)
+{
+    m_active.clear();
+    for (int i = 0; i < m_promotions.size(); ++i) {
+        if (m_promotions.at(i).isActive(now)) {
+            m_active.push_back(i);
+        }
+    }
+    std::stable_sort(m_active.begin(), m_active.end(), [this](int a, int b) {
+        return m_promotions.at(a).priority > m_promotions.at(b).priority;
+    });
+
+    // A product belongs to the first (highest priority) active promotion listing it
+    m_owner.clear();
+    for (int compiled = 0; compiled < int(m_active.size()); ++compiled) {
+        const Promotion &promotion = m_promotions.at(m_active[compiled]);
+        for (auto it = promotion.products.constBegin(); it != promotion.products.constEnd(); ++it) {
+            if (!m_owner.contains(it.key())) {
+                m_owner.insert(it.key(), compiled);
+            }
+        }
+    }
+
+    // Reprice the current cart against the new tables
+    m_activeLines.assign(m_active.size(), QSet<int>());
+    m_totalDiscount = 0.0;
+    for (auto it = m_lines.begin(); it != m_lines.end(); ++it) {
+        it->discount = 0.0;
+        const int compiled = m_owner.value(it.key(), -1);
+        if (compiled >= 0) {
+            m_activeLines[compiled].insert(it.key());
+        }
+    }
+    for (int compiled = 0; compiled < int(m_active.size()); ++compiled) {
+        for (int productId : std::as_const(m_activeLines[compiled])) {
+            evaluate(compiled, productId);
+        }
+    }
+}
+
+QDateTime PromotionEngine::nextChange(const QDateTime &now) const
+{
+    QDateTime next;
+    auto consider = [&](const QDateTime &when) {
+        if (when.isValid() && when > now && (!next.isValid() || when < next)) {
+            next = when;
+        }
+    };
+    for (const Promotion &promotion : m_promotions) {
+        consider(promotion.startsAt);
+        consider(promotion.endsAt);
+        if (promotion.weekdays != 0x7f) {
+            consider(QDateTime(now.date().addDays(1), QTime(0, 0)));
+        }
+        if (promotion.dailyFrom.isValid() && promotion.dailyTo.isValid()) {
+            for (int day = 0; day < 2; ++day) {
+                consider(QDateTime(now.date().addDays(day), promotion.dailyFrom));
+                consider(QDateTime(now.date().addDays(day), promotion.dailyTo));
+            }
+        }
+    }
+    return next;
+}
+
+QList<int> PromotionEngine::setLine(int productId, double price, int quantity)
+{
+    const int compiled = m_owner.value(productId, -1);
+    if (quantity <= 0) {
+        m_totalDiscount -= m_lines.value(productId).discount;
+        m_lines.remove(productId);
+        if (compiled >= 0) {
+            m_activeLines[compiled].remove(productId);
+        }
+    } else {
+        Line &line = m_lines[productId];
+        line.price = price;
+        line.quantity = quantity;
+        if (compiled >= 0) {
+            m_activeLines[compiled].insert(productId);
+        }
+    }
+    if (compiled < 0) {
+        return {};
+    }
+    return evaluate(compiled, productId);
+}
+
+void PromotionEngine::clearCart()
+{
+    m_lines.clear();
+    for (QSet<int> &lines : m_activeLines) {
+        lines.clear();
+    }
+    m_totalDiscount = 0.0;
+}
+
+double PromotionEngine::discount(int productId) const
+{
+    return m_lines.value(productId).discount;
+}
+
+QString PromotionEngine::promotionName(int productId) const
+{
+    if (discount(productId) <= 0.0) return QString();
+    return m_promotions.at(m_active[m_owner.value(productId)]).name;
+}
+
+void PromotionEngine::setDiscount(int productId, double discount, QList<int> *changed)
+{
+    auto it = m_lines.find(productId);
+    if (it == m_lines.end() || it->discount == discount) return;
+    m_totalDiscount += discount - it->discount;
+    it->discount = discount;
+    changed->append(productId);
+}
+
+QList<int> PromotionEngine::evaluate(int compiled, int productId)
+{
+    // Only the lines this promotion covers are looked at; for a percentage only the
+    // line that changed, since its units do not depend on each other
+    const Promotion &promotion = m_promotions.at(m_active[compiled]);
+    const QSet<int> &lines = m_activeLines[compiled];
+    QList<int> changed;
+
+    switch (promotion.kind) {
+    case Promotion::Percent: {
+        const Line line = m_lines.value(productId);
+        setDiscount(productId, roundCents(line.price * line.quantity * promotion.percent / 100.0), &changed);
+        break;
+    }
+    case Promotion::BuyXGetY: {
+        // Of every buy + free units, the cheapest free ones are given away
+        const int group = promotion.buyQuantity + promotion.freeQuantity;
+        QList<std::pair<double, int>> byPrice; // Price, product id
+        int units = 0;
+        for (int id : lines) {
+            const Line &line = m_lines[id];
+            byPrice.append({ line.price, id });
+            units += line.quantity;
+        }
+        std::sort(byPrice.begin(), byPrice.end());
+        int freeUnits = group > 0 ? units / group * promotion.freeQuantity : 0;
+        for (const auto &entry : std::as_const(byPrice)) {
+            const int free = std::min(freeUnits, m_lines[entry.second].quantity);
+            freeUnits -= free;
+            setDiscount(entry.second, roundCents(free * entry.first), &changed);
+        }
+        break;
+    }
+    case Promotion::Bundle: {
+        // Complete sets of the products cost the bundle price; the saving is spread
+        // over the lines by their share of the full price
+        int sets = lines.size() == promotion.products.size() ? std::numeric_limits<int>::max() : 0;
+        double fullPrice = 0.0;
+        for (int id : lines) {
+            const int perSet = std::max(1, promotion.products.value(id));
+            sets = std::min(sets, m_lines[id].quantity / perSet);
+            fullPrice += m_lines[id].price * perSet;
+        }
+        const double saving = (sets > 0 && fullPrice > promotion.bundlePrice)
+            ? roundCents((fullPrice - promotion.bundlePrice) * sets) : 0.0;
+        double remaining = saving;
+        int left = lines.size();
+        for (int id : lines) {
+            const double share = (--left == 0 || saving == 0.0) ? roundCents(remaining)
+                : roundCents(saving * m_lines[id].price * std::max(1, promotion.products.value(id)) / fullPrice);
+            remaining -= share;
+            setDiscount(id, share, &changed);
+        }
+        break;
+    }
+    }
+    return changed;
+}
@@ -0,0 +1,72 @@
+#ifndef PROMOTIONENGINE_H
+#define PROMOTIONENGINE_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <vector>
+
+// A promotion as stored in Promotions/PromotionProducts. Every kind can be limited
+// to a date range and to a daily time window on some weekdays (a happy hour).
+struct Promotion {
+    enum Kind { Percent, BuyXGetY, Bundle };
+
+    int id = 0;
+    QString name;
+    Kind kind = Percent;
+    int priority = 0;          // Higher wins where promotions share a product
+    double percent = 0.0;      // Percent: off each unit
+    int buyQuantity = 0;       // BuyXGetY: of every buy + free units across the products,
+    int freeQuantity = 0;      // the cheapest free ones cost nothing
+    double bundlePrice = 0.0;  // Bundle: price of one set of the products
+    QHash<int, int> products;  // Product id to units per bundle (1 for the other kinds)
+    QDateTime startsAt;        // Local time; invalid means no limit
+    QDateTime endsAt;
+    QTime dailyFrom;           // Both invalid: all day
+    QTime dailyTo;
+    int weekdays = 0x7f;       // Bit 0 is Monday
+
+    bool isActive(const QDateTime &when) const;
+};
+
+// Prices a cart against the promotions that are active at the moment. compile()
+// turns the active rules into a lookup table from product id to the one promotion
+// that product takes part in (the highest priority one), so a cart change only
+// re-evaluates that promotion over the cart lines it covers. Pricing a scan costs
+// the same however many promotions are defined.
+class PromotionEngine
+{
+public:
+    void setPromotions(const QList<Promotion> &promotions); // Keeps the cart; call compile()
+    void compile(const QDateTime &now); // Rebuilds the lookup tables and reprices the cart
+    QDateTime nextChange(const QDateTime &now) const; // When the set of active promotions may change
+
+    // Cart lines; quantity 0 removes a line. Returns the products whose discount changed.
+    QList<int> setLine(int productId, double price, int quantity);
+    void clearCart();
+
+    double discount(int productId) const; // For the whole line
+    QString promotionName(int productId) const; // Empty when the line has no discount
+    double totalDiscount() const { return m_totalDiscount; }
+
+private:
+    struct Line {
+        double price = 0.0;
+        int quantity = 0;
+        double discount = 0.0;
+    };
+
+    QList<int> evaluate(int compiled, int productId);
+    void setDiscount(int productId, double discount, QList<int> *changed);
+
+    QList<Promotion> m_promotions;
+    std::vector<int> m_active; // Compiled promotions (indexes into m_promotions), by priority
+    std::vector<QSet<int>> m_activeLines; // Cart lines each compiled promotion covers
+    QHash<int, int> m_owner; // Product id to its compiled promotion
+    QHash<int, Line> m_lines; // Cart, by product id
+    double m_totalDiscount = 0.0;
+};
+
+#endif // PROMOTIONENGINE_H
@@ -0,0 +1,22 @@
+#include "readconnection.h"
+#include <QAtomicInt>
+#include <QDebug>
+#include <QSqlError>
+
+ReadConnection::ReadConnection(const QString &databasePath, const QString &prefix)
+{
+    static QAtomicInt counter;
+    m_name = QString("%1-%2").arg(prefix).arg(counter.fetchAndAddRelaxed(1));
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", m_name);
+    db.setDatabaseName(databasePath);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    if (!db.open()) {
+        qDebug() << "Error:" << prefix << "connection failed:" << db.lastError();
+    }
+}
+
+ReadConnection::~ReadConnection()
+{
+    QSqlDatabase::database(m_name, false).close();
+    QSqlDatabase::removeDatabase(m_name);
+}
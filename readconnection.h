@@ -0,0 +1,22 @@
+#ifndef READCONNECTION_H
+#define READCONNECTION_H
+
+#include <QSqlDatabase>
+#include <QString>
+
+// A private read-only connection for a scan on a pool thread, closed and removed
+// when it goes out of scope. Names are prefix-0, prefix-1, ... so any number can
+// be open at once.
+class ReadConnection
+{
+public:
+    ReadConnection(const QString &databasePath, const QString &prefix);
+    ~ReadConnection();
+
+    QSqlDatabase database() const { return QSqlDatabase::database(m_name, false); }
+
+private:
+    QString m_name;
+};
+
+#endif // READCONNECTION_H
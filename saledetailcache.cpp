@@ -0,0 +1,149 @@
+#include "saledetailcache.h"
+#include "imagestore.h"
+#include <QDebug>
+
+SaleDetailLoader::SaleDetailLoader(const QString &databasePath, QObject *parent) :
+    QObject(parent),
+    m_databasePath(databasePath),
+    m_dbManager(nullptr),
+    m_thumbnails(SaleDetailCache::ThumbnailCacheBytes)
+{
+}
+
+SaleDetailLoader::~SaleDetailLoader()
+{
+    delete m_dbManager;
+}
+
+void SaleDetailLoader::start()
+{
+    // Created here so the connection belongs to the prefetch thread
+    m_dbManager = new DatabaseManager("sale-details", m_databasePath);
+}
+
+void SaleDetailLoader::load(const QList<int> &saleIds)
+{
+    if (!m_dbManager) {
+        return; // Shut down
+    }
+    for (int saleId : saleIds) {
+        emit loaded(saleId, SaleDetailCache::read(m_dbManager, saleId, &m_thumbnails));
+    }
+}
+
+void SaleDetailLoader::clearThumbnails()
+{
+    m_thumbnails.clear();
+}
+
+void SaleDetailLoader::shutdown()
+{
+    delete m_dbManager;
+    m_dbManager = nullptr;
+    m_thumbnails.clear();
+}
+
+SaleDetailCache::SaleDetailCache(const QString &databasePath, QObject *parent) :
+    QObject(parent),
+    m_details(DefaultCapacity),
+    m_thumbnails(ThumbnailCacheBytes),
+    m_generation(0)
+{
+    qRegisterMetaType<SaleDetails>();
+
+    m_loader = new SaleDetailLoader(databasePath);
+    m_loader->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_loader, &QObject::deleteLater);
+    connect(m_loader, &SaleDetailLoader::loaded, this, &SaleDetailCache::onLoaded);
+    m_thread.setObjectName("SaleDetailCache");
+    m_thread.start(QThread::LowPriority);
+    QMetaObject::invokeMethod(m_loader, &SaleDetailLoader::start, Qt::QueuedConnection);
+}
+
+SaleDetailCache::~SaleDetailCache()
+{
+    QMetaObject::invokeMethod(m_loader, &SaleDetailLoader::shutdown, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+SaleDetails SaleDetailCache::details(int saleId, DatabaseManager *fallback)
+{
+    if (const SaleDetails *cached = m_details.object(saleId)) {
+        return *cached; // object() also marks it most recently used
+    }
+
+    // Not prefetched (or still on its way): load it here rather than wait
+    SaleDetails details = read(fallback, saleId, &m_thumbnails);
+    m_details.insert(saleId, new SaleDetails(details));
+    return details;
+}
+
+void SaleDetailCache::prefetch(const QList<int> &saleIds)
+{
+    QList<int> wanted;
+    for (int saleId : saleIds) {
+        if (!m_details.contains(saleId) && !m_pending.contains(saleId)) {
+            m_pending.insert(saleId, m_generation);
+            wanted.append(saleId);
+        }
+    }
+    if (!wanted.isEmpty()) {
+        QMetaObject::invokeMethod(m_loader, [loader = m_loader, wanted]() { loader->load(wanted); },
+                                  Qt::QueuedConnection);
+    }
+}
+
+void SaleDetailCache::clear()
+{
+    m_details.clear();
+    m_thumbnails.clear();
+    QMetaObject::invokeMethod(m_loader, &SaleDetailLoader::clearThumbnails, Qt::QueuedConnection);
+    ++m_generation;
+}
+
+void SaleDetailCache::onLoaded(int saleId, const SaleDetails &details)
+{
+    const auto it = m_pending.constFind(saleId);
+    if (it == m_pending.constEnd()) {
+        return;
+    }
+    const bool current = it.value() == m_generation;
+    m_pending.erase(it);
+    // A synchronous load may have got there first; either copy is the same sale
+    if (current && !m_details.contains(saleId)) {
+        m_details.insert(saleId, new SaleDetails(details));
+    }
+}
+
+SaleDetails SaleDetailCache::read(DatabaseManager *dbManager, int saleId, QCache<QString, QImage> *thumbnails)
+{
+    SaleDetails details;
+    if (!dbManager) {
+        return details;
+    }
+    details.items = dbManager->getSaleDetails(saleId);
+    details.thumbnails.reserve(details.items.size());
+
+    // QImage rather than QPixmap so this can run off the GUI thread
+    for (const SaleDetailItem &item : details.items) {
+        QImage thumbnail;
+        if (!item.imagePath.isEmpty()) {
+            if (const QImage *cached = thumbnails ? thumbnails->object(item.imagePath) : nullptr) {
+                thumbnail = *cached;
+            } else {
+                const QImage image(ImageStore::variantPath(item.imagePath, ImageStore::Row));
+                if (image.isNull()) {
+                    qDebug() << "Error loading image for sale item" << item.productName << ":" << item.imagePath;
+                } else {
+                    thumbnail = image.scaled(ThumbnailSize, ThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                }
+                if (thumbnails) {
+                    thumbnails->insert(item.imagePath, new QImage(thumbnail), qMax<qsizetype>(1, thumbnail.sizeInBytes()));
+                }
+            }
+        }
+        details.thumbnails.append(thumbnail);
+    }
+    return details;
+}
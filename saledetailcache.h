@@ -0,0 +1,82 @@
+#ifndef SALEDETAILCACHE_H
+#define SALEDETAILCACHE_H
+
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QThread>
+#include "databasemanager.h"
+
+// A sale's items with their product thumbnails already decoded and scaled, ready
+// for SaleDetailDialog. thumbnails[i] belongs to items[i] and is null when the
+// product has no usable image.
+struct SaleDetails {
+    QList<SaleDetailItem> items;
+    QList<QImage> thumbnails;
+};
+Q_DECLARE_METATYPE(SaleDetails)
+
+// Runs on the prefetch thread with its own connection to the replica.
+class SaleDetailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SaleDetailLoader(const QString &databasePath, QObject *parent = nullptr);
+    ~SaleDetailLoader();
+
+public slots:
+    void start();
+    void load(const QList<int> &saleIds);
+    void clearThumbnails();
+    void shutdown();
+
+signals:
+    void loaded(int saleId, const SaleDetails &details);
+
+private:
+    QString m_databasePath;
+    DatabaseManager *m_dbManager;
+    QCache<QString, QImage> m_thumbnails; // By image path; sales of the same products share them
+};
+
+// Recently opened sales and their neighbours in the Reports table, so the detail
+// dialog can be filled without touching the database or decoding images. Sales do
+// not change once recorded, so entries stay valid until evicted (least recently
+// used first) or cleared because a product was renamed or got a new picture.
+// prefetch() loads on a background thread; details() falls back to loading
+// synchronously on the caller's connection for a sale that is not cached yet.
+class SaleDetailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultCapacity = 128; // Sales kept
+    static constexpr int ThumbnailSize = 60; // Matches the dialog's image column
+    static constexpr int ThumbnailCacheBytes = 8 * 1024 * 1024;
+
+    explicit SaleDetailCache(const QString &databasePath, QObject *parent = nullptr);
+    ~SaleDetailCache();
+
+    SaleDetails details(int saleId, DatabaseManager *fallback);
+    void prefetch(const QList<int> &saleIds); // Skips sales already cached or on their way
+    void clear();
+
+    // Reads a sale and builds its thumbnails; thumbnails may be null (no caching)
+    static SaleDetails read(DatabaseManager *dbManager, int saleId, QCache<QString, QImage> *thumbnails);
+
+private slots:
+    void onLoaded(int saleId, const SaleDetails &details);
+
+private:
+    QThread m_thread;
+    SaleDetailLoader *m_loader;
+    QCache<int, SaleDetails> m_details;
+    QHash<int, quint64> m_pending; // Requested from the loader, not back yet: generation asked in
+    QCache<QString, QImage> m_thumbnails; // For synchronous loads
+    quint64 m_generation; // Bumped by clear(); loads requested before it are dropped
+};
+
+#endif // SALEDETAILCACHE_H
@@ -1,6 +1,5 @@
 #include "saledetaildialog.h"
 #include "ui_saledetaildialog.h"
-#include <QDebug>
 #include <QHeaderView>
 #include <QPixmap>
 
@@ -9,13 +8,13 @@ SaleDetailDialog::SaleDetailDialog(QWidget *parent) :
     ui(new Ui::SaleDetailDialog)
 {
     ui->setupUi(this);
-    m_saleItemsModel = new QStandardItemModel(0, 4, this); // 4 columns now: Name, Qty, Price, Image
-    m_saleItemsModel->setHorizontalHeaderLabels({"Product Name", "Quantity Sold", "Price at Sale", "Image"});
+    m_saleItemsModel = new QStandardItemModel(0, 5, this); // 5 columns now: Name, Qty, Price, Discount, Image
+    m_saleItemsModel->setHorizontalHeaderLabels({"Product Name", "Quantity Sold", "Price at Sale", "Discount", "Image"});
     ui->saleItemsTableView->setModel(m_saleItemsModel);
     ui->saleItemsTableView->horizontalHeader()->setStretchLastSection(true);
     ui->saleItemsTableView->setEditTriggers(QAbstractItemView::NoEditTriggers); // Make table read-only
     ui->saleItemsTableView->verticalHeader()->setDefaultSectionSize(60); // Adjust row height for images
-    ui->saleItemsTableView->setColumnWidth(3, 80); // Adjust image column width
+    ui->saleItemsTableView->setColumnWidth(4, 80); // Adjust image column width
 }
 
 SaleDetailDialog::~SaleDetailDialog()
@@ -25,33 +24,44 @@ SaleDetailDialog::~SaleDetailDialog()
 
 void SaleDetailDialog::setSaleId(int saleId, DatabaseManager* dbManager)
 {
-    m_saleItemsModel->clear();
-    m_saleItemsModel->setHorizontalHeaderLabels({"Product Name", "Quantity Sold", "Price at Sale", "Image"});
+    setSaleDetails(saleId, SaleDetailCache::read(dbManager, saleId, nullptr));
+}
 
-    QList<SaleDetailItem> details = dbManager->getSaleDetails(saleId);
-    for (const auto& item : details) {
-        QList<QStandardItem*> rowItems;
-        rowItems << new QStandardItem(item.productName);
-        rowItems << new QStandardItem(QString::number(item.quantitySold));
-        rowItems << new QStandardItem(QString::number(item.priceAtSale, 'f', 2));
+void SaleDetailDialog::setSaleDetails(int saleId, const SaleDetails &details)
+{
+    // The dialog is pooled, so the model keeps its items and only their contents change
+    const int rows = details.items.size();
+    m_saleItemsModel->setRowCount(rows);
+    for (int row = 0; row < rows; ++row) {
+        const SaleDetailItem &item = details.items.at(row);
+        const QString texts[] = { item.productName, QString::number(item.quantitySold),
+                                  QString::number(item.priceAtSale, 'f', 2),
+                                  item.discount > 0.0 ? QString("-%1").arg(item.discount, 0, 'f', 2) : QString() };
+        for (int column = 0; column < 4; ++column) {
+            QStandardItem *cell = m_saleItemsModel->item(row, column);
+            if (!cell) {
+                cell = new QStandardItem;
+                m_saleItemsModel->setItem(row, column, cell);
+            }
+            cell->setText(texts[column]);
+        }
 
         // Handle image display
-        QStandardItem* imageItem = new QStandardItem();
-        if (!item.imagePath.isEmpty()) {
-            QPixmap pixmap(item.imagePath);
-            if (!pixmap.isNull()) {
-                QPixmap scaledPixmap = pixmap.scaled(60, 60, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                imageItem->setIcon(QIcon(scaledPixmap));
-            } else {
-                qDebug() << "Error loading image for sale item" << item.productName << ":" << item.imagePath;
-                imageItem->setText("No Image");
-            }
+        QStandardItem *imageItem = m_saleItemsModel->item(row, 4);
+        if (!imageItem) {
+            imageItem = new QStandardItem;
+            m_saleItemsModel->setItem(row, 4, imageItem);
+        }
+        const QImage &thumbnail = details.thumbnails.value(row);
+        if (!thumbnail.isNull()) {
+            imageItem->setIcon(QIcon(QPixmap::fromImage(thumbnail)));
+            imageItem->setText(QString());
         } else {
+            imageItem->setIcon(QIcon());
             imageItem->setText("No Image");
         }
-        rowItems << imageItem;
-        m_saleItemsModel->appendRow(rowItems);
     }
+    ui->saleItemsTableView->scrollToTop();
 
     setWindowTitle(QString("Sale Details for Sale ID: %1").arg(saleId));
 }
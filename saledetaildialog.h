@@ -4,6 +4,7 @@
 #include <QDialog>
 #include <QStandardItemModel>
 #include "databasemanager.h" // For SaleDetailItem and DatabaseManager
+#include "saledetailcache.h"
 
 namespace Ui {
 class SaleDetailDialog;
@@ -18,6 +19,7 @@ public:
     ~SaleDetailDialog();
 
     void setSaleId(int saleId, DatabaseManager* dbManager);
+    void setSaleDetails(int saleId, const SaleDetails &details); // Reuses the rows of the previous sale
 
 private:
     Ui::SaleDetailDialog *ui;
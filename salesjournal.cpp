@@ -0,0 +1,203 @@
+#include "salesjournal.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QtEndian>
+#include <array>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint32 RecordMagic = 0x314A5350; // "PSJ1"
+const int HeaderSize = 12;
+const quint32 MaxPayloadSize = 16 * 1024 * 1024; // Anything bigger is a corrupt length field
+
+quint32 crc32(const QByteArray &data)
+{
+    static const std::array<quint32, 256> table = []() {
+        std::array<quint32, 256> t;
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (char ch : data) {
+        crc = table[(crc ^ static_cast<quint8>(ch)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+} // namespace
+
+SalesJournal::SalesJournal()
+{
+}
+
+SalesJournal::~SalesJournal()
+{
+    close();
+}
+
+bool SalesJournal::open(const QString &path)
+{
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Error: failed to open sales journal" << path << ":" << m_file.errorString();
+        return false;
+    }
+    m_file.seek(m_file.size());
+    return true;
+}
+
+void SalesJournal::close()
+{
+    if (m_file.isOpen()) {
+        sync();
+        m_file.close();
+    }
+}
+
+QList<PendingSale> SalesJournal::replay()
+{
+    QList<PendingSale> sales;
+    if (!m_file.isOpen()) {
+        return sales;
+    }
+
+    m_file.seek(0);
+    qint64 goodOffset = 0;
+    while (true) {
+        const QByteArray header = m_file.read(HeaderSize);
+        if (header.size() < HeaderSize) {
+            break;
+        }
+        const quint32 magic = qFromLittleEndian<quint32>(header.constData());
+        const quint32 length = qFromLittleEndian<quint32>(header.constData() + 4);
+        const quint32 checksum = qFromLittleEndian<quint32>(header.constData() + 8);
+        if (magic != RecordMagic || length > MaxPayloadSize) {
+            break;
+        }
+        const QByteArray payload = m_file.read(length);
+        if (payload.size() != static_cast<int>(length) || crc32(payload) != checksum) {
+            break;
+        }
+        PendingSale sale;
+        if (!decode(payload, &sale)) {
+            break;
+        }
+        sales.append(sale);
+        goodOffset = m_file.pos();
+    }
+
+    if (goodOffset < m_file.size()) {
+        qDebug() << "Sales journal: discarding" << m_file.size() - goodOffset << "bytes of incomplete tail";
+        m_file.resize(goodOffset);
+    }
+    m_file.seek(goodOffset);
+    return sales;
+}
+
+bool SalesJournal::append(const PendingSale &sale)
+{
+    const QByteArray payload = encode(sale);
+
+    char header[HeaderSize];
+    qToLittleEndian<quint32>(RecordMagic, header);
+    qToLittleEndian<quint32>(static_cast<quint32>(payload.size()), header + 4);
+    qToLittleEndian<quint32>(crc32(payload), header + 8);
+
+    // A single write keeps the record contiguous in the file
+    QByteArray record(header, HeaderSize);
+    record.append(payload);
+    if (m_file.write(record) != record.size()) {
+        qDebug() << "Error: failed to append to sales journal:" << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool SalesJournal::sync()
+{
+    if (!m_file.flush()) {
+        qDebug() << "Error: failed to flush sales journal:" << m_file.errorString();
+        return false;
+    }
+#ifdef Q_OS_WIN
+    const bool synced = _commit(m_file.handle()) == 0;
+#else
+    const bool synced = ::fsync(m_file.handle()) == 0;
+#endif
+    if (!synced) {
+        qDebug() << "Error: failed to sync sales journal to disk";
+    }
+    return synced;
+}
+
+bool SalesJournal::reset()
+{
+    if (!m_file.resize(0)) {
+        qDebug() << "Error: failed to truncate sales journal:" << m_file.errorString();
+        return false;
+    }
+    m_file.seek(0);
+    return sync();
+}
+
+qint64 SalesJournal::size() const
+{
+    return m_file.size();
+}
+
+QByteArray SalesJournal::encode(const PendingSale &sale)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << sale.uuid << sale.totalAmount << qint32(sale.userId) << qint32(sale.cart.size());
+    for (auto it = sale.cart.constBegin(); it != sale.cart.constEnd(); ++it) {
+        out << qint32(it.key()) << it.value().name << it.value().price << qint32(it.value().quantity);
+    }
+    out << sale.soldAt;
+    for (auto it = sale.cart.constBegin(); it != sale.cart.constEnd(); ++it) {
+        out << it.value().discount;
+    }
+    return payload;
+}
+
+bool SalesJournal::decode(const QByteArray &payload, PendingSale *sale)
+{
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_6_0);
+    qint32 userId = 0;
+    qint32 itemCount = 0;
+    in >> sale->uuid >> sale->totalAmount >> userId >> itemCount;
+    sale->userId = userId;
+    for (qint32 i = 0; i < itemCount && in.status() == QDataStream::Ok; ++i) {
+        qint32 productId = 0;
+        qint32 quantity = 0;
+        CartItem item;
+        in >> productId >> item.name >> item.price >> quantity;
+        item.quantity = quantity;
+        sale->cart.insert(productId, item);
+    }
+    if (!in.atEnd()) {
+        in >> sale->soldAt; // Records written before sales carried their time end here
+    }
+    if (!in.atEnd()) {
+        // Older records carry each line at its discounted price instead
+        for (auto it = sale->cart.begin(); it != sale->cart.end(); ++it) {
+            in >> it->discount;
+        }
+    }
+    return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,43 @@
+#ifndef SALESJOURNAL_H
+#define SALESJOURNAL_H
+
+#include <QFile>
+#include <QList>
+#include <QString>
+#include "pendingsale.h"
+
+// Append-only, crash-safe log of sales that have been accepted at the till but not yet
+// folded into the database. Each record is framed as
+//     [magic:u32][length:u32][crc32:u32][payload:length bytes]
+// so a torn write at the tail is detected on replay and cut off.
+class SalesJournal
+{
+public:
+    SalesJournal();
+    ~SalesJournal();
+
+    bool open(const QString &path);
+    void close();
+
+    // Reads every intact record and truncates anything after the last good one.
+    QList<PendingSale> replay();
+
+    // append() only buffers; call sync() once for a whole group of appends.
+    bool append(const PendingSale &sale);
+    bool sync();
+
+    // Drops every record; only safe once all of them are in the database.
+    bool reset();
+
+    qint64 size() const;
+
+    // Record payload format, also used to send sales to the store server
+    static QByteArray encode(const PendingSale &sale);
+    static bool decode(const QByteArray &payload, PendingSale *sale);
+
+private:
+
+    QFile m_file;
+};
+
+#endif // SALESJOURNAL_H
@@ -0,0 +1,206 @@
+#include "shadoweffect.h"
+#include <QGraphicsDropShadowEffect>
+#include <QPainter>
+#include <QPixmapCache>
+#include <QtMath>
+#include <qdrawutil.h>
+#include <vector>
+
+namespace {
+bool legacyShadows = qEnvironmentVariableIntValue("POS_LEGACY_SHADOWS") != 0;
+
+// Running-sum box blur of one row or column; three passes approximate a Gaussian
+void blurLine(uchar *line, int length, int step, int radius, std::vector<int> &buffer)
+{
+    const int window = 2 * radius + 1;
+    buffer.resize(length);
+    for (int i = 0; i < length; ++i) {
+        buffer[i] = line[i * step];
+    }
+    int sum = 0;
+    for (int i = 0; i < length + radius; ++i) {
+        if (i < length) sum += buffer[i];
+        if (i - window >= 0) sum -= buffer[i - window];
+        const int center = i - radius;
+        if (center >= 0) line[center * step] = uchar(sum / window);
+    }
+}
+
+QImage colorize(const QImage &alpha, const QColor &color)
+{
+    QImage shadow(alpha.size(), QImage::Format_ARGB32_Premultiplied);
+    shadow.fill(Qt::transparent);
+    QPainter painter(&shadow);
+    painter.drawImage(0, 0, alpha.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    painter.fillRect(shadow.rect(), color);
+    return shadow;
+}
+}
+
+ShadowEffect::ShadowEffect(QObject *parent) :
+    QGraphicsEffect(parent),
+    m_blurRadius(20),
+    m_offset(0, 0),
+    m_color(0, 0, 0, 60),
+    m_shape(RoundedRect),
+    m_cornerRadius(0)
+{
+}
+
+void ShadowEffect::setBlurRadius(qreal radius)
+{
+    m_blurRadius = qMax<qreal>(0, radius);
+    m_shapeShadow = QPixmap();
+    updateBoundingRect();
+}
+
+void ShadowEffect::setOffset(qreal dx, qreal dy)
+{
+    m_offset = QPointF(dx, dy);
+    updateBoundingRect();
+}
+
+void ShadowEffect::setColor(const QColor &color)
+{
+    m_color = color;
+    m_shapeShadow = QPixmap();
+    update();
+}
+
+void ShadowEffect::setShape(Shape shape)
+{
+    m_shape = shape;
+    update();
+}
+
+void ShadowEffect::setCornerRadius(qreal radius)
+{
+    m_cornerRadius = qMax<qreal>(0, radius);
+    update();
+}
+
+QRectF ShadowEffect::boundingRectFor(const QRectF &rect) const
+{
+    return rect.united(rect.translated(m_offset).adjusted(-m_blurRadius, -m_blurRadius, m_blurRadius, m_blurRadius));
+}
+
+void ShadowEffect::sourceChanged(ChangeFlags flags)
+{
+    if (flags & (SourceDetached | SourceBoundingRectChanged)) {
+        m_shapeShadow = QPixmap();
+    }
+}
+
+void ShadowEffect::draw(QPainter *painter)
+{
+    const int radius = qRound(m_blurRadius);
+    if (radius <= 0 || m_color.alpha() == 0) {
+        drawSource(painter);
+        return;
+    }
+
+    const QRect bounds = sourceBoundingRect(Qt::LogicalCoordinates).toAlignedRect();
+    if (m_shape == RoundedRect) {
+        const int corner = qRound(m_cornerRadius);
+        const int margin = 2 * radius + corner;
+        const QRect target = bounds.translated(m_offset.toPoint()).adjusted(-radius, -radius, radius, radius);
+        qDrawBorderPixmap(painter, target, QMargins(margin, margin, margin, margin), ninePatch(radius, corner, m_color));
+    } else {
+        if (m_shapeShadow.isNull() || bounds.size() != m_shapeSize) {
+            // Only the widget's alpha matters, so this offscreen render happens once per size
+            QPoint origin;
+            const QPixmap source = sourcePixmap(Qt::LogicalCoordinates, &origin, QGraphicsEffect::NoPad);
+            const qreal dpr = source.devicePixelRatio();
+            const int pad = qCeil(radius * dpr);
+            QImage sourceImage = source.toImage();
+            sourceImage.setDevicePixelRatio(1);
+            QImage alpha(sourceImage.width() + 2 * pad, sourceImage.height() + 2 * pad, QImage::Format_ARGB32_Premultiplied);
+            alpha.fill(Qt::transparent);
+            {
+                QPainter alphaPainter(&alpha);
+                alphaPainter.drawImage(pad, pad, sourceImage);
+            }
+            QImage shadow = colorize(blurredAlpha(alpha, pad), m_color);
+            shadow.setDevicePixelRatio(dpr);
+            m_shapeShadow = QPixmap::fromImage(shadow);
+            m_shapeOrigin = origin - QPoint(radius, radius);
+            m_shapeSize = bounds.size();
+        }
+        painter->drawPixmap(m_shapeOrigin + m_offset.toPoint(), m_shapeShadow);
+    }
+    drawSource(painter);
+}
+
+QPixmap ShadowEffect::ninePatch(int blurRadius, int cornerRadius, const QColor &color)
+{
+    const QString key = QString("shadow-%1-%2-%3").arg(blurRadius).arg(cornerRadius).arg(color.rgba(), 8, 16, QLatin1Char('0'));
+    QPixmap pixmap;
+    if (QPixmapCache::find(key, &pixmap)) {
+        return pixmap;
+    }
+
+    // The smallest rounded rect whose blurred corners fit in the margins, plus a
+    // one-pixel middle row and column that get stretched to the widget's size
+    const int margin = 2 * blurRadius + cornerRadius;
+    const int side = 2 * margin + 1;
+    QImage alpha(side, side, QImage::Format_ARGB32_Premultiplied);
+    alpha.fill(Qt::transparent);
+    {
+        QPainter painter(&alpha);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(Qt::black);
+        painter.drawRoundedRect(QRectF(blurRadius, blurRadius, side - 2 * blurRadius, side - 2 * blurRadius),
+                                cornerRadius, cornerRadius);
+    }
+    pixmap = QPixmap::fromImage(colorize(blurredAlpha(alpha, blurRadius), color));
+    QPixmapCache::insert(key, pixmap);
+    return pixmap;
+}
+
+QImage ShadowEffect::blurredAlpha(const QImage &source, int blurRadius)
+{
+    // Three box passes of a third of the radius each reach out blurRadius pixels
+    QImage image = source.convertToFormat(QImage::Format_Alpha8);
+    const int boxRadius = qMax(1, blurRadius / 3);
+    std::vector<int> buffer;
+    for (int pass = 0; pass < 3; ++pass) {
+        for (int y = 0; y < image.height(); ++y) {
+            blurLine(image.scanLine(y), image.width(), 1, boxRadius, buffer);
+        }
+        for (int x = 0; x < image.width(); ++x) {
+            blurLine(image.bits() + x, image.height(), int(image.bytesPerLine()), boxRadius, buffer);
+        }
+    }
+    return image;
+}
+
+QGraphicsEffect *ShadowEffect::create(qreal blurRadius, qreal dx, qreal dy, const QColor &color, Shape shape,
+                                      qreal cornerRadius, QObject *parent)
+{
+    if (legacyShadows) {
+        auto *legacy = new QGraphicsDropShadowEffect(parent);
+        legacy->setBlurRadius(blurRadius);
+        legacy->setOffset(dx, dy);
+        legacy->setColor(color);
+        return legacy;
+    }
+    auto *effect = new ShadowEffect(parent);
+    effect->setBlurRadius(blurRadius);
+    effect->setOffset(dx, dy);
+    effect->setColor(color);
+    effect->setShape(shape);
+    effect->setCornerRadius(cornerRadius);
+    return effect;
+}
+
+void ShadowEffect::setLegacy(bool legacy)
+{
+    legacyShadows = legacy;
+}
+
+bool ShadowEffect::isLegacy()
+{
+    return legacyShadows;
+}
@@ -0,0 +1,57 @@
+#ifndef SHADOWEFFECT_H
+#define SHADOWEFFECT_H
+
+#include <QColor>
+#include <QGraphicsEffect>
+#include <QPixmap>
+
+// Drop shadow that is blurred once and then only composited. QGraphicsDropShadowEffect
+// renders its widget offscreen and re-blurs it on every repaint; this effect paints the
+// widget straight through and draws a cached shadow behind it:
+//  - RoundedRect (cards, frames): one nine-patch per radius/corner/colour, shared by
+//    every widget and stretched to any size.
+//  - Alpha (e.g. a logo with transparency): follows the widget's alpha, rendered once
+//    per widget size.
+// Set POS_LEGACY_SHADOWS=1 (or setLegacy()) to get QGraphicsDropShadowEffect back
+// from create() for comparison; see also --paint-benchmark.
+class ShadowEffect : public QGraphicsEffect
+{
+    Q_OBJECT
+
+public:
+    enum Shape { RoundedRect, Alpha };
+
+    explicit ShadowEffect(QObject *parent = nullptr);
+
+    void setBlurRadius(qreal radius);
+    void setOffset(qreal dx, qreal dy);
+    void setColor(const QColor &color);
+    void setShape(Shape shape);
+    void setCornerRadius(qreal radius); // RoundedRect only; match the widget's border-radius
+
+    QRectF boundingRectFor(const QRectF &rect) const override;
+
+    static QGraphicsEffect *create(qreal blurRadius, qreal dx, qreal dy, const QColor &color, Shape shape = RoundedRect,
+                                   qreal cornerRadius = 0, QObject *parent = nullptr);
+    static void setLegacy(bool legacy);
+    static bool isLegacy();
+
+protected:
+    void draw(QPainter *painter) override;
+    void sourceChanged(ChangeFlags flags) override;
+
+private:
+    static QPixmap ninePatch(int blurRadius, int cornerRadius, const QColor &color);
+    static QImage blurredAlpha(const QImage &source, int blurRadius);
+
+    qreal m_blurRadius;
+    QPointF m_offset;
+    QColor m_color;
+    Shape m_shape;
+    qreal m_cornerRadius;
+    QPixmap m_shapeShadow; // Alpha mode: shadow for m_shapeSize
+    QSize m_shapeSize;
+    QPoint m_shapeOrigin; // Where m_shapeShadow goes, relative to the widget
+};
+
+#endif // SHADOWEFFECT_H
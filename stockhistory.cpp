@@ -0,0 +1,46 @@
+#include "stockhistory.h"
+#include "databasemanager.h"
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <algorithm>
+
+int runStockAt(const QString &databasePath, const QString &when)
+{
+    QTextStream out(stdout);
+    QDateTime moment = QDateTime::fromString(when, Qt::ISODate);
+    if (!moment.isValid()) {
+        const QDate day = QDate::fromString(when, Qt::ISODate);
+        if (!day.isValid()) {
+            out << "Not a date or date and time: " << when << "\n";
+            return 1;
+        }
+        moment = QDateTime(day, QTime(23, 59, 59));
+    }
+
+    DatabaseManager dbManager("stock-history", databasePath);
+    dbManager.init();
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = false;
+    const QHash<int, int> stock = dbManager.getStockAt(moment, 0, &ok);
+    if (!ok) {
+        out << "No stock history for " << moment.toString(Qt::ISODate) << "\n";
+        return 1;
+    }
+
+    // Names come from the current catalog; deleted products show by id
+    QHash<int, QString> names;
+    for (const Product &product : dbManager.getAllProducts()) {
+        names.insert(product.id, product.name);
+    }
+    QList<int> ids = stock.keys();
+    std::sort(ids.begin(), ids.end());
+
+    out << "On hand at " << moment.toString(Qt::ISODate) << " (" << timer.elapsed() << " ms)\n";
+    for (int id : std::as_const(ids)) {
+        if (stock.value(id) == 0) continue;
+        const QString name = names.value(id);
+        out << QString("  %1  %2\n").arg(stock.value(id), 6).arg(name.isEmpty() ? QString("Product #%1").arg(id) : name);
+    }
+    return 0;
+}
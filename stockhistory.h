@@ -0,0 +1,12 @@
+#ifndef STOCKHISTORY_H
+#define STOCKHISTORY_H
+
+#include <QString>
+
+// Prints what was on hand at a moment in the past, from the stock movement ledger:
+// the nearest earlier snapshot plus the movements between it and that moment. when
+// is an ISO date (meaning the end of that day, local time) or date and time.
+// Returns a process exit code. Started with --stock-at <when>.
+int runStockAt(const QString &databasePath, const QString &when);
+
+#endif // STOCKHISTORY_H
@@ -0,0 +1,122 @@
+#include "stockledger.h"
+
+StockLedger::StockLedger() :
+    m_table(std::make_shared<Table>())
+{
+}
+
+void StockLedger::seed(const QList<Product> &products)
+{
+    QMutexLocker locker(&m_seedMutex);
+    const std::shared_ptr<const Table> current = std::atomic_load(&m_table);
+
+    auto next = std::make_shared<Table>();
+    next->reserve(products.size());
+    for (const auto &product : products) {
+        std::shared_ptr<Counter> c = current->value(product.id);
+        if (!c) {
+            c = std::make_shared<Counter>();
+        }
+        // Keep whatever carts are holding; only the on-hand side comes from the database
+        quint64 state = c->state.load();
+        while (!c->state.compare_exchange_weak(state, pack(product.quantity, heldOf(state)))) {
+        }
+        next->insert(product.id, c);
+    }
+
+    std::atomic_store(&m_table, std::shared_ptr<const Table>(std::move(next)));
+}
+
+bool StockLedger::reserve(int productId, int quantity)
+{
+    const std::shared_ptr<Counter> c = counter(productId);
+    if (!c) {
+        return false;
+    }
+
+    quint64 state = c->state.load();
+    do {
+        if (onHandOf(state) - heldOf(state) < quantity) {
+            return false;
+        }
+    } while (!c->state.compare_exchange_weak(state, pack(onHandOf(state), heldOf(state) + quantity)));
+    return true;
+}
+
+void StockLedger::hold(int productId, int quantity)
+{
+    const std::shared_ptr<Counter> c = counter(productId);
+    if (!c) {
+        return;
+    }
+
+    quint64 state = c->state.load();
+    while (!c->state.compare_exchange_weak(state, pack(onHandOf(state), heldOf(state) + quantity))) {
+    }
+}
+
+void StockLedger::release(int productId, int quantity)
+{
+    const std::shared_ptr<Counter> c = counter(productId);
+    if (!c) {
+        return;
+    }
+
+    quint64 state = c->state.load();
+    while (!c->state.compare_exchange_weak(state, pack(onHandOf(state), qMax(0, heldOf(state) - quantity)))) {
+    }
+}
+
+void StockLedger::applied(int productId, int quantity)
+{
+    const std::shared_ptr<Counter> c = counter(productId);
+    if (!c) {
+        return;
+    }
+
+    quint64 state = c->state.load();
+    while (!c->state.compare_exchange_weak(state, pack(onHandOf(state) - quantity, qMax(0, heldOf(state) - quantity)))) {
+    }
+}
+
+void StockLedger::taken(int productId, int quantity)
+{
+    const std::shared_ptr<Counter> c = counter(productId);
+    if (!c) {
+        return;
+    }
+
+    quint64 state = c->state.load();
+    while (!c->state.compare_exchange_weak(state, pack(onHandOf(state) - quantity, heldOf(state)))) {
+    }
+}
+
+int StockLedger::available(int productId) const
+{
+    const std::shared_ptr<Counter> c = counter(productId);
+    if (!c) {
+        return 0;
+    }
+    const quint64 state = c->state.load();
+    return onHandOf(state) - heldOf(state);
+}
+
+quint64 StockLedger::pack(qint32 onHand, qint32 held)
+{
+    return (quint64(quint32(onHand)) << 32) | quint32(held);
+}
+
+qint32 StockLedger::onHandOf(quint64 state)
+{
+    return qint32(quint32(state >> 32));
+}
+
+qint32 StockLedger::heldOf(quint64 state)
+{
+    return qint32(quint32(state));
+}
+
+std::shared_ptr<StockLedger::Counter> StockLedger::counter(int productId) const
+{
+    return std::atomic_load(&m_table)->value(productId);
+}
@@ -0,0 +1,57 @@
+#ifndef STOCKLEDGER_H
+#define STOCKLEDGER_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <atomic>
+#include <memory>
+#include "product.h"
+
+// In-memory view of sellable stock, seeded from Products. Each product has one atomic
+// word holding both the on-hand quantity and the quantity held by carts and sales that
+// have not reached the database yet, so reserving is a single lock-free compare-and-swap
+// and two carts sharing one ledger can never both take the last unit. A ledger covers
+// one process only: each GUI lane keeps its own, so it stops a lane overselling its own
+// view of the stock, and only the store server's ledger is shared by all its clients.
+//
+// The database stays authoritative: insertSaleRecords refuses to take stock below zero,
+// which is what stops two lanes from selling the same last unit, and the ledger is
+// re-seeded whenever the catalog is reloaded.
+class StockLedger
+{
+public:
+    StockLedger();
+
+    // Replaces on-hand quantities; holds on products that still exist are kept.
+    void seed(const QList<Product> &products);
+
+    bool reserve(int productId, int quantity);
+    // Records a hold that the store server's ledger has already granted, even if this
+    // copy, seeded earlier, shows less on hand.
+    void hold(int productId, int quantity);
+    void release(int productId, int quantity);
+    // The held quantity has been written to Products; drop it from both sides.
+    void applied(int productId, int quantity);
+    // Stock that was sold without a hold has been written to Products.
+    void taken(int productId, int quantity);
+
+    int available(int productId) const;
+
+private:
+    struct Counter {
+        std::atomic<quint64> state{0}; // High 32 bits: on hand, low 32 bits: held
+    };
+    using Table = QHash<int, std::shared_ptr<Counter>>;
+
+    static quint64 pack(qint32 onHand, qint32 held);
+    static qint32 onHandOf(quint64 state);
+    static qint32 heldOf(quint64 state);
+
+    std::shared_ptr<Counter> counter(int productId) const;
+
+    std::shared_ptr<const Table> m_table; // Swapped atomically on seed()
+    QMutex m_seedMutex; // Serialises seed(); readers never take it
+};
+
+#endif // STOCKLEDGER_H
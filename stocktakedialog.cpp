@@ -0,0 +1,247 @@
+#include "stocktakedialog.h"
+#include <QComboBox>
+#include <QCompleter>
+#include <QDialogButtonBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QStandardItemModel>
+#include <QTableView>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+StockTakeDialog::StockTakeDialog(DatabaseManager *dbManager, const QList<Product> &products, QWidget *parent) :
+    QDialog(parent),
+    m_dbManager(dbManager),
+    m_changed(0),
+    m_updating(false)
+{
+    setWindowTitle(tr("Stock-Take / Receiving"));
+    resize(720, 560);
+
+    QStringList names;
+    names.reserve(products.size());
+    for (const Product &product : products) {
+        m_products.insert(product.id, product);
+        m_productsByName.insert(product.name.toLower(), product.id);
+        names.append(product.name);
+    }
+
+    m_modeCombo = new QComboBox(this);
+    m_modeCombo->addItems({tr("Stock-take"), tr("Receiving")});
+    m_entryEdit = new QLineEdit(this);
+    m_entryEdit->setPlaceholderText(tr("Scan or type a product id or name"));
+    auto *completer = new QCompleter(names, m_entryEdit);
+    completer->setCaseSensitivity(Qt::CaseInsensitive);
+    completer->setFilterMode(Qt::MatchContains);
+    m_entryEdit->setCompleter(completer);
+    m_quantitySpin = new QSpinBox(this);
+    m_quantitySpin->setRange(0, 999999);
+    m_quantitySpin->setValue(1);
+    auto *addButton = new QPushButton(tr("Add"), this);
+    auto *removeButton = new QPushButton(tr("Remove Line"), this);
+
+    m_model = new QStandardItemModel(0, ColumnCount, this);
+    m_view = new QTableView(this);
+    m_view->setModel(m_model);
+    m_view->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_view->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+    m_view->verticalHeader()->hide();
+    m_view->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_view->horizontalHeader()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+
+    m_reasonEdit = new QLineEdit(this);
+    m_summaryLabel = new QLabel(this);
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Cancel, this);
+    m_applyButton = buttons->addButton(tr("Apply"), QDialogButtonBox::AcceptRole);
+    m_applyButton->setAutoDefault(false); // Enter in the entry field adds a line, not the batch
+
+    auto *entryLayout = new QHBoxLayout;
+    entryLayout->addWidget(m_modeCombo);
+    entryLayout->addWidget(m_entryEdit, 1);
+    entryLayout->addWidget(new QLabel(tr("Qty:"), this));
+    entryLayout->addWidget(m_quantitySpin);
+    entryLayout->addWidget(addButton);
+    auto *reasonLayout = new QHBoxLayout;
+    reasonLayout->addWidget(new QLabel(tr("Reason:"), this));
+    reasonLayout->addWidget(m_reasonEdit, 1);
+    reasonLayout->addWidget(removeButton);
+    auto *layout = new QVBoxLayout(this);
+    layout->addLayout(entryLayout);
+    layout->addWidget(m_view);
+    layout->addLayout(reasonLayout);
+    layout->addWidget(m_summaryLabel);
+    layout->addWidget(buttons);
+
+    connect(m_entryEdit, &QLineEdit::returnPressed, this, &StockTakeDialog::addEntry);
+    connect(addButton, &QPushButton::clicked, this, &StockTakeDialog::addEntry);
+    connect(removeButton, &QPushButton::clicked, this, &StockTakeDialog::removeSelected);
+    connect(m_modeCombo, &QComboBox::currentIndexChanged, this, &StockTakeDialog::setMode);
+    connect(m_model, &QStandardItemModel::itemChanged, this, &StockTakeDialog::onItemChanged);
+    connect(buttons, &QDialogButtonBox::accepted, this, &StockTakeDialog::apply);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    setMode(0);
+    m_entryEdit->setFocus();
+}
+
+DatabaseManager::StockBatchMode StockTakeDialog::mode() const
+{
+    return m_modeCombo->currentIndex() == 0 ? DatabaseManager::StockTake : DatabaseManager::Receiving;
+}
+
+void StockTakeDialog::setMode(int index)
+{
+    const bool stockTake = (index == 0);
+    m_model->setHorizontalHeaderLabels({tr("Product"), tr("Expected"),
+                                        stockTake ? tr("Counted") : tr("Received"),
+                                        stockTake ? tr("Variance") : tr("After")});
+    m_reasonEdit->setPlaceholderText(stockTake ? tr("Stock-take") : tr("Delivery"));
+    updateSummary();
+}
+
+const Product *StockTakeDialog::findProduct(const QString &text) const
+{
+    bool isId = false;
+    const int id = text.toInt(&isId);
+    auto it = m_products.constFind(isId ? id : m_productsByName.value(text.toLower(), -1));
+    return it == m_products.constEnd() ? nullptr : &it.value();
+}
+
+void StockTakeDialog::addEntry()
+{
+    const QString text = m_entryEdit->text().trimmed();
+    if (text.isEmpty()) return;
+
+    const Product *product = findProduct(text);
+    if (!product) {
+        m_summaryLabel->setText(tr("No product matches \"%1\"").arg(text));
+        m_entryEdit->selectAll();
+        return;
+    }
+
+    // Scanning the same product again adds to its line, so items can be counted one by one
+    m_batch[product->id] += m_quantitySpin->value();
+    if (!m_rows.contains(product->id)) {
+        QList<QStandardItem*> row;
+        for (int column = 0; column < ColumnCount; ++column) {
+            auto *item = new QStandardItem;
+            item->setEditable(column == QuantityColumn);
+            if (column != NameColumn) {
+                item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            }
+            row.append(item);
+        }
+        row[NameColumn]->setData(product->id, Qt::UserRole);
+        m_rows.insert(product->id, row);
+        m_model->appendRow(row);
+    }
+    updateRow(product->id);
+    m_view->scrollTo(m_rows.value(product->id).first()->index());
+    updateSummary();
+
+    m_entryEdit->clear();
+    m_quantitySpin->setValue(1);
+    m_modeCombo->setEnabled(false); // The batch means one thing or the other
+}
+
+void StockTakeDialog::removeSelected()
+{
+    const QModelIndexList selected = m_view->selectionModel()->selectedRows();
+    QList<int> rows;
+    for (const QModelIndex &index : selected) {
+        rows.append(index.row());
+    }
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    for (int row : std::as_const(rows)) {
+        const int productId = m_model->item(row, NameColumn)->data(Qt::UserRole).toInt();
+        m_batch.remove(productId);
+        m_rows.remove(productId);
+        m_model->removeRow(row);
+    }
+    m_modeCombo->setEnabled(m_batch.isEmpty());
+    updateSummary();
+}
+
+void StockTakeDialog::onItemChanged(QStandardItem *item)
+{
+    if (m_updating || item->column() != QuantityColumn) return;
+
+    const int productId = m_model->item(item->row(), NameColumn)->data(Qt::UserRole).toInt();
+    bool ok = false;
+    const int quantity = item->text().toInt(&ok);
+    if (ok && quantity >= 0) {
+        m_batch[productId] = quantity;
+    }
+    updateRow(productId); // Also puts back the previous value after a bad edit
+    updateSummary();
+}
+
+void StockTakeDialog::updateRow(int productId)
+{
+    const QList<QStandardItem*> row = m_rows.value(productId);
+    if (row.isEmpty()) return;
+
+    const Product &product = m_products[productId];
+    const int quantity = m_batch.value(productId);
+    m_updating = true;
+    row[NameColumn]->setText(product.name);
+    row[ExpectedColumn]->setText(QString::number(product.quantity));
+    row[QuantityColumn]->setText(QString::number(quantity));
+    if (mode() == DatabaseManager::StockTake) {
+        const int variance = quantity - product.quantity;
+        row[ResultColumn]->setText(variance > 0 ? QString("+%1").arg(variance) : QString::number(variance));
+    } else {
+        row[ResultColumn]->setText(QString::number(product.quantity + quantity));
+    }
+    m_updating = false;
+}
+
+void StockTakeDialog::updateSummary()
+{
+    m_applyButton->setEnabled(!m_batch.isEmpty());
+    if (m_batch.isEmpty()) {
+        m_summaryLabel->setText(tr("No lines yet"));
+        return;
+    }
+
+    if (mode() == DatabaseManager::Receiving) {
+        int units = 0;
+        for (int quantity : std::as_const(m_batch)) {
+            units += quantity;
+        }
+        m_summaryLabel->setText(tr("%1 product(s), %2 unit(s) received").arg(m_batch.size()).arg(units));
+        return;
+    }
+
+    int over = 0;
+    int under = 0;
+    double value = 0.0;
+    for (auto it = m_batch.constBegin(); it != m_batch.constEnd(); ++it) {
+        const Product &product = m_products[it.key()];
+        const int variance = it.value() - product.quantity;
+        if (variance > 0) over += variance;
+        else under -= variance;
+        value += variance * product.price;
+    }
+    m_summaryLabel->setText(tr("%1 product(s) counted: %2 unit(s) over, %3 short, net $%4")
+                                .arg(m_batch.size()).arg(over).arg(under).arg(value, 0, 'f', 2));
+}
+
+void StockTakeDialog::apply()
+{
+    if (m_batch.isEmpty()) return;
+
+    const QString reason = m_reasonEdit->text().trimmed().isEmpty() ? m_reasonEdit->placeholderText()
+                                                                    : m_reasonEdit->text().trimmed();
+    if (!m_dbManager->applyStockBatch(m_batch, mode(), reason, &m_changed)) {
+        QMessageBox::warning(this, tr("Error"), tr("The batch could not be applied; nothing was changed."));
+        return;
+    }
+    accept();
+}
@@ -0,0 +1,60 @@
+#ifndef STOCKTAKEDIALOG_H
+#define STOCKTAKEDIALOG_H
+
+#include <QDialog>
+#include <QHash>
+#include "databasemanager.h"
+
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
+class QSpinBox;
+class QStandardItem;
+class QStandardItemModel;
+class QTableView;
+
+// Stock-take and receiving screen. Products are scanned or typed (by id or name)
+// into a batch held in memory, shown against the stock the catalog expects, and
+// the whole batch is written in one transaction when it is applied. Nothing
+// touches the database before then, so a count can be abandoned at any point.
+class StockTakeDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    StockTakeDialog(DatabaseManager *dbManager, const QList<Product> &products, QWidget *parent = nullptr);
+
+    int changedProducts() const { return m_changed; } // After the batch was applied
+
+private:
+    enum Column { NameColumn, ExpectedColumn, QuantityColumn, ResultColumn, ColumnCount };
+
+    void addEntry();
+    void removeSelected();
+    void setMode(int index);
+    void onItemChanged(QStandardItem *item);
+    void updateRow(int productId);
+    void updateSummary();
+    void apply();
+    const Product *findProduct(const QString &text) const;
+    DatabaseManager::StockBatchMode mode() const;
+
+    DatabaseManager *m_dbManager;
+    QHash<int, Product> m_products; // Catalog as of opening, by id
+    QHash<QString, int> m_productsByName; // Lower-case name to id
+    QHash<int, int> m_batch; // Counted or received quantity, by product id
+    QHash<int, QList<QStandardItem*>> m_rows; // Table row, by product id
+    QComboBox *m_modeCombo;
+    QLineEdit *m_entryEdit;
+    QSpinBox *m_quantitySpin;
+    QStandardItemModel *m_model;
+    QTableView *m_view;
+    QLineEdit *m_reasonEdit;
+    QLabel *m_summaryLabel;
+    QPushButton *m_applyButton;
+    int m_changed;
+    bool m_updating; // Set while rows are filled in, so item changes are not read back
+};
+
+#endif // STOCKTAKEDIALOG_H
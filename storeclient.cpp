@@ -0,0 +1,302 @@
+#include "storeclient.h"
+#include "salesjournal.h"
+#include <QDebug>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QUuid>
+#include <functional>
+
+namespace {
+QByteArray encodeArguments(const std::function<void(QDataStream &)> &write)
+{
+    QByteArray arguments;
+    QDataStream out(&arguments, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    write(out);
+    return arguments;
+}
+
+bool readBool(const StoreProtocol::Reply &reply)
+{
+    if (reply.status != StoreProtocol::Ok) {
+        return false;
+    }
+    QDataStream in(reply.body);
+    in.setVersion(QDataStream::Qt_6_0);
+    bool value = false;
+    in >> value;
+    return in.status() == QDataStream::Ok && value;
+}
+}
+
+StoreClient::StoreClient(QObject *parent) :
+    QObject(parent),
+    m_socket(nullptr),
+    m_nextRequestId(1)
+{
+}
+
+StoreClient::~StoreClient()
+{
+    onDisconnected(); // Fail anything still waiting
+}
+
+bool StoreClient::connectToServer(const QString &address, int timeoutMs)
+{
+    const int colon = address.lastIndexOf(':');
+    bool isPort = false;
+    const int port = colon > 0 ? address.mid(colon + 1).toInt(&isPort) : 0;
+    if (isPort) {
+        auto *socket = new QTcpSocket(this);
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        socket->connectToHost(address.left(colon), quint16(port));
+        if (!socket->waitForConnected(timeoutMs)) {
+            m_errorString = socket->errorString();
+            delete socket;
+            return false;
+        }
+        connect(socket, &QTcpSocket::disconnected, this, &StoreClient::onDisconnected);
+        m_socket = socket;
+    } else {
+        auto *socket = new QLocalSocket(this);
+        socket->connectToServer(address);
+        if (!socket->waitForConnected(timeoutMs)) {
+            m_errorString = socket->errorString();
+            delete socket;
+            return false;
+        }
+        connect(socket, &QLocalSocket::disconnected, this, &StoreClient::onDisconnected);
+        m_socket = socket;
+    }
+    connect(m_socket, &QIODevice::readyRead, this, &StoreClient::onReadyRead);
+    return true;
+}
+
+bool StoreClient::isConnected() const
+{
+    return m_socket && m_socket->isOpen();
+}
+
+QString StoreClient::errorString() const
+{
+    return m_errorString;
+}
+
+QFuture<StoreProtocol::Reply> StoreClient::call(StoreProtocol::Opcode opcode, const QByteArray &arguments)
+{
+    QPromise<StoreProtocol::Reply> promise;
+    QFuture<StoreProtocol::Reply> future = promise.future();
+    promise.start();
+    if (!isConnected()) {
+        promise.addResult(StoreProtocol::Reply());
+        promise.finish();
+        return future;
+    }
+
+    const quint32 requestId = m_nextRequestId++;
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << requestId << quint8(opcode);
+    payload.append(arguments);
+
+    m_pending.emplace(requestId, std::move(promise));
+    m_socket->write(StoreProtocol::frame(payload));
+    return future;
+}
+
+QFuture<bool> StoreClient::reserveStockAsync(int productId, int quantity)
+{
+    const QByteArray arguments = encodeArguments([&](QDataStream &out) {
+        out << qint32(productId) << qint32(quantity);
+    });
+    return call(StoreProtocol::ReserveStock, arguments).then(readBool);
+}
+
+QFuture<bool> StoreClient::submitSaleAsync(const PendingSale &sale)
+{
+    const QByteArray arguments = encodeArguments([&](QDataStream &out) {
+        out << SalesJournal::encode(sale);
+    });
+    return call(StoreProtocol::SubmitSale, arguments).then(readBool);
+}
+
+void StoreClient::onReadyRead()
+{
+    m_buffer.append(m_socket->readAll());
+
+    QByteArray payload;
+    bool error = false;
+    while (StoreProtocol::takeFrame(m_buffer, &payload, &error)) {
+        QDataStream in(payload);
+        in.setVersion(QDataStream::Qt_6_0);
+        quint32 requestId = 0;
+        StoreProtocol::Reply reply;
+        in >> requestId >> reply.status;
+        reply.body = payload.mid(5); // After id:u32 and status:u8
+
+        auto it = m_pending.find(requestId);
+        if (it == m_pending.end()) {
+            qDebug() << "Error: store server replied to unknown request" << requestId;
+            continue;
+        }
+        QPromise<StoreProtocol::Reply> promise = std::move(it->second);
+        m_pending.erase(it);
+        promise.addResult(reply);
+        promise.finish();
+    }
+    if (error) {
+        m_errorString = tr("Oversized frame from store server");
+        m_socket->close();
+        onDisconnected();
+    }
+}
+
+void StoreClient::onDisconnected()
+{
+    for (auto &entry : m_pending) {
+        entry.second.addResult(StoreProtocol::Reply());
+        entry.second.finish();
+    }
+    m_pending.clear();
+}
+
+bool StoreClient::waitForReadyRead(int timeoutMs)
+{
+    return isConnected() && m_socket->waitForReadyRead(timeoutMs);
+}
+
+bool StoreClient::request(StoreProtocol::Opcode opcode, const QByteArray &arguments, QByteArray *body)
+{
+    const QFuture<StoreProtocol::Reply> future = call(opcode, arguments);
+    if (!waitFor(future)) {
+        m_errorString = tr("Timed out waiting for the store server");
+        return false;
+    }
+    const StoreProtocol::Reply reply = future.result();
+    if (reply.status != StoreProtocol::Ok) {
+        return false;
+    }
+    *body = reply.body;
+    return true;
+}
+
+QList<Product> StoreClient::getAllProducts()
+{
+    QList<Product> products;
+    QByteArray body;
+    if (request(StoreProtocol::GetAllProducts, QByteArray(), &body)) {
+        QDataStream in(body);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> products;
+    }
+    return products;
+}
+
+Product StoreClient::getProductById(int id)
+{
+    Product product = { -1, QString(), 0.0, 0, QString() };
+    QByteArray body;
+    const QByteArray arguments = encodeArguments([&](QDataStream &out) { out << qint32(id); });
+    if (request(StoreProtocol::GetProductById, arguments, &body)) {
+        QDataStream in(body);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> product;
+    }
+    return product;
+}
+
+bool StoreClient::reserveStock(int productId, int quantity)
+{
+    const QFuture<bool> future = reserveStockAsync(productId, quantity);
+    return waitFor(future) && future.result();
+}
+
+void StoreClient::releaseStock(int productId, int quantity)
+{
+    QByteArray body;
+    const QByteArray arguments = encodeArguments([&](QDataStream &out) {
+        out << qint32(productId) << qint32(quantity);
+    });
+    request(StoreProtocol::ReleaseStock, arguments, &body);
+}
+
+bool StoreClient::processSale(const QMap<int, CartItem> &cart, double totalAmount, int userId, const QString &saleUuid)
+{
+    PendingSale sale;
+    sale.uuid = saleUuid.isEmpty() ? QUuid::createUuid().toString(QUuid::WithoutBraces) : saleUuid;
+    sale.cart = cart;
+    sale.totalAmount = totalAmount;
+    sale.userId = userId;
+    sale.soldAt = QDateTime::currentDateTimeUtc();
+    const QFuture<bool> future = submitSaleAsync(sale);
+    return waitFor(future) && future.result();
+}
+
+bool StoreClient::isSaleCommitted(const QString &saleUuid)
+{
+    const QByteArray arguments = encodeArguments([&](QDataStream &out) { out << saleUuid; });
+    const QFuture<bool> future = call(StoreProtocol::IsSaleCommitted, arguments).then(readBool);
+    return waitFor(future) && future.result();
+}
+
+QList<SaleDetailItem> StoreClient::getSaleDetails(int saleId)
+{
+    QList<SaleDetailItem> details;
+    QByteArray body;
+    const QByteArray arguments = encodeArguments([&](QDataStream &out) { out << qint32(saleId); });
+    if (request(StoreProtocol::GetSaleDetails, arguments, &body)) {
+        QDataStream in(body);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> details;
+    }
+    return details;
+}
+
+double StoreClient::getTotalRevenue()
+{
+    double revenue = 0.0;
+    QByteArray body;
+    if (request(StoreProtocol::GetTotalRevenue, QByteArray(), &body)) {
+        QDataStream in(body);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> revenue;
+    }
+    return revenue;
+}
+
+int StoreClient::getSalesCountForToday()
+{
+    qint32 count = 0;
+    QByteArray body;
+    if (request(StoreProtocol::GetSalesCountForToday, QByteArray(), &body)) {
+        QDataStream in(body);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> count;
+    }
+    return count;
+}
+
+int StoreClient::getSalesCountForThisMonth()
+{
+    qint32 count = 0;
+    QByteArray body;
+    if (request(StoreProtocol::GetSalesCountForThisMonth, QByteArray(), &body)) {
+        QDataStream in(body);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> count;
+    }
+    return count;
+}
+
+QString StoreClient::getTopSellingProduct()
+{
+    QString name = "N/A";
+    QByteArray body;
+    if (request(StoreProtocol::GetTopSellingProduct, QByteArray(), &body)) {
+        QDataStream in(body);
+        in.setVersion(QDataStream::Qt_6_0);
+        in >> name;
+    }
+    return name;
+}
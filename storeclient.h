@@ -0,0 +1,82 @@
+#ifndef STORECLIENT_H
+#define STORECLIENT_H
+
+#include <QFuture>
+#include <QObject>
+#include <QPromise>
+#include <unordered_map>
+#include "databasemanager.h"
+#include "pendingsale.h"
+#include "storeprotocol.h"
+
+class QIODevice;
+
+// Talks to a StoreServer. The async calls write the request and return at once, so
+// many requests can be in flight on one connection; their futures complete as the
+// responses arrive (while waitFor() or the event loop reads the socket). The blocking
+// methods mirror DatabaseManager's names and return types so callers can switch over
+// with little change. All calls must come from the thread that owns the client.
+class StoreClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultTimeoutMs = 5000;
+
+    explicit StoreClient(QObject *parent = nullptr);
+    ~StoreClient();
+
+    // "host:port" connects over TCP; anything else is a local socket name.
+    bool connectToServer(const QString &address, int timeoutMs = DefaultTimeoutMs);
+    bool isConnected() const;
+    QString errorString() const;
+
+    // Pipelined requests
+    QFuture<StoreProtocol::Reply> call(StoreProtocol::Opcode opcode, const QByteArray &arguments = QByteArray());
+    QFuture<bool> reserveStockAsync(int productId, int quantity);
+    QFuture<bool> submitSaleAsync(const PendingSale &sale);
+    template <typename T>
+    bool waitFor(const QFuture<T> &future, int timeoutMs = DefaultTimeoutMs);
+
+    // DatabaseManager-compatible blocking calls
+    QList<Product> getAllProducts();
+    Product getProductById(int id);
+    bool reserveStock(int productId, int quantity);
+    void releaseStock(int productId, int quantity);
+    bool processSale(const QMap<int, CartItem>& cart, double totalAmount, int userId, const QString &saleUuid = QString());
+    bool isSaleCommitted(const QString &saleUuid);
+    QList<SaleDetailItem> getSaleDetails(int saleId);
+    double getTotalRevenue();
+    int getSalesCountForToday();
+    int getSalesCountForThisMonth();
+    QString getTopSellingProduct();
+
+private slots:
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    bool waitForReadyRead(int timeoutMs);
+    // Sends the request and waits for its reply; the reply body is ready to read from
+    bool request(StoreProtocol::Opcode opcode, const QByteArray &arguments, QByteArray *body);
+
+    QIODevice *m_socket;
+    QByteArray m_buffer;
+    quint32 m_nextRequestId;
+    std::unordered_map<quint32, QPromise<StoreProtocol::Reply>> m_pending;
+    QString m_errorString;
+};
+
+template <typename T>
+bool StoreClient::waitFor(const QFuture<T> &future, int timeoutMs)
+{
+    // waitForReadyRead() delivers readyRead, which completes the futures
+    while (!future.isFinished()) {
+        if (!waitForReadyRead(timeoutMs)) {
+            return future.isFinished();
+        }
+    }
+    return true;
+}
+
+#endif // STORECLIENT_H
@@ -0,0 +1,134 @@
+#include "storeloopback.h"
+#include "databasemanager.h"
+#include "storeclient.h"
+#include "storeserver.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QUuid>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+constexpr int PipelineDepth = 16; // Sales each lane keeps in flight
+}
+
+int runStoreLoopbackTest(int lanes, int salesPerLane)
+{
+    QTextStream out(stdout);
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Could not create a scratch directory\n";
+        return 1;
+    }
+    const QString databasePath = dir.filePath("store.db");
+    const QString serverName = QString("%1-loopback-%2").arg(QLatin1String(StoreProtocol::DefaultServerName))
+                                   .arg(QCoreApplication::applicationPid());
+
+    // Enough stock for every sale, so any refusal is a bug
+    const int totalSales = lanes * salesPerLane;
+    const int productCount = 3;
+    {
+        DatabaseManager setup("loopback-setup", databasePath);
+        setup.init();
+        for (int i = 0; i < productCount; ++i) {
+            setup.addProduct({ QString("Product %1").arg(i + 1), QString(), 10.0 + i, totalSales, QString() });
+        }
+    }
+
+    StoreServer server(databasePath);
+    if (!server.listen(serverName)) {
+        out << "Store server failed to listen: " << server.errorString() << "\n";
+        return 1;
+    }
+
+    std::atomic<int> accepted{0};
+    std::atomic<int> refused{0};
+    std::atomic<int> refusedHolds{0};
+    std::atomic<int> finishedLanes{0};
+    QEventLoop loop;
+    std::vector<std::unique_ptr<QThread>> threads;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int lane = 1; lane <= lanes; ++lane) {
+        std::unique_ptr<QThread> thread(QThread::create([&, lane]() {
+            StoreClient client;
+            if (!client.connectToServer(serverName)) {
+                QTextStream(stderr) << "Lane " << lane << " could not connect: " << client.errorString() << "\n";
+                refused += salesPerLane;
+                return;
+            }
+            const QList<Product> products = client.getAllProducts();
+            if (products.isEmpty()) {
+                refused += salesPerLane;
+                return;
+            }
+
+            for (int first = 0; first < salesPerLane; first += PipelineDepth) {
+                QList<QFuture<bool>> reservations;
+                QList<QFuture<bool>> results;
+                for (int i = first; i < qMin(first + PipelineDepth, salesPerLane); ++i) {
+                    const Product &product = products.at((lane + i) % products.size());
+                    PendingSale sale;
+                    sale.uuid = QUuid::createUuid().toString(QUuid::WithoutBraces);
+                    sale.cart.insert(product.id, { product.name, product.price, 1 });
+                    sale.totalAmount = product.price;
+                    sale.userId = lane;
+                    sale.soldAt = QDateTime::currentDateTimeUtc();
+                    reservations.append(client.reserveStockAsync(product.id, 1));
+                    results.append(client.submitSaleAsync(sale));
+                }
+                // There is stock for every sale, so a refused hold is as much a bug as a refused sale
+                for (const QFuture<bool> &reservation : std::as_const(reservations)) {
+                    if (!client.waitFor(reservation) || !reservation.result()) {
+                        ++refusedHolds;
+                    }
+                }
+                for (const QFuture<bool> &result : std::as_const(results)) {
+                    if (client.waitFor(result) && result.result()) {
+                        ++accepted;
+                    } else {
+                        ++refused;
+                    }
+                }
+            }
+        }));
+        QObject::connect(thread.get(), &QThread::finished, &loop, [&]() {
+            if (++finishedLanes == lanes) {
+                loop.quit();
+            }
+        }, Qt::QueuedConnection);
+        thread->start();
+        threads.push_back(std::move(thread));
+    }
+
+    loop.exec(); // The server handles requests here
+    for (auto &thread : threads) {
+        thread->wait();
+    }
+    const qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+
+    // Every accepted sale exactly once, and stock reduced by exactly that much
+    DatabaseManager check("loopback-check", databasePath);
+    QSqlQuery countQuery("SELECT COUNT(*) FROM Sales", check.getDatabase());
+    const int recorded = countQuery.next() ? countQuery.value(0).toInt() : -1;
+    int remaining = 0;
+    for (const Product &product : check.getAllProducts()) {
+        remaining += product.quantity;
+    }
+    const bool consistent = refused == 0 && refusedHolds == 0 && recorded == accepted
+                            && remaining == productCount * totalSales - accepted;
+
+    out << "Lanes: " << lanes << ", sales per lane: " << salesPerLane << "\n"
+        << "Accepted: " << accepted << ", refused: " << refused << ", refused holds: " << refusedHolds
+        << ", recorded: " << recorded << ", stock left: " << remaining << "\n"
+        << "Elapsed: " << elapsedMs << " ms, " << (accepted * 1000.0 / elapsedMs) << " sales/s\n"
+        << (consistent ? "PASS" : "FAIL") << "\n";
+    return consistent ? 0 : 1;
+}
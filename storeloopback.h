@@ -0,0 +1,11 @@
+#ifndef STORELOOPBACK_H
+#define STORELOOPBACK_H
+
+// Runs a StoreServer on a scratch database and drives it with several lanes, each a
+// StoreClient on its own thread pipelining reserve + sale requests. Checks that every
+// hold was granted, every accepted sale was recorded exactly once and stock matches,
+// then prints throughput.
+// Returns a process exit code (0 on success). Started with --loopback-test.
+int runStoreLoopbackTest(int lanes, int salesPerLane);
+
+#endif // STORELOOPBACK_H
@@ -0,0 +1,62 @@
+#include "storeprotocol.h"
+#include <QtEndian>
+
+namespace StoreProtocol {
+
+QByteArray frame(const QByteArray &payload)
+{
+    QByteArray data(4, Qt::Uninitialized);
+    qToBigEndian<quint32>(quint32(payload.size()), data.data());
+    data.append(payload);
+    return data;
+}
+
+bool takeFrame(QByteArray &buffer, QByteArray *payload, bool *error)
+{
+    *error = false;
+    if (buffer.size() < 4) {
+        return false;
+    }
+    const quint32 length = qFromBigEndian<quint32>(buffer.constData());
+    if (length > MaxFrameSize) {
+        *error = true;
+        return false;
+    }
+    if (quint32(buffer.size()) - 4 < length) {
+        return false;
+    }
+    *payload = buffer.mid(4, length);
+    buffer.remove(0, 4 + length);
+    return true;
+}
+
+} // namespace StoreProtocol
+
+QDataStream &operator<<(QDataStream &out, const Product &product)
+{
+    return out << qint32(product.id) << product.name << product.price << qint32(product.quantity)
+               << product.imagePath;
+}
+
+QDataStream &operator>>(QDataStream &in, Product &product)
+{
+    qint32 id = 0;
+    qint32 quantity = 0;
+    in >> id >> product.name >> product.price >> quantity >> product.imagePath;
+    product.id = id;
+    product.quantity = quantity;
+    return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const SaleDetailItem &item)
+{
+    return out << item.productName << qint32(item.quantitySold) << item.priceAtSale << item.discount << item.imagePath;
+}
+
+QDataStream &operator>>(QDataStream &in, SaleDetailItem &item)
+{
+    qint32 quantity = 0;
+    in >> item.productName >> quantity >> item.priceAtSale >> item.discount >> item.imagePath;
+    item.quantitySold = quantity;
+    return in;
+}
@@ -0,0 +1,57 @@
+#ifndef STOREPROTOCOL_H
+#define STOREPROTOCOL_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include "databasemanager.h"
+#include "product.h"
+
+// Wire format shared by StoreServer and StoreClient. Every message is a frame
+//     [length:u32 big-endian][payload:length bytes]
+// A request payload is (id:u32, opcode:u8, arguments...), a response payload is
+// (id:u32, status:u8, results...), both in QDataStream Qt_6_0 encoding. Requests on
+// one connection may be pipelined; responses carry the request id because sale
+// submissions can complete out of order.
+namespace StoreProtocol {
+
+enum Opcode : quint8 {
+    GetAllProducts = 1,        // -> QList<Product>
+    GetProductById,            // id:i32 -> Product
+    ReserveStock,              // productId:i32, quantity:i32 -> bool
+    ReleaseStock,              // productId:i32, quantity:i32 -> empty body, once released
+    SubmitSale,                // SalesJournal::encode(sale):bytes -> bool
+    IsSaleCommitted,           // uuid:string -> bool
+    GetSaleDetails,            // saleId:i32 -> QList<SaleDetailItem>
+    GetTotalRevenue,           // -> double
+    GetSalesCountForToday,     // -> i32
+    GetSalesCountForThisMonth, // -> i32
+    GetTopSellingProduct       // -> string
+};
+
+enum Status : quint8 {
+    Ok = 0,
+    Failed,         // The request was understood but could not be carried out
+    UnknownOpcode
+};
+
+struct Reply {
+    quint8 status = Failed;
+    QByteArray body; // Results, after the status byte
+};
+
+constexpr quint32 MaxFrameSize = 16 * 1024 * 1024;
+constexpr char DefaultServerName[] = "pos-store";
+
+QByteArray frame(const QByteArray &payload);
+// Removes one complete frame from the front of buffer. Returns false if no complete
+// frame is buffered yet, or (setting *error) if the length is implausible.
+bool takeFrame(QByteArray &buffer, QByteArray *payload, bool *error);
+
+} // namespace StoreProtocol
+
+QDataStream &operator<<(QDataStream &out, const Product &product);
+QDataStream &operator>>(QDataStream &in, Product &product);
+QDataStream &operator<<(QDataStream &out, const SaleDetailItem &item);
+QDataStream &operator>>(QDataStream &in, SaleDetailItem &item);
+
+#endif // STOREPROTOCOL_H
@@ -0,0 +1,296 @@
+#include "storeserver.h"
+#include "groupcommitter.h"
+#include "salesjournal.h"
+#include "storeprotocol.h"
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+StoreServer::StoreServer(const QString &databasePath, QObject *parent) :
+    QObject(parent),
+    m_databasePath(databasePath),
+    m_dbManager("store-server", databasePath),
+    m_committer(new GroupCommitter(databasePath)),
+    m_seedTimer(new QTimer(this)),
+    m_dataVersion(-1),
+    m_salesInFlight(0),
+    m_seedPending(false),
+    m_localServer(nullptr),
+    m_tcpServer(nullptr)
+{
+    m_dbManager.init();
+    m_dataVersion = m_dbManager.dataVersion();
+    seedLedger();
+
+    connect(m_seedTimer, &QTimer::timeout, this, &StoreServer::reseedIfChanged);
+    m_seedTimer->start(SeedPollIntervalMs);
+}
+
+StoreServer::~StoreServer()
+{
+    delete m_committer; // Drains sales already submitted
+}
+
+bool StoreServer::listen(const QString &address, const QHostAddress &bindAddress)
+{
+    bool isPort = false;
+    const int port = address.toInt(&isPort);
+    if (isPort) {
+        m_tcpServer = new QTcpServer(this);
+        connect(m_tcpServer, &QTcpServer::newConnection, this, &StoreServer::onNewTcpConnection);
+        if (!m_tcpServer->listen(bindAddress, quint16(port))) {
+            m_errorString = m_tcpServer->errorString();
+            return false;
+        }
+    } else {
+        m_localServer = new QLocalServer(this);
+        connect(m_localServer, &QLocalServer::newConnection, this, &StoreServer::onNewLocalConnection);
+        QLocalServer::removeServer(address); // Stale socket from a server that crashed
+        if (!m_localServer->listen(address)) {
+            m_errorString = m_localServer->errorString();
+            return false;
+        }
+    }
+    qDebug() << "Store server listening on" << (isPort ? QString("%1:%2").arg(bindAddress.toString(), address) : address);
+    return true;
+}
+
+QString StoreServer::errorString() const
+{
+    return m_errorString;
+}
+
+void StoreServer::reseedIfChanged()
+{
+    // data_version moves on commits from any other connection, the committer's included
+    const qint64 version = m_dbManager.dataVersion();
+    if (version == m_dataVersion) {
+        return;
+    }
+    m_dataVersion = version;
+    // Products may already count a sale whose holds are not applied yet, which would
+    // then be taken off twice; seed once the sales in flight have been applied
+    if (m_salesInFlight > 0) {
+        m_seedPending = true;
+        return;
+    }
+    seedLedger();
+}
+
+void StoreServer::seedLedger()
+{
+    m_seedPending = false;
+    m_ledger.seed(m_dbManager.getAllProducts()); // Holds are kept
+}
+
+void StoreServer::onNewLocalConnection()
+{
+    while (QLocalSocket *socket = m_localServer->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { onDisconnected(socket); });
+        addConnection(socket);
+    }
+}
+
+void StoreServer::onNewTcpConnection()
+{
+    while (QTcpSocket *socket = m_tcpServer->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1); // Small request/response frames
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { onDisconnected(socket); });
+        addConnection(socket);
+    }
+}
+
+void StoreServer::addConnection(QIODevice *socket)
+{
+    m_connections.insert(socket, Connection());
+    connect(socket, &QIODevice::readyRead, this, [this, socket]() { onReadyRead(socket); });
+}
+
+void StoreServer::onReadyRead(QIODevice *socket)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end()) {
+        return;
+    }
+    it->buffer.append(socket->readAll());
+
+    // Requests are handled in arrival order, so a pipelined reserve is always
+    // recorded before the sale that follows it.
+    QByteArray payload;
+    bool error = false;
+    while (StoreProtocol::takeFrame(it->buffer, &payload, &error)) {
+        handleRequest(socket, payload);
+        it = m_connections.find(socket); // Handling may have touched the table; look it up again
+        if (it == m_connections.end()) {
+            return;
+        }
+    }
+    if (error) {
+        qDebug() << "Error: oversized frame from store client, closing connection";
+        socket->close();
+    }
+}
+
+void StoreServer::onDisconnected(QIODevice *socket)
+{
+    const Connection connection = m_connections.take(socket);
+    for (auto it = connection.holds.constBegin(); it != connection.holds.constEnd(); ++it) {
+        m_ledger.release(it.key(), it.value());
+    }
+    socket->deleteLater();
+}
+
+void StoreServer::handleRequest(QIODevice *socket, const QByteArray &payload)
+{
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 requestId = 0;
+    quint8 opcode = 0;
+    in >> requestId >> opcode;
+
+    QByteArray body;
+    QDataStream out(&body, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    switch (opcode) {
+    case StoreProtocol::GetAllProducts:
+        out << m_dbManager.getAllProducts();
+        break;
+    case StoreProtocol::GetProductById: {
+        qint32 id = 0;
+        in >> id;
+        out << m_dbManager.getProductById(id);
+        break;
+    }
+    case StoreProtocol::ReserveStock: {
+        qint32 productId = 0;
+        qint32 quantity = 0;
+        in >> productId >> quantity;
+        const bool reserved = quantity > 0 && m_ledger.reserve(productId, quantity);
+        if (reserved) {
+            m_connections[socket].holds[productId] += quantity;
+        }
+        out << reserved;
+        break;
+    }
+    case StoreProtocol::ReleaseStock: {
+        qint32 productId = 0;
+        qint32 quantity = 0;
+        in >> productId >> quantity;
+        auto &holds = m_connections[socket].holds;
+        const int released = qMin<int>(quantity, holds.value(productId));
+        if (released > 0) {
+            m_ledger.release(productId, released);
+            holds[productId] -= released;
+            if (holds[productId] == 0) holds.remove(productId);
+        }
+        break;
+    }
+    case StoreProtocol::SubmitSale: {
+        QByteArray encodedSale;
+        in >> encodedSale;
+        submitSale(socket, requestId, encodedSale);
+        return; // Replies when the group commit finishes
+    }
+    case StoreProtocol::IsSaleCommitted: {
+        QString uuid;
+        in >> uuid;
+        out << m_dbManager.isSaleCommitted(uuid);
+        break;
+    }
+    case StoreProtocol::GetSaleDetails: {
+        qint32 saleId = 0;
+        in >> saleId;
+        out << m_dbManager.getSaleDetails(saleId);
+        break;
+    }
+    case StoreProtocol::GetTotalRevenue:
+        out << m_dbManager.getTotalRevenue();
+        break;
+    case StoreProtocol::GetSalesCountForToday:
+        out << qint32(m_dbManager.getSalesCountForToday());
+        break;
+    case StoreProtocol::GetSalesCountForThisMonth:
+        out << qint32(m_dbManager.getSalesCountForThisMonth());
+        break;
+    case StoreProtocol::GetTopSellingProduct:
+        out << m_dbManager.getTopSellingProduct();
+        break;
+    default:
+        reply(socket, requestId, StoreProtocol::UnknownOpcode);
+        return;
+    }
+
+    reply(socket, requestId, in.status() == QDataStream::Ok ? StoreProtocol::Ok : StoreProtocol::Failed, body);
+}
+
+void StoreServer::submitSale(QIODevice *socket, quint32 requestId, const QByteArray &encodedSale)
+{
+    PendingSale sale;
+    if (!SalesJournal::decode(encodedSale, &sale)) {
+        reply(socket, requestId, StoreProtocol::Failed);
+        return;
+    }
+
+    // The sale takes over whatever this connection held for its items
+    QHash<int, int> saleHolds;
+    auto &holds = m_connections[socket].holds;
+    for (auto it = sale.cart.constBegin(); it != sale.cart.constEnd(); ++it) {
+        const int held = qMin(it.value().quantity, holds.value(it.key()));
+        if (held > 0) {
+            saleHolds.insert(it.key(), held);
+            holds[it.key()] -= held;
+            if (holds[it.key()] == 0) holds.remove(it.key());
+        }
+    }
+
+    QPointer<QIODevice> guard(socket);
+    ++m_salesInFlight;
+    m_committer->submit(sale).then(this, [this, guard, requestId, sale, saleHolds](bool success) {
+        --m_salesInFlight;
+        if (success) {
+            // The whole sale left the shelf: its held part and anything sold without a hold
+            for (auto it = sale.cart.constBegin(); it != sale.cart.constEnd(); ++it) {
+                const int held = saleHolds.value(it.key());
+                if (held > 0) {
+                    m_ledger.applied(it.key(), held);
+                }
+                if (it.value().quantity > held) {
+                    m_ledger.taken(it.key(), it.value().quantity - held);
+                }
+            }
+        } else {
+            for (auto it = saleHolds.constBegin(); it != saleHolds.constEnd(); ++it) {
+                if (guard && m_connections.contains(guard)) {
+                    m_connections[guard].holds[it.key()] += it.value(); // Still held for a retry
+                } else {
+                    m_ledger.release(it.key(), it.value());
+                }
+            }
+        }
+        if (m_seedPending && m_salesInFlight == 0) {
+            seedLedger();
+        }
+        if (guard && m_connections.contains(guard)) {
+            QByteArray body;
+            QDataStream out(&body, QIODevice::WriteOnly);
+            out.setVersion(QDataStream::Qt_6_0);
+            out << success;
+            reply(guard, requestId, StoreProtocol::Ok, body);
+        }
+    });
+}
+
+void StoreServer::reply(QIODevice *socket, quint32 requestId, quint8 status, const QByteArray &body)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << requestId << status;
+    payload.append(body);
+    socket->write(StoreProtocol::frame(payload));
+}
@@ -0,0 +1,71 @@
+#ifndef STORESERVER_H
+#define STORESERVER_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QObject>
+#include "databasemanager.h"
+#include "stockledger.h"
+
+class GroupCommitter;
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+class QTimer;
+
+// Headless owner of store.db for several tills (run with --server). Registers talk to
+// it through StoreClient instead of opening the database file themselves, so only
+// this process takes SQLite locks. Sales from every connection share one
+// GroupCommitter, and stock is reserved in one StockLedger. Holds that a
+// connection still has when it drops are released. The ledger is re-seeded when
+// PRAGMA data_version shows that another connection (receiving or a stock-take
+// from a back-office till, say) has changed the database.
+class StoreServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int SeedPollIntervalMs = 1000;
+
+    explicit StoreServer(const QString &databasePath, QObject *parent = nullptr);
+    ~StoreServer();
+
+    // A number listens on that TCP port, on bindAddress only; anything else is a local
+    // socket name. Other hosts can only connect if bindAddress says so (e.g. Any).
+    bool listen(const QString &address, const QHostAddress &bindAddress = QHostAddress::LocalHost);
+    QString errorString() const;
+
+private slots:
+    void onNewLocalConnection();
+    void onNewTcpConnection();
+    void reseedIfChanged();
+
+private:
+    struct Connection {
+        QByteArray buffer;
+        QHash<int, int> holds; // Stock reserved by this connection, by product id
+    };
+
+    void addConnection(QIODevice *socket);
+    void onReadyRead(QIODevice *socket);
+    void onDisconnected(QIODevice *socket);
+    void handleRequest(QIODevice *socket, const QByteArray &payload);
+    void submitSale(QIODevice *socket, quint32 requestId, const QByteArray &encodedSale);
+    void reply(QIODevice *socket, quint32 requestId, quint8 status, const QByteArray &body = QByteArray());
+    void seedLedger();
+
+    QString m_databasePath;
+    DatabaseManager m_dbManager;
+    GroupCommitter *m_committer;
+    StockLedger m_ledger;
+    QTimer *m_seedTimer;
+    qint64 m_dataVersion;
+    int m_salesInFlight; // Submitted to the committer, not yet applied to the ledger
+    bool m_seedPending; // The database changed while sales were in flight
+    QLocalServer *m_localServer;
+    QTcpServer *m_tcpServer;
+    QHash<QIODevice*, Connection> m_connections;
+    QString m_errorString;
+};
+
+#endif // STORESERVER_H
@@ -0,0 +1,44 @@
+#include "storesync.h"
+#include "databasemanager.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTextStream>
+
+int runStoreSync(const QString &databasePath, const QString &peerPath)
+{
+    QTextStream out(stdout);
+    if (!QFileInfo::exists(peerPath)) {
+        out << "Peer database not found: " << peerPath << "\n";
+        return 1;
+    }
+
+    // init() also migrates either file to change tracking if it predates it
+    DatabaseManager local("sync-local", databasePath);
+    DatabaseManager peer("sync-peer", peerPath);
+    local.init();
+    peer.init();
+    if (local.siteId().isEmpty() || peer.siteId().isEmpty()) {
+        out << "Could not read the site ids; is change tracking set up?\n";
+        return 1;
+    }
+    if (local.siteId() == peer.siteId()) {
+        out << peerPath << " is a copy of " << databasePath << "; giving it its own site id\n";
+        if (!peer.forkSiteId()) {
+            return 1;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    SyncStats pulled;
+    SyncStats pushed;
+    if (!local.pullChanges(peerPath, &pulled) || !peer.pullChanges(databasePath, &pushed)) {
+        out << "FAIL: sync stopped early; finished chunks are kept and the next run resumes\n";
+        return 1;
+    }
+
+    out << QString("Pulled %1 changes from %2 (%3 new), pushed %4 (%5 new) in %6 ms\n")
+               .arg(pulled.read).arg(peerPath).arg(pulled.applied)
+               .arg(pushed.read).arg(pushed.applied).arg(timer.elapsed());
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef STORESYNC_H
+#define STORESYNC_H
+
+#include <QString>
+
+// Merges two store databases both ways by exchanging only the rows each has not
+// seen, then prints what moved. The peer can be another shop's file or a plain copy
+// of databasePath (a copy is given its own site id first). Returns a process exit
+// code (0 on success). Started with --sync <peer.db>.
+int runStoreSync(const QString &databasePath, const QString &peerPath);
+
+#endif // STORESYNC_H
@@ -0,0 +1,145 @@
+#include "uibenchmark.h"
+#include "dashboardpage.h"
+#include "logindialog.h"
+#include "posstyle.h"
+#include "productdialog.h"
+#include "saledetaildialog.h"
+#include "shadoweffect.h"
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QHeaderView>
+#include <QPixmap>
+#include <QStandardItemModel>
+#include <QStyleFactory>
+#include <QTableView>
+#include <QTextStream>
+#include <functional>
+
+namespace {
+// Average milliseconds per full repaint of widget into an offscreen pixmap
+double paintTimeMs(QWidget *widget, int frames)
+{
+    QPixmap target(widget->size());
+    widget->render(&target); // Warm-up: polish, layout and shadow caches
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < frames; ++i) {
+        widget->render(&target);
+    }
+    return timer.nsecsElapsed() / 1e6 / frames;
+}
+
+// Average milliseconds to construct, polish, lay out and destroy a widget
+double creationTimeMs(const std::function<QWidget *()> &create, int iterations)
+{
+    delete create(); // Warm-up: ui classes, fonts, style caches
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        QWidget *widget = create();
+        widget->ensurePolished();
+        widget->adjustSize();
+        delete widget;
+    }
+    return timer.nsecsElapsed() / 1e6 / iterations;
+}
+
+// A table shaped like the sales history: 1000 rows of id, date, cashier, total
+QTableView *createSalesTable(QStandardItemModel *model)
+{
+    model->setHorizontalHeaderLabels({ "ID", "Date", "Cashier", "Total" });
+    for (int row = 0; row < 1000; ++row) {
+        model->appendRow({ new QStandardItem(QString::number(row + 1)),
+                           new QStandardItem(QString("2024-05-%1 12:%2").arg(row % 28 + 1, 2, 10, QChar('0')).arg(row % 60, 2, 10, QChar('0'))),
+                           new QStandardItem(QString("cashier%1").arg(row % 5)),
+                           new QStandardItem(QString::number((row % 97) * 3.25, 'f', 2)) });
+    }
+    auto *table = new QTableView;
+    table->setModel(model);
+    table->horizontalHeader()->setStretchLastSection(true);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->selectRow(3);
+    table->resize(1000, 700);
+    return table;
+}
+}
+
+int runPaintBenchmark(int frames)
+{
+    QTextStream out(stdout);
+    const bool wasLegacy = ShadowEffect::isLegacy();
+
+    struct Subject {
+        const char *name;
+        std::function<QWidget *()> create;
+        QSize size;
+    };
+    const Subject subjects[] = {
+        { "Dashboard", [] { return new DashboardPage; }, QSize(1280, 800) },
+        { "Login dialog", [] { return new LoginDialog; }, QSize(800, 600) },
+    };
+
+    out << "Paint time per frame, " << frames << " frames each\n";
+    for (const Subject &subject : subjects) {
+        double ms[2] = {};
+        for (int legacy = 1; legacy >= 0; --legacy) {
+            // Effects are attached in the constructors, so each mode gets a fresh widget
+            ShadowEffect::setLegacy(legacy);
+            QWidget *widget = subject.create();
+            widget->resize(subject.size);
+            ms[legacy] = paintTimeMs(widget, frames);
+            delete widget;
+        }
+        out << QString("  %1: QGraphicsDropShadowEffect %2 ms, ShadowEffect %3 ms (%4x)\n")
+                   .arg(QLatin1String(subject.name))
+                   .arg(ms[1], 0, 'f', 3)
+                   .arg(ms[0], 0, 'f', 3)
+                   .arg(ms[0] > 0 ? ms[1] / ms[0] : 0.0, 0, 'f', 1);
+    }
+
+    ShadowEffect::setLegacy(wasLegacy);
+    return 0;
+}
+
+int runThemeBenchmark(int iterations)
+{
+    QTextStream out(stdout);
+    QApplication *app = qobject_cast<QApplication *>(QCoreApplication::instance());
+    if (!app) {
+        return 1;
+    }
+
+    struct Mode {
+        const char *name;
+        std::function<void()> apply;
+    };
+    const Mode modes[] = {
+        { "style.qss", [app] {
+              app->setStyle(QStyleFactory::create("Fusion"));
+              PosStyle::applyStyleSheet(*app);
+          } },
+        { "PosStyle", [app] { PosStyle::apply(*app); } },
+    };
+
+    double ms[2][3] = {};
+    for (int mode = 0; mode < 2; ++mode) {
+        modes[mode].apply();
+        ms[mode][0] = creationTimeMs([] { return new ProductDialog; }, iterations);
+        ms[mode][1] = creationTimeMs([] { return new SaleDetailDialog; }, iterations);
+        QStandardItemModel model;
+        QTableView *table = createSalesTable(&model);
+        ms[mode][2] = paintTimeMs(table, iterations);
+        delete table;
+    }
+
+    const char *measurements[] = { "Product dialog, create", "Sale detail dialog, create", "Sales table, paint" };
+    out << "Time per iteration, " << iterations << " iterations each\n";
+    for (int i = 0; i < 3; ++i) {
+        out << QString("  %1: style.qss %2 ms, PosStyle %3 ms (%4x)\n")
+                   .arg(QLatin1String(measurements[i]))
+                   .arg(ms[0][i], 0, 'f', 3)
+                   .arg(ms[1][i], 0, 'f', 3)
+                   .arg(ms[1][i] > 0 ? ms[0][i] / ms[1][i] : 0.0, 0, 'f', 1);
+    }
+    return 0;
+}
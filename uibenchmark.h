@@ -0,0 +1,16 @@
+#ifndef UIBENCHMARK_H
+#define UIBENCHMARK_H
+
+// Renders the dashboard and the login dialog offscreen, first with
+// QGraphicsDropShadowEffect and then with the cached ShadowEffect, and prints the
+// average paint time per frame of each. Needs a QApplication (use
+// QT_QPA_PLATFORM=offscreen on a headless box). Returns a process exit code.
+// Started with --paint-benchmark.
+int runPaintBenchmark(int frames);
+
+// Compares style.qss (QStyleSheetStyle over Fusion) with PosStyle: the time to create,
+// polish and lay out the product and sale-detail dialogs, and the time to repaint a
+// 1000-row sales table. Leaves PosStyle installed. Started with --theme-benchmark.
+int runThemeBenchmark(int iterations);
+
+#endif // UIBENCHMARK_H
@@ -0,0 +1,365 @@
+#include "zreport.h"
+#include "readconnection.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <QTimeZone>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+const char *const TimestampFormat = "yyyy-MM-dd HH:mm:ss"; // sale_date, UTC
+
+struct Totals {
+    int sales = 0;
+    int units = 0;
+    double revenue = 0.0;
+};
+
+// What one sale-id range contributes to the report
+struct Partial {
+    Totals total;
+    QHash<int, Totals> cashiers; // By user id
+    QHash<int, Totals> products; // By product id
+    Totals hours[24];
+    bool ok = true;
+};
+
+struct IdRange {
+    QString databasePath; // store.db or one of its monthly archive files
+    qint64 first;
+    qint64 last;
+};
+
+QString utcText(const QDateTime &dateTime)
+{
+    return dateTime.toUTC().toString(TimestampFormat);
+}
+
+Partial scanRange(const IdRange &range, const QString &start, const QString &end)
+{
+    Partial partial;
+    ReadConnection connection(range.databasePath, "zreport");
+    {
+        QSqlQuery query(connection.database());
+        query.setForwardOnly(true);
+        query.prepare("SELECT S.id, S.sale_date, S.total_amount, S.user_id, "
+                      "SI.product_id, SI.quantity_sold, SI.price_at_sale, SI.discount "
+                      "FROM Sales S LEFT JOIN SaleItems SI ON SI.sale_id = S.id "
+                      "WHERE S.id BETWEEN :first AND :last AND S.sale_date >= :start AND S.sale_date < :end "
+                      "ORDER BY S.id");
+        query.bindValue(":first", range.first);
+        query.bindValue(":last", range.last);
+        query.bindValue(":start", start);
+        query.bindValue(":end", end);
+        if (!query.exec()) {
+            qDebug() << "Error: failed to read sales for Z-report:" << query.lastError();
+            partial.ok = false;
+            return partial;
+        }
+
+        // Rows come grouped by sale; sale-level figures are counted on its first row
+        qint64 currentSale = -1;
+        int userId = 0;
+        int hour = 0;
+        while (query.next()) {
+            const qint64 saleId = query.value(0).toLongLong();
+            if (saleId != currentSale) {
+                currentSale = saleId;
+                const double amount = query.value(2).toDouble();
+                userId = query.value(3).toInt();
+                QDateTime when = QDateTime::fromString(query.value(1).toString(), TimestampFormat);
+                when.setTimeZone(QTimeZone::utc());
+                hour = qBound(0, when.toLocalTime().time().hour(), 23);
+
+                for (Totals *totals : { &partial.total, &partial.cashiers[userId], &partial.hours[hour] }) {
+                    ++totals->sales;
+                    totals->revenue += amount;
+                }
+            }
+            if (query.isNull(4)) {
+                continue; // A sale without items
+            }
+            const int productId = query.value(4).toInt();
+            const int units = query.value(5).toInt();
+            Totals &product = partial.products[productId];
+            ++product.sales;
+            product.units += units;
+            product.revenue += units * query.value(6).toDouble() - query.value(7).toDouble();
+            partial.total.units += units;
+            partial.cashiers[userId].units += units;
+            partial.hours[hour].units += units;
+        }
+    }
+    return partial;
+}
+
+// Splits the period's sales in one database file into sale-id ranges. Ids are not
+// in date order once sync has added sales from another store, so every range
+// still filters by date.
+bool addRanges(const QString &databasePath, const QString &start, const QString &end, QList<IdRange> *ranges)
+{
+    ReadConnection connection(databasePath, "zreport");
+    QSqlQuery query(connection.database());
+    query.prepare("SELECT MIN(id), MAX(id), COUNT(*) FROM Sales WHERE sale_date >= :start AND sale_date < :end");
+    query.bindValue(":start", start);
+    query.bindValue(":end", end);
+    if (!query.exec() || !query.next()) {
+        qDebug() << "Error: failed to find the sales for Z-report:" << databasePath << query.lastError();
+        return false;
+    }
+    if (!query.isNull(0)) {
+        const qint64 first = query.value(0).toLongLong();
+        const qint64 last = query.value(1).toLongLong();
+        const int count = query.value(2).toInt();
+        const int partitions = qBound(1, count / ZReportEngine::MinSalesPerPartition, qMax(1, QThread::idealThreadCount()));
+        const qint64 span = (last - first) / partitions + 1;
+        for (qint64 from = first; from <= last; from += span) {
+            ranges->append({ databasePath, from, qMin(last, from + span - 1) });
+        }
+    }
+    return true;
+}
+
+// The archive files holding months (UTC, like sale_date) that the period touches
+bool archivesFor(const QSqlDatabase &db, const QString &databasePath, const QDateTime &start, const QDateTime &end,
+                 QStringList *files)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT file FROM SalesPartitions WHERE period >= :first AND period <= :last ORDER BY period");
+    query.bindValue(":first", start.toUTC().toString("yyyy-MM"));
+    query.bindValue(":last", end.toUTC().addSecs(-1).toString("yyyy-MM"));
+    if (!query.exec()) {
+        qDebug() << "Error: failed to find the sales archives for Z-report:" << query.lastError();
+        return false;
+    }
+    const QDir directory = QFileInfo(databasePath).absoluteDir();
+    while (query.next()) {
+        files->append(directory.filePath(query.value(0).toString()));
+    }
+    return true;
+}
+
+void add(Totals &into, const Totals &from)
+{
+    into.sales += from.sales;
+    into.units += from.units;
+    into.revenue += from.revenue;
+}
+
+QList<ZReportLine> sortedLines(const QHash<int, Totals> &totals, const QHash<int, QString> &names, const QString &fallback)
+{
+    QList<ZReportLine> lines;
+    lines.reserve(totals.size());
+    for (auto it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        const QString name = names.value(it.key());
+        lines.append({ name.isEmpty() ? fallback.arg(it.key()) : name, it->sales, it->units, it->revenue });
+    }
+    std::sort(lines.begin(), lines.end(), [](const ZReportLine &a, const ZReportLine &b) {
+        return a.revenue != b.revenue ? a.revenue > b.revenue : a.label < b.label;
+    });
+    return lines;
+}
+
+QHash<int, QString> namesFor(const QSqlDatabase &db, const QString &table, const QString &column)
+{
+    QHash<int, QString> names;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT id, %1 FROM %2").arg(column, table))) {
+        qDebug() << "Error: failed to read names for Z-report:" << query.lastError();
+        return names;
+    }
+    while (query.next()) {
+        names.insert(query.value(0).toInt(), query.value(1).toString());
+    }
+    return names;
+}
+
+QJsonArray linesToJson(const QList<ZReportLine> &lines)
+{
+    QJsonArray array;
+    for (const ZReportLine &line : lines) {
+        array.append(QJsonObject{ { "label", line.label }, { "sales", line.sales },
+                                  { "units", line.units }, { "revenue", line.revenue } });
+    }
+    return array;
+}
+
+QList<ZReportLine> linesFromJson(const QJsonArray &array)
+{
+    QList<ZReportLine> lines;
+    lines.reserve(array.size());
+    for (const QJsonValue &value : array) {
+        const QJsonObject object = value.toObject();
+        lines.append({ object.value("label").toString(), object.value("sales").toInt(),
+                       object.value("units").toInt(), object.value("revenue").toDouble() });
+    }
+    return lines;
+}
+
+QString linesToHtml(const QString &title, const QString &labelHeader, const QList<ZReportLine> &lines)
+{
+    QString html = QString("<h3>%1</h3><table width='100%' cellspacing='0' cellpadding='4'>"
+                           "<tr><th align='left'>%2</th><th align='right'>Sales</th>"
+                           "<th align='right'>Units</th><th align='right'>Revenue</th></tr>")
+                       .arg(title, labelHeader);
+    for (const ZReportLine &line : lines) {
+        html += QString("<tr><td>%1</td><td align='right'>%2</td><td align='right'>%3</td>"
+                        "<td align='right'>$%4</td></tr>")
+                    .arg(line.label.toHtmlEscaped()).arg(line.sales).arg(line.units).arg(line.revenue, 0, 'f', 2);
+    }
+    return html + "</table>";
+}
+}
+
+bool ZReport::isClosed() const
+{
+    return end.isValid() && end <= QDateTime::currentDateTimeUtc();
+}
+
+QByteArray ZReport::toJson() const
+{
+    const QJsonObject object{
+        { "start", utcText(start) },
+        { "end", utcText(end) },
+        { "sales", sales },
+        { "units", units },
+        { "revenue", revenue },
+        { "cashiers", linesToJson(cashiers) },
+        { "products", linesToJson(products) },
+        { "hours", linesToJson(hours) },
+    };
+    return QJsonDocument(object).toJson(QJsonDocument::Compact);
+}
+
+ZReport ZReport::fromJson(const QByteArray &json)
+{
+    ZReport report;
+    const QJsonObject object = QJsonDocument::fromJson(json).object();
+    report.start = QDateTime::fromString(object.value("start").toString(), TimestampFormat);
+    report.start.setTimeZone(QTimeZone::utc());
+    report.end = QDateTime::fromString(object.value("end").toString(), TimestampFormat);
+    report.end.setTimeZone(QTimeZone::utc());
+    report.sales = object.value("sales").toInt();
+    report.units = object.value("units").toInt();
+    report.revenue = object.value("revenue").toDouble();
+    report.cashiers = linesFromJson(object.value("cashiers").toArray());
+    report.products = linesFromJson(object.value("products").toArray());
+    report.hours = linesFromJson(object.value("hours").toArray());
+    report.valid = !object.isEmpty();
+    report.stored = true;
+    return report;
+}
+
+QString ZReport::toHtml() const
+{
+    const QString period = QString("%1 &ndash; %2").arg(start.toLocalTime().toString("yyyy-MM-dd HH:mm"),
+                                                         end.toLocalTime().toString("yyyy-MM-dd HH:mm"));
+    QString status;
+    if (stored) {
+        status = QString("Closed. Stored %1.").arg(generatedAt.toLocalTime().toString("yyyy-MM-dd HH:mm:ss"));
+    } else if (isClosed()) {
+        status = "Closed.";
+    } else {
+        status = "Period still open: interim figures, not stored.";
+    }
+
+    QString html = QString("<h2>Z-Report</h2><p>%1<br>%2</p>"
+                           "<table cellpadding='4'><tr><td>Sales</td><td align='right'><b>%3</b></td></tr>"
+                           "<tr><td>Units</td><td align='right'><b>%4</b></td></tr>"
+                           "<tr><td>Revenue</td><td align='right'><b>$%5</b></td></tr></table>")
+                       .arg(period, status).arg(sales).arg(units).arg(revenue, 0, 'f', 2);
+    html += linesToHtml("By cashier", "Cashier", cashiers);
+
+    // Only the hours that had trade
+    QList<ZReportLine> activeHours;
+    for (const ZReportLine &hour : hours) {
+        if (hour.sales > 0) activeHours.append(hour);
+    }
+    html += linesToHtml("By hour", "Hour", activeHours);
+    html += linesToHtml("By product", "Product", products);
+    return html;
+}
+
+ZReport ZReportEngine::compute(const QString &databasePath, const QDateTime &start, const QDateTime &end)
+{
+    ZReport report;
+    report.start = start.toUTC();
+    report.end = end.toUTC();
+    report.generatedAt = QDateTime::currentDateTimeUtc();
+    const QString startText = utcText(start);
+    const QString endText = utcText(end);
+
+    ReadConnection connection(databasePath, "zreport");
+    QList<IdRange> ranges;
+    QStringList archives;
+    QHash<int, QString> userNames;
+    QHash<int, QString> productNames;
+    {
+        // Months already moved out of Sales are read from their archive files
+        if (!archivesFor(connection.database(), databasePath, start, end, &archives)) {
+            return report;
+        }
+        for (const QString &path : QStringList(archives) << databasePath) {
+            if (!addRanges(path, startText, endText, &ranges)) {
+                return report;
+            }
+        }
+        userNames = namesFor(connection.database(), "Users", "username");
+        productNames = namesFor(connection.database(), "Products", "name");
+    }
+
+    const QList<Partial> partials = QtConcurrent::blockingMapped<QList<Partial>>(
+        ranges, [startText, endText](const IdRange &range) {
+            return scanRange(range, startText, endText);
+        });
+
+    // A month archived while the files were read may have had sales counted in
+    // both places or in neither
+    QStringList archivesAfter;
+    if (!archivesFor(connection.database(), databasePath, start, end, &archivesAfter) || archivesAfter != archives) {
+        qDebug() << "Error: sales were archived while the Z-report was computed";
+        return report;
+    }
+
+    Totals total;
+    QHash<int, Totals> cashiers;
+    QHash<int, Totals> products;
+    Totals hours[24];
+    for (const Partial &partial : partials) {
+        if (!partial.ok) {
+            return report; // Not valid: better no figures than wrong ones
+        }
+        add(total, partial.total);
+        for (auto it = partial.cashiers.constBegin(); it != partial.cashiers.constEnd(); ++it) {
+            add(cashiers[it.key()], it.value());
+        }
+        for (auto it = partial.products.constBegin(); it != partial.products.constEnd(); ++it) {
+            add(products[it.key()], it.value());
+        }
+        for (int hour = 0; hour < 24; ++hour) {
+            add(hours[hour], partial.hours[hour]);
+        }
+    }
+
+    report.sales = total.sales;
+    report.units = total.units;
+    report.revenue = total.revenue;
+    report.cashiers = sortedLines(cashiers, userNames, "User #%1");
+    report.products = sortedLines(products, productNames, "Product #%1");
+    for (int hour = 0; hour < 24; ++hour) {
+        report.hours.append({ QString("%1:00").arg(hour, 2, 10, QChar('0')), hours[hour].sales, hours[hour].units,
+                              hours[hour].revenue });
+    }
+    report.valid = true;
+    return report;
+}
@@ -0,0 +1,52 @@
+#ifndef ZREPORT_H
+#define ZREPORT_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+// One row of a breakdown: a cashier, a product or an hour of the day
+struct ZReportLine {
+    QString label;
+    int sales = 0;
+    int units = 0;
+    double revenue = 0.0;
+};
+
+// Totals for one period (normally a business day) with the per-cashier,
+// per-product and per-hour breakdowns. A report for a period that has ended is
+// stored in ZReports as JSON and shown from there afterwards.
+struct ZReport {
+    QDateTime start; // Inclusive
+    QDateTime end;   // Exclusive
+    QDateTime generatedAt;
+    bool valid = false; // False when the sales could not be read
+    bool stored = false; // Read back from ZReports rather than computed just now
+    int sales = 0;
+    int units = 0;
+    double revenue = 0.0;
+    QList<ZReportLine> cashiers; // By revenue, highest first
+    QList<ZReportLine> products; // By revenue, highest first
+    QList<ZReportLine> hours;    // 24 entries, local time
+
+    bool isClosed() const; // The period has ended, so the report can be stored
+    QByteArray toJson() const;
+    static ZReport fromJson(const QByteArray &json);
+    QString toHtml() const;
+};
+
+// Builds a ZReport from store.db and the archive files of any month the period
+// touches. The period's sales are split into sale-id ranges, one per pool thread,
+// and each range is read once (sales joined with their items) on its own
+// read-only connection, updating every breakdown from the same rows; the partial
+// results are then merged. Blocking; run it off the UI thread.
+class ZReportEngine
+{
+public:
+    static constexpr int MinSalesPerPartition = 2000; // Smaller ranges cost more in connections than they save
+
+    static ZReport compute(const QString &databasePath, const QDateTime &start, const QDateTime &end);
+};
+
+#endif // ZREPORT_H
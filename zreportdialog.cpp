@@ -0,0 +1,145 @@
+#include "zreportdialog.h"
+#include "databasemanager.h"
+#include <QDateEdit>
+#include <QDialogButtonBox>
+#include <QElapsedTimer>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTextBrowser>
+#include <QVBoxLayout>
+#include <QtConcurrent/QtConcurrentRun>
+#include <utility>
+
+ZReportDialog::ZReportDialog(DatabaseManager *dbManager, std::function<int()> unsavedSales, QWidget *parent) :
+    QDialog(parent),
+    m_dbManager(dbManager),
+    m_unsavedSales(std::move(unsavedSales)),
+    m_generation(0)
+{
+    setWindowTitle(tr("Z-Report"));
+    resize(640, 720);
+
+    m_dayEdit = new QDateEdit(QDate::currentDate(), this);
+    m_dayEdit->setCalendarPopup(true);
+    m_dayEdit->setMaximumDate(QDate::currentDate());
+    m_statusLabel = new QLabel(this);
+    m_browser = new QTextBrowser(this);
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    m_closeDayButton = buttons->addButton(tr("Close Day"), QDialogButtonBox::ActionRole);
+    m_closeDayButton->setEnabled(false);
+
+    auto *dayLayout = new QHBoxLayout;
+    dayLayout->addWidget(new QLabel(tr("Day:"), this));
+    dayLayout->addWidget(m_dayEdit);
+    dayLayout->addStretch();
+    dayLayout->addWidget(m_statusLabel);
+    auto *layout = new QVBoxLayout(this);
+    layout->addLayout(dayLayout);
+    layout->addWidget(m_browser);
+    layout->addWidget(buttons);
+
+    connect(m_dayEdit, &QDateEdit::dateChanged, this, &ZReportDialog::showDay);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(m_closeDayButton, &QPushButton::clicked, this, &ZReportDialog::closeDay);
+    showDay(m_dayEdit->date());
+}
+
+void ZReportDialog::showDay(const QDate &day)
+{
+    ++m_generation; // Drop a report still being computed for another day
+    m_closeDayButton->setEnabled(false);
+    const QDateTime start(day, QTime(0, 0)); // Local business day
+    const QDateTime end = start.addDays(1);
+
+    // A closed day is computed once; afterwards it comes straight from ZReports
+    QDateTime generatedAt;
+    const QByteArray stored = m_dbManager->getZReport(start, end, &generatedAt);
+    if (!stored.isEmpty()) {
+        ZReport report = ZReport::fromJson(stored);
+        report.generatedAt = generatedAt;
+        m_statusLabel->setText(tr("Stored report"));
+        render(report);
+        return;
+    }
+
+    m_statusLabel->setText(tr("Computing..."));
+    m_browser->clear();
+    compute(day, false);
+}
+
+void ZReportDialog::closeDay()
+{
+    // Sales still in this till's journal or retry list keep their original time,
+    // so they would be missing from a report stored now
+    const int unsaved = m_unsavedSales ? m_unsavedSales() : 0;
+    if (unsaved > 0) {
+        QMessageBox::warning(this, tr("Close Day"),
+                             tr("%n sale(s) on this till are not saved yet. Retry any failed sales and close "
+                                "the day once they are saved.", "", unsaved));
+        return;
+    }
+    const QDate day = m_dayEdit->date();
+    const auto answer = QMessageBox::question(
+        this, tr("Close Day"),
+        tr("Store the report for %1? It cannot be changed afterwards, so other tills and synced stores "
+           "should have sent their sales for the day first.").arg(QLocale().toString(day, QLocale::ShortFormat)));
+    if (answer != QMessageBox::Yes) {
+        return;
+    }
+    m_closeDayButton->setEnabled(false);
+    m_statusLabel->setText(tr("Closing..."));
+    compute(day, true);
+}
+
+void ZReportDialog::compute(const QDate &day, bool close)
+{
+    const quint64 generation = ++m_generation;
+    const QDateTime start(day, QTime(0, 0));
+    const QDateTime end = start.addDays(1);
+    const QString databasePath = m_dbManager->getDatabase().databaseName();
+    auto work = [databasePath, start, end]() {
+        QElapsedTimer timer;
+        timer.start();
+        ZReport report = ZReportEngine::compute(databasePath, start, end);
+        return qMakePair(report, timer.elapsed());
+    };
+    QtConcurrent::run(work).then(this, [this, generation, close](const QPair<ZReport, qint64> &result) {
+        if (generation != m_generation) {
+            return; // Another day was picked meanwhile
+        }
+        ZReport report = result.first;
+        if (!report.valid) {
+            m_statusLabel->setText(tr("Could not read the sales"));
+            return;
+        }
+        if (!close || !report.isClosed()) {
+            m_statusLabel->setText(tr("Computed in %1 ms").arg(result.second));
+            m_closeDayButton->setEnabled(report.isClosed());
+            render(report);
+            return;
+        }
+        if (!m_dbManager->storeZReport(report.start, report.end, report.sales, report.revenue, report.toJson())) {
+            m_statusLabel->setText(tr("Could not store the report"));
+            m_closeDayButton->setEnabled(true);
+            render(report);
+            return;
+        }
+        // Show what was stored, which is another till's report if it closed the day first
+        QDateTime generatedAt;
+        const QByteArray stored = m_dbManager->getZReport(report.start, report.end, &generatedAt);
+        if (!stored.isEmpty()) {
+            report = ZReport::fromJson(stored);
+            report.generatedAt = generatedAt;
+        }
+        m_statusLabel->setText(tr("Day closed"));
+        render(report);
+    });
+}
+
+void ZReportDialog::render(const ZReport &report)
+{
+    m_browser->setHtml(report.toHtml());
+}
@@ -0,0 +1,43 @@
+#ifndef ZREPORTDIALOG_H
+#define ZREPORTDIALOG_H
+
+#include <QDate>
+#include <QDialog>
+#include <functional>
+#include "zreport.h"
+
+class DatabaseManager;
+class QDateEdit;
+class QLabel;
+class QPushButton;
+class QTextBrowser;
+
+// Day-close report for a chosen day. A day that already has a stored report is
+// shown from ZReports; otherwise the report is computed in the background. A day
+// that is over is only stored by Close Day, which recomputes it first and is
+// refused while this till still has sales that are not in the database.
+class ZReportDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // unsavedSales counts this till's sales still pending or failed
+    ZReportDialog(DatabaseManager *dbManager, std::function<int()> unsavedSales, QWidget *parent = nullptr);
+
+    void showDay(const QDate &day);
+
+private:
+    void closeDay();
+    void compute(const QDate &day, bool close);
+    void render(const ZReport &report);
+
+    DatabaseManager *m_dbManager;
+    std::function<int()> m_unsavedSales;
+    QDateEdit *m_dayEdit;
+    QLabel *m_statusLabel;
+    QPushButton *m_closeDayButton;
+    QTextBrowser *m_browser;
+    quint64 m_generation; // Results for a day that is no longer selected are dropped
+};
+
+#endif // ZREPORTDIALOG_H